@@ -0,0 +1,347 @@
+/*  hackpad_bench - headless timings of HackPad's hot paths, as JSON
+
+    Compile (from the repository root):
+      make hackpad_bench
+
+    Usage:
+      ./hackpad_bench [--sections N] [--entries N] [--section-depth N] [--depth N]
+                      [--tags N] [--tag-pool N] [--done PCT] [--rounds N]
+                      [--seed N] [--filter EXPR] [--file PATH]
+
+    Generates a synthetic notebook (--entries per section, entry nesting up to
+    --depth, --tags per entry drawn from --tag-pool names, --done percent of
+    them completed), writes it to --file (a temporary file by default, removed
+    afterwards) and times, with no terminal involved:
+
+      load_md        load_hackpad from markdown
+      save_md        save_hackpad (markdown only)
+      write_hpb      writing the binary snapshot
+      load_hpb       load_hackpad from the snapshot
+      visible        build_visible_entries over every section, no filter
+      filter         entry_matches_filter over every entry (--filter)
+      insert         insert_entry_at after random entries
+      delete_section removing random section subtrees (delete_section's core)
+
+    Whole-notebook passes run --rounds times and report min/median/max; the
+    per-item operations report the mean per operation. The JSON document goes
+    to stdout, a readable summary to stderr. Comparing two builds is a matter
+    of running both with the same arguments and diffing the JSON.
+*/
+
+#define _XOPEN_SOURCE 700
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../hackpad_core_internal.h"
+
+#define BENCH_MAX_ROUNDS 64
+
+typedef struct {
+    int sections;
+    int entries;            /* per section */
+    int section_depth;
+    int depth;
+    int tags;               /* per entry */
+    int tag_pool;
+    int done_pct;
+    int rounds;
+    unsigned long seed;
+    const char *filter;
+    const char *file;
+} BenchParams;
+
+typedef struct {
+    const char *name;
+    int ops;                /* items per round (entries, sections, inserts...) */
+    int rounds;
+    double ms[BENCH_MAX_ROUNDS];
+} BenchResult;
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static unsigned long rng_state;
+
+static unsigned rnd(unsigned n) {
+    rng_state = rng_state * 6364136223846793005UL + 1442695040888963407UL;
+    return n ? (unsigned)((rng_state >> 33) % n) : 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* ---------------- Generator ---------------- */
+
+static void gen_text(char *buf, size_t size) {
+    static const char *os[] = {"Linux", "Windows Server 2019", "FreeBSD", "Ubuntu 22.04"};
+    static const char *svc[] = {"SMB", "HTTP", "SSH", "RDP", "MSSQL", "LDAP", "WinRM"};
+    static const char *user[] = {"Administrator", "svc_backup", "j.smith", "sqladmin", "krbtgt"};
+    switch (rnd(4)) {
+        case 0:
+            snprintf(buf, size, "IP: 10.%u.%u.%u | Hostname: host%u.corp.local | OS: %s | Ports: 22,80,443,%u",
+                     rnd(256), rnd(256), rnd(256), rnd(100000), os[rnd(4)], 1024 + rnd(60000));
+            break;
+        case 1:
+            snprintf(buf, size, "Username: %s | Password: Summer%u! | Service: %s",
+                     user[rnd(5)], 2000 + rnd(30), svc[rnd(7)]);
+            break;
+        case 2:
+            snprintf(buf, size, "CVE-%u-%u on 10.%u.%u.%u, payload windows/x64/meterpreter/reverse_tcp",
+                     2015 + rnd(10), 1000 + rnd(40000), rnd(256), rnd(256), rnd(256));
+            break;
+        default:
+            snprintf(buf, size, "http://10.%u.%u.%u:%u/admin/login.php found via gobuster, %s exposed",
+                     rnd(256), rnd(256), rnd(256), 8000 + rnd(100), svc[rnd(7)]);
+            break;
+    }
+}
+
+static int generate_notebook(HackPad *nb, const BenchParams *bp) {
+    nb->created_time = 1736157600;
+    int sdepth = 0;
+    for (int si = 0; si < bp->sections; si++) {
+        Section *s = append_section(nb);
+        if (!s) return 0;
+        s->id = nb->next_section_id++;
+        s->depth = si == 0 ? 0 : (int)rnd((unsigned)(sdepth < bp->section_depth ? sdepth + 2 : sdepth + 1));
+        sdepth = s->depth;
+        s->color = (UiColor)rnd(3);
+        snprintf(s->name, sizeof(s->name), "Section %d", si);
+
+        int depth = 0;
+        for (int n = 0; n < bp->entries; n++) {
+            depth = n == 0 ? 0 : (int)rnd((unsigned)(depth < bp->depth ? depth + 2 : depth + 1));
+            EntryHot h = { depth, 0, (int)rnd(100) < bp->done_pct, rnd(50) == 0,
+                           (Priority)rnd(5), (UiColor)(rnd(4) == 0 ? rnd(8) : HP_COLOR_NONE) };
+            Entry *e = append_entry(nb, s, &h);
+            if (!e) return 0;
+            e->id = nb->next_entry_id++;
+            e->section_id = s->id;
+            char buf[256];
+            gen_text(buf, sizeof(buf));
+            if (!entry_set_text(nb, e, buf)) return 0;
+            for (int t = 0; t < bp->tags && t < MAX_TAGS; t++) {
+                char tag[32];
+                int len = snprintf(tag, sizeof(tag), "tag%u", rnd((unsigned)bp->tag_pool));
+                int id = intern_tag(nb, tag, (size_t)len);
+                if (id >= 0) e->tags[e->tag_count++] = (uint16_t)id;
+            }
+            e->created = nb->created_time + (time_t)rnd(86400 * 30);
+            e->modified = e->created + (time_t)rnd(86400);
+        }
+    }
+    reindex_sections(nb, 0);
+    reindex_entries(nb, 0);
+    return 1;
+}
+
+static void reset_notebook(HackPad *nb) {
+    free_hackpad(nb);
+    memset(nb, 0, sizeof(*nb));
+    nb->journal_fd = -1;
+}
+
+/* ---------------- Output ---------------- */
+
+static void json_result(const BenchResult *r, int last) {
+    double sorted[BENCH_MAX_ROUNDS];
+    memcpy(sorted, r->ms, (size_t)r->rounds * sizeof(double));
+    qsort(sorted, (size_t)r->rounds, sizeof(double), cmp_double);
+    double med = sorted[r->rounds / 2];
+    printf("    {\"name\": \"%s\", \"ops\": %d, \"rounds\": %d, \"min_ms\": %.3f, \"median_ms\": %.3f, "
+           "\"max_ms\": %.3f, \"ns_per_op\": %.1f}%s\n",
+           r->name, r->ops, r->rounds, sorted[0], med, sorted[r->rounds - 1],
+           r->ops > 0 ? med * 1e6 / r->ops : 0.0, last ? "" : ",");
+    fprintf(stderr, "  %-15s %9d ops  median %10.3f ms  %10.1f ns/op\n",
+            r->name, r->ops, med, r->ops > 0 ? med * 1e6 / r->ops : 0.0);
+}
+
+static const char *arg_value(int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) { fprintf(stderr, "%s needs a value\n", argv[*i]); exit(2); }
+    return argv[++*i];
+}
+
+int main(int argc, char *argv[]) {
+    BenchParams bp = { 200, 1000, 2, 4, 2, 64, 30, 5, 12345, "#tag1 | #tag2 p:0-1 is:open", NULL };
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "--sections")) bp.sections = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--entries")) bp.entries = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--section-depth")) bp.section_depth = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--depth")) bp.depth = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--tags")) bp.tags = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--tag-pool")) bp.tag_pool = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--done")) bp.done_pct = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--rounds")) bp.rounds = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--seed")) bp.seed = strtoul(arg_value(argc, argv, &i), NULL, 10);
+        else if (!strcmp(a, "--filter")) bp.filter = arg_value(argc, argv, &i);
+        else if (!strcmp(a, "--file")) bp.file = arg_value(argc, argv, &i);
+        else { fprintf(stderr, "unknown option %s (see the comment at the top of bench/hackpad_bench.c)\n", a); return 2; }
+    }
+    if (bp.sections < 1 || bp.entries < 0 || bp.tag_pool < 1 || bp.depth < 0 || bp.depth > 200 ||
+        bp.section_depth < 0 || bp.section_depth > 30) {
+        fprintf(stderr, "bad sizes\n");
+        return 2;
+    }
+    if (bp.rounds < 1) bp.rounds = 1;
+    if (bp.rounds > BENCH_MAX_ROUNDS) bp.rounds = BENCH_MAX_ROUNDS;
+    rng_state = bp.seed;
+
+    char tmp[] = "/tmp/hackpad_bench_XXXXXX";
+    const char *file = bp.file;
+    if (!file) {
+        int fd = mkstemp(tmp);
+        if (fd < 0) { perror("mkstemp"); return 1; }
+        close(fd);
+        file = tmp;
+    }
+    char hpb[272];
+    snprintf(hpb, sizeof(hpb), "%s.hpb", file);
+
+    BenchResult res[8];
+    int nres = 0;
+    HackPad nb;
+    memset(&nb, 0, sizeof(nb));
+    nb.journal_fd = -1;
+
+    /* the notebook on disk, markdown only */
+    setenv("HACKPAD_SNAPSHOT", "0", 1);
+    if (!generate_notebook(&nb, &bp) || save_hackpad(&nb, file) != 0) {
+        fprintf(stderr, "could not generate %s\n", file);
+        return 1;
+    }
+    unlink(hpb);
+    int total_entries = nb.entry_count;
+
+    BenchResult *r = &res[nres++];
+    *r = (BenchResult){ "load_md", total_entries, bp.rounds, {0} };
+    for (int k = 0; k < bp.rounds; k++) {
+        reset_notebook(&nb);
+        double t = now_ms();
+        load_hackpad(&nb, file);
+        r->ms[k] = now_ms() - t;
+    }
+
+    r = &res[nres++];
+    *r = (BenchResult){ "save_md", total_entries, bp.rounds, {0} };
+    for (int k = 0; k < bp.rounds; k++) {
+        double t = now_ms();
+        save_hackpad(&nb, file);
+        r->ms[k] = now_ms() - t;
+    }
+
+    setenv("HACKPAD_SNAPSHOT", "1", 1);
+    r = &res[nres++];
+    *r = (BenchResult){ "write_hpb", total_entries, bp.rounds, {0} };
+    for (int k = 0; k < bp.rounds; k++) {
+        double t = now_ms();
+        write_hpb(&nb, file);
+        r->ms[k] = now_ms() - t;
+    }
+
+    r = &res[nres++];
+    *r = (BenchResult){ "load_hpb", total_entries, bp.rounds, {0} };
+    for (int k = 0; k < bp.rounds; k++) {
+        reset_notebook(&nb);
+        double t = now_ms();
+        load_hackpad(&nb, file);
+        r->ms[k] = now_ms() - t;
+    }
+    if (!nb.hpb_map) fprintf(stderr, "warning: load_hpb fell back to markdown\n");
+
+    int *vis = (int*)malloc(((size_t)nb.entry_slots + 1) * sizeof(int));
+    if (!vis) return 1;
+    long seen = 0;
+    r = &res[nres++];
+    *r = (BenchResult){ "visible", total_entries, bp.rounds, {0} };
+    for (int k = 0; k < bp.rounds; k++) {
+        double t = now_ms();
+        seen = 0;
+        for (int si = 0; si < nb.section_count; si++)
+            seen += build_visible_entries(&nb, nb.sections[si].id, vis, nb.entry_slots);
+        r->ms[k] = now_ms() - t;
+    }
+
+    if (set_filter(&nb, bp.filter) != HP_OK) { fprintf(stderr, "bad --filter\n"); return 2; }
+    long matched = 0;
+    r = &res[nres++];
+    *r = (BenchResult){ "filter", total_entries, bp.rounds, {0} };
+    for (int k = 0; k < bp.rounds; k++) {
+        double t = now_ms();
+        matched = 0;
+        for (int i = 0; i < nb.entry_slots; i++)
+            if (entry_live(&nb, i)) matched += entry_matches_filter(&nb, i);
+        r->ms[k] = now_ms() - t;
+    }
+    set_filter(&nb, "");
+
+    /* one round each: these change the notebook */
+    int inserts = total_entries / 10 > 0 ? total_entries / 10 : 1;
+    if (inserts > 100000) inserts = 100000;
+    r = &res[nres++];
+    *r = (BenchResult){ "insert", inserts, 1, {0} };
+    for (int n = 0; n < inserts; n++) {
+        int si = (int)rnd((unsigned)nb.section_count);
+        int after = -1;
+        int slot = nb.entry_slots ? (int)rnd((unsigned)nb.entry_slots) : -1;
+        if (slot >= 0 && entry_live(&nb, slot)) {
+            after = slot;
+            si = find_section_index_by_id(&nb, nb.entries[slot].section_id);
+        }
+        Entry e;
+        memset(&e, 0, sizeof(e));
+        e.id = nb.next_entry_id++;
+        e.section_id = nb.sections[si].id;
+        e.parent_id = -1;
+        if (!entry_set_text(&nb, &e, "inserted by hackpad_bench #bench")) return 1;
+        EntryHot h = { after >= 0 ? nb.cols.depth[after] : 0, 0, 0, 0, PRIORITY_NONE, HP_COLOR_NONE };
+        double t = now_ms();
+        insert_entry_at(&nb, after, &e, &h);
+        r->ms[0] += now_ms() - t;
+    }
+
+    int deletes = nb.section_count / 4 > 0 ? nb.section_count / 4 : 1;
+    r = &res[nres++];
+    *r = (BenchResult){ "delete_section", deletes, 1, {0} };
+    for (int n = 0; n < deletes && nb.section_count > 0; n++) {
+        int si = (int)rnd((unsigned)nb.section_count);
+        double t = now_ms();
+        journal_section(&nb, '-', si);
+        remove_section_subtree(&nb, si);
+        r->ms[0] += now_ms() - t;
+    }
+
+    printf("{\n");
+    printf("  \"bench\": \"hackpad\",\n");
+    printf("  \"params\": {\"sections\": %d, \"entries_per_section\": %d, \"section_depth\": %d, \"depth\": %d, "
+           "\"tags\": %d, \"tag_pool\": %d, \"done_pct\": %d, \"rounds\": %d, \"seed\": %lu, \"filter\": \"",
+           bp.sections, bp.entries, bp.section_depth, bp.depth, bp.tags, bp.tag_pool, bp.done_pct,
+           bp.rounds, bp.seed);
+    for (const char *p = bp.filter; *p; p++) {
+        if (*p == '"' || *p == '\\') putchar('\\');
+        putchar(*p);
+    }
+    printf("\"},\n");
+    printf("  \"notebook\": {\"entries\": %d, \"tags\": %d, \"visible\": %ld, \"filter_matches\": %ld},\n",
+           total_entries, nb.tags.count, seen, matched);
+    printf("  \"results\": [\n");
+    fprintf(stderr, "%d sections, %d entries, %d tags\n", bp.sections, total_entries, nb.tags.count);
+    for (int i = 0; i < nres; i++) json_result(&res[i], i == nres - 1);
+    printf("  ]\n}\n");
+
+    free(vis);
+    reset_notebook(&nb);
+    if (!bp.file) {
+        unlink(file);
+        unlink(hpb);
+    }
+    return 0;
+}
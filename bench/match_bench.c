@@ -0,0 +1,183 @@
+/*  match_bench - throughput of HackPad's case-insensitive substring matchers
+
+    Compile (from the repository root):
+      make match_bench
+
+    Usage:
+      ./match_bench [notebook.md] [rounds]
+
+    Without a notebook it generates a corpus of pentest-style notes (hosts,
+    credentials, exploits, URLs). Each needle is searched in every entry
+    text; the old strncasecmp loop, the scalar matcher and each vector
+    matcher the CPU supports are timed and must agree on every result.
+*/
+
+#define _XOPEN_SOURCE 700
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "../hackpad_core_internal.h"
+
+/* the strncasecmp loop the filter used before the vector matchers */
+static char *strcasestr_naive(const char *haystack, const char *needle) {
+    if (!haystack || !needle) return NULL;
+    if (!*needle) return (char *)haystack;
+
+    size_t nlen = strlen(needle);
+    for (const char *p = haystack; *p; p++) {
+        if (strncasecmp(p, needle, nlen) == 0) return (char *)p;
+    }
+    return NULL;
+}
+
+static double now_s(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static unsigned long rng_state = 12345;
+
+static unsigned rnd(unsigned n) {
+    rng_state = rng_state * 6364136223846793005UL + 1442695040888963407UL;
+    return (unsigned)((rng_state >> 33) % n);
+}
+
+static void generate_corpus(HackPad *nb, int count) {
+    static const char *os[] = {"Linux", "Windows Server 2019", "FreeBSD", "Ubuntu 22.04"};
+    static const char *svc[] = {"SMB", "HTTP", "SSH", "RDP", "MSSQL", "LDAP", "WinRM"};
+    static const char *user[] = {"Administrator", "svc_backup", "j.smith", "sqladmin", "krbtgt"};
+
+    Section *s = append_section(nb);
+    s->id = nb->next_section_id++;
+    strcpy(s->name, "Corpus");
+
+    char buf[512];
+    for (int i = 0; i < count; i++) {
+        switch (rnd(4)) {
+            case 0:
+                snprintf(buf, sizeof(buf), "IP: 10.%u.%u.%u | Hostname: host%u.corp.local | OS: %s | Ports: 22,80,443,%u",
+                         rnd(256), rnd(256), rnd(256), rnd(100000), os[rnd(4)], 1024 + rnd(60000));
+                break;
+            case 1:
+                snprintf(buf, sizeof(buf), "Username: %s | Password: Summer%u! | Hash: %08x%08x%08x%08x | Service: %s",
+                         user[rnd(5)], 2000 + rnd(30), rnd(~0u), rnd(~0u), rnd(~0u), rnd(~0u), svc[rnd(7)]);
+                break;
+            case 2:
+                snprintf(buf, sizeof(buf), "CVE: CVE-%u-%u | Target: 10.%u.%u.%u | Payload: windows/x64/meterpreter/reverse_tcp | Success: %s",
+                         2015 + rnd(10), 1000 + rnd(40000), rnd(256), rnd(256), rnd(256), rnd(2) ? "yes" : "no");
+                break;
+            default:
+                snprintf(buf, sizeof(buf), "http://10.%u.%u.%u:%u/admin/login.php?user=%s found via gobuster, %s exposed",
+                         rnd(256), rnd(256), rnd(256), 8000 + rnd(100), user[rnd(5)], svc[rnd(7)]);
+                break;
+        }
+        EntryHot h = { 0, 0, 0, 0, PRIORITY_NONE, HP_COLOR_NONE };
+        Entry *e = append_entry(nb, s, &h);
+        e->id = nb->next_entry_id++;
+        e->section_id = s->id;
+        entry_set_text(nb, e, buf);
+    }
+}
+
+typedef struct {
+    const char *name;
+    MemcasememFn fn;        /* NULL = strcasestr_naive */
+} Matcher;
+
+int main(int argc, char *argv[]) {
+    HackPad nb;
+    memset(&nb, 0, sizeof(nb));
+    nb.next_section_id = 1;
+    nb.next_entry_id = 1;
+    nb.journal_fd = -1;
+
+    if (argc > 1) load_hackpad(&nb, argv[1]);
+    else generate_corpus(&nb, 200000);
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    if (nb.entry_count == 0) { fprintf(stderr, "no entries\n"); return 1; }
+
+    size_t bytes = 0;
+    for (int i = 0; i < nb.entry_count; i++) bytes += (size_t)nb.entries[i].text_len;
+
+    Matcher matchers[4];
+    int nm = 0;
+    matchers[nm++] = (Matcher){"strncasecmp loop", NULL};
+    matchers[nm++] = (Matcher){"scalar", memcasemem_scalar};
+#ifdef HACKPAD_X86_SIMD
+    matchers[nm++] = (Matcher){"sse2", memcasemem_sse2};
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) matchers[nm++] = (Matcher){"avx2", memcasemem_avx2};
+#endif
+
+    const char *needles[] = {"10.13.37.1", "administrator", "cve-2021", "meterpreter", "PASSWORD", "x", "zzz-not-there"};
+    int nn = (int)(sizeof(needles) / sizeof(needles[0]));
+
+    printf("%d entries, %.1f MB of text, %d rounds\n\n", nb.entry_count, bytes / 1e6, rounds);
+    printf("%-16s", "needle");
+    for (int m = 0; m < nm; m++) printf(" %18s", matchers[m].name);
+    printf("   (MB/s)\n");
+
+    for (int k = 0; k < nn; k++) {
+        const char *needle = needles[k];
+        size_t nlen = strlen(needle);
+        long ref_hits = -1;
+        long ref_sum = 0;
+
+        printf("%-16s", needle);
+        for (int m = 0; m < nm; m++) {
+            long hits = 0, sum = 0;
+            double t = now_s();
+            for (int r = 0; r < rounds; r++) {
+                hits = sum = 0;
+                for (int i = 0; i < nb.entry_count; i++) {
+                    const Entry *e = &nb.entries[i];
+                    const char *p = matchers[m].fn ? matchers[m].fn(e->text, (size_t)e->text_len, needle, nlen)
+                                                   : strcasestr_naive(e->text, needle);
+                    if (nlen > (size_t)e->text_len && matchers[m].fn) p = NULL;
+                    if (p) { hits++; sum += p - e->text; }
+                }
+            }
+            double dt = now_s() - t;
+            if (ref_hits < 0) { ref_hits = hits; ref_sum = sum; }
+            else if (hits != ref_hits || sum != ref_sum) {
+                printf("\nMISMATCH: %s found %ld (pos sum %ld), expected %ld (%ld)\n",
+                       matchers[m].name, hits, sum, ref_hits, ref_sum);
+                return 1;
+            }
+            printf(" %18.0f", (double)bytes * rounds / dt / 1e6);
+        }
+        printf("   %ld hits\n", ref_hits);
+    }
+
+    /* the same text as one long haystack (a raw notes file), needle absent */
+    char *all = (char*)malloc(bytes + (size_t)nb.entry_count + 1);
+    if (!all) return 1;
+    size_t len = 0;
+    for (int i = 0; i < nb.entry_count; i++) {
+        memcpy(all + len, nb.entries[i].text, (size_t)nb.entries[i].text_len);
+        len += (size_t)nb.entries[i].text_len;
+        all[len++] = '\n';
+    }
+    all[len] = '\0';
+
+    printf("\n%-16s", "one haystack");
+    for (int m = 0; m < nm; m++) {
+        const char *needle = "zzz-not-there";
+        double t = now_s();
+        for (int r = 0; r < rounds; r++) {
+            const char *p = matchers[m].fn ? matchers[m].fn(all, len, needle, strlen(needle))
+                                           : strcasestr_naive(all, needle);
+            if (p) { printf("\nMISMATCH: %s found a match\n", matchers[m].name); return 1; }
+        }
+        printf(" %18.0f", (double)len * rounds / (now_s() - t) / 1e6);
+    }
+    printf("\n");
+
+    free(all);
+    free_hackpad(&nb);
+    return 0;
+}
@@ -1,13 +1,36 @@
 /*  HackPad - A simple note-taking application 
     created for penetration testers.
-    can be compiled with: gcc HackPad.c -lncurses -o HackPad
+    can be compiled with: gcc hackpad.c hackpad_batch.c hackpad_scan.c hackpad_core.c -lncurses -lpthread -o HackPad
     Copyright (C) 2025  <Kasem Shibli> <kasem545@proton.me>
 
+    This file is the ncurses frontend; the notebook itself (model, load/save,
+    journal, undo, filters, search, edits) is hackpad_core.c, see
+    hackpad_core.h for its API.
+
     Compile:
-      gcc HackPad.c -lncurses -o HackPad
+      gcc hackpad.c hackpad_batch.c hackpad_scan.c hackpad_core.c -lncurses -lpthread -o HackPad
 
     Usage:
       ./HackPad [file.md]
+      ./HackPad --batch file.md [command args...]   (no terminal, see hackpad_batch.c)
+
+    Autosave:
+      Unsaved changes are written in the background every 30 seconds.
+      HACKPAD_AUTOSAVE=<seconds> changes the interval, 0 disables it.
+
+    Journal:
+      Every change is also appended to <file>.journal right away and replayed
+      on the next start, so a crash loses nothing. Saving folds it into the
+      markdown; quitting saves without asking.
+
+    Snapshot:
+      Saving also writes <file>.hpb, a binary copy that is loaded instead of
+      the markdown while the two match. HACKPAD_SNAPSHOT=0 stops writing it.
+
+    Undo:
+      u undoes the last change, U redoes it. The history keeps up to
+      HACKPAD_UNDO_KB kilobytes (default 4096); 0 turns undo off and brings
+      back the delete confirmations.
 
     Keys (main):
       ?         Help (press ? or ESC to close help)
@@ -16,6 +39,9 @@
       N         New section (same level, inserted after selected section subtree)
       B         New sub-section (child, inserted after selected section subtree)
       D         Delete section/entry (depending focus)
+      K         Bulk delete: completed entries, entries matching a filter, or
+                archive the section subtree to <file>.archive
+      u / U     Undo / redo
       O         Collapse/expand section or entry (depending focus)
 
       A         Add entry (top-level, inserted after selected entry subtree)
@@ -26,8 +52,11 @@
       C         Set color (entry when focus entries, section when focus sections)
       X         Toggle complete
       *         Pin/unpin entry
-      F         Filter by tag
-      V         View mode (all/tag/priority/completed/incomplete)
+      /         Search all sections (text and tags), jump to a result
+      F         Filter: all words must hold, e.g. #smb & !#tested p:0-1 is:open
+                color:red mod:<7d "admin" (tags take & | ! and ( ), see viewq_compile)
+      #         Tag browser with entry counts; pick a tag to filter on it
+      V         View mode: add one filter predicate (tags/priority/done/pin/color/age/text)
       R         Reset filters
       M         Toggle timestamps
       Y         Export current section to markdown
@@ -37,8 +66,6 @@
 
 */
 
-// Plese Note: If there is segmente fault when running, try increasing stack size limit in terminal with `ulimit -s unlimited`
-
 #define _XOPEN_SOURCE 700
 #include <ncurses.h>
 #include <string.h>
@@ -48,131 +75,55 @@
 #include <time.h>
 #include <strings.h>
 
-/* ---------------- Limits ---------------- */
-
-#define MAX_SECTIONS  96
-#define MAX_ENTRIES   8192
-#define MAX_TEXT      1024
-#define MAX_NAME      128
-#define MAX_TAGS      8
-#define MAX_TAG_LEN   32
-
-/* ---------------- Portable strcasestr fallback ---------------- */
-
-static char *hackpad_strcasestr(const char *haystack, const char *needle) {
-    if (!haystack || !needle) return NULL;
-    if (!*needle) return (char *)haystack;
-
-    size_t nlen = strlen(needle);
-    for (const char *p = haystack; *p; p++) {
-        if (strncasecmp(p, needle, nlen) == 0) return (char *)p;
-    }
-    return NULL;
-}
-
-#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
-  #ifndef strcasestr
-    #define strcasestr hackpad_strcasestr
-  #endif
-#elif !defined(_GNU_SOURCE)
-  #ifndef strcasestr
-    #define strcasestr hackpad_strcasestr
-  #endif
-#endif
-
-/* ---------------- Types ---------------- */
-
-typedef enum {
-    PRIORITY_NONE,
-    PRIORITY_LOW,
-    PRIORITY_MEDIUM,
-    PRIORITY_HIGH,
-    PRIORITY_CRITICAL
-} Priority;
-
-/* IMPORTANT: Do NOT name these COLOR_* (ncurses macros will explode your build). */
-typedef enum {
-    HP_COLOR_NONE = 0,
-    HP_COLOR_RED,
-    HP_COLOR_GREEN,
-    HP_COLOR_YELLOW,
-    HP_COLOR_ORANGE,   /* simulated via YELLOW+BOLD */
-    HP_COLOR_MAGENTA,
-    HP_COLOR_CYAN,
-    HP_COLOR_WHITE
-} UiColor;
-
-typedef enum {
-    FOCUS_SECTIONS,
-    FOCUS_ENTRIES
-} Focus;
-
-typedef enum {
-    VIEW_ALL,
-    VIEW_TAGGED,
-    VIEW_PRIORITY,
-    VIEW_COMPLETED,
-    VIEW_INCOMPLETE
-} ViewFilter;
+#include "hackpad_core.h"
 
-typedef struct {
-    int id;
-    int parent_id;
-    int depth;
-    int collapsed;
-    UiColor color;
-    char name[MAX_NAME];
-} Section;
+int batch_main(int argc, char *argv[]);     /* hackpad_batch.c */
 
-typedef struct {
-    int id;
-    int section_id;
-    int parent_id;
-    int depth;
-    int collapsed;
-
-    char text[MAX_TEXT];
-    char tags[MAX_TAGS][MAX_TAG_LEN];
-    int tag_count;
-    Priority priority;
-    UiColor color;
-    time_t created;
-    time_t modified;
-    int completed;
-    int pinned;
-} Entry;
+/* ---------------- Frontend state ---------------- */
 
+/* What a pane last put on screen, used to limit redraws to damaged rows */
 typedef struct {
-    Section sections[MAX_SECTIONS];
-    int section_count;
+    int valid;
+    int key;                /* section id shown (entries pane) */
+    unsigned long gen;
+    int scroll;
+    int sel_id;
+    int sel_pos;
+    int focused;
+    int rows, cols;
+} PaneState;
 
-    Entry entries[MAX_ENTRIES];
-    int entry_count;
+enum {
+    DIRTY_TOPBAR   = 1 << 0,
+    DIRTY_SECTIONS = 1 << 1,
+    DIRTY_ENTRIES  = 1 << 2,
+    DIRTY_FOOTERS  = 1 << 3,
+    DIRTY_ALL      = DIRTY_TOPBAR | DIRTY_SECTIONS | DIRTY_ENTRIES | DIRTY_FOOTERS
+};
 
-    int current_section_id;
-    int selected_entry_id;
+/* What the terminal UI keeps next to the notebook (HackPad.ui) */
+typedef struct Frontend {
+    /* windows, rebuilt on resize */
+    int sw;
+    WINDOW *secw, *entw;
+    WINDOW *secf, *entf;
+    WINDOW *helpw;
 
-    Focus focus;
+    /* first visible row of each pane, kept around the selection */
+    int sec_scroll;
+    int ent_scroll;
 
-    char filename[256];
-    time_t created_time;
+    /* damage tracking: DIRTY_* bits forcing a full repaint of that region;
+       selection-only changes are detected against *_drawn and patched per row */
+    int dirty;
+    PaneState sec_drawn;
+    PaneState ent_drawn;
 
-    ViewFilter filter;
-    char filter_tag[MAX_TAG_LEN];
-    Priority filter_priority;
+    char search_text[128];      /* last search, offered again */
 
     int show_timestamps;
     int show_help;
-
-    int next_section_id;
-    int next_entry_id;
-
-    /* UI windows (rebuilt on resize) */
-    int sw;
-    WINDOW *secw, *entw;
-    WINDOW *secf, *entf;
-    WINDOW *helpw;
-} HackPad;
+} Frontend;
 
 /* ---------------- Templates ---------------- */
 
@@ -240,17 +191,16 @@ static void status_msg(const char *msg) {
     mvprintw(LINES - 1, 0, "%s", msg);
     clrtoeol();
     if (has_colors()) attroff(COLOR_PAIR(CP_STATUS));
-    refresh();
+    wnoutrefresh(stdscr);   /* flushed with the next frame's doupdate() */
 }
 
-static const char* priority_str(Priority p) {
-    switch(p) {
-        case PRIORITY_CRITICAL: return "P0";
-        case PRIORITY_HIGH:     return "P1";
-        case PRIORITY_MEDIUM:   return "P2";
-        case PRIORITY_LOW:      return "P3";
-        default:                return "";
-    }
+/* Show what the core left in nb->error, if anything, and clear it */
+static void show_error(HackPad *nb) {
+    if (!nb->error[0]) return;
+    char msg[sizeof(nb->error) + 8];
+    snprintf(msg, sizeof(msg), "ERROR: %s", nb->error);
+    status_msg(msg);
+    nb->error[0] = '\0';
 }
 
 static int priority_color_pair(Priority p) {
@@ -263,19 +213,6 @@ static int priority_color_pair(Priority p) {
     }
 }
 
-static const char* color_str(UiColor c) {
-    switch(c) {
-        case HP_COLOR_RED:     return "RED";
-        case HP_COLOR_GREEN:   return "GREEN";
-        case HP_COLOR_YELLOW:  return "YELLOW";
-        case HP_COLOR_ORANGE:  return "ORANGE";
-        case HP_COLOR_MAGENTA: return "MAGENTA";
-        case HP_COLOR_CYAN:    return "CYAN";
-        case HP_COLOR_WHITE:   return "WHITE";
-        default:               return "";
-    }
-}
-
 static int color_pair(UiColor c) {
     switch(c) {
         case HP_COLOR_RED:     return CP_RED;
@@ -291,70 +228,6 @@ static int color_pair(UiColor c) {
 
 static int color_is_orange(UiColor c) { return c == HP_COLOR_ORANGE; }
 
-/* ---------------- Helpers ---------------- */
-
-static void trim_trailing_spaces(char *s) {
-    if (!s) return;
-    size_t n = strlen(s);
-    while (n > 0 && isspace((unsigned char)s[n - 1])) { s[n - 1] = '\0'; n--; }
-}
-
-static int count_leading_spaces(const char *s) {
-    int c = 0;
-    while (*s && *s == ' ') { c++; s++; }
-    return c;
-}
-
-static int count_heading_level(const char *s) {
-    int c = 0;
-    while (*s == '#') { c++; s++; }
-    return c;
-}
-
-static int find_section_index_by_id(HackPad *nb, int id) {
-    for (int i = 0; i < nb->section_count; i++)
-        if (nb->sections[i].id == id) return i;
-    return -1;
-}
-
-static int find_entry_index_by_id(HackPad *nb, int id) {
-    for (int i = 0; i < nb->entry_count; i++)
-        if (nb->entries[i].id == id) return i;
-    return -1;
-}
-
-/* Entry filter only (search removed by request) */
-static int entry_matches_filter(HackPad *nb, Entry *e) {
-    if (!nb || !e) return 0;
-
-    switch (nb->filter) {
-        case VIEW_TAGGED:
-            if (nb->filter_tag[0]) {
-                int found = 0;
-                for (int i = 0; i < e->tag_count; i++) {
-                    if (strcasecmp(e->tags[i], nb->filter_tag) == 0) { found = 1; break; }
-                }
-                if (!found) return 0;
-            } else {
-                if (e->tag_count == 0) return 0;
-            }
-            break;
-        case VIEW_PRIORITY:
-            if (e->priority != nb->filter_priority) return 0;
-            break;
-        case VIEW_COMPLETED:
-            if (!e->completed) return 0;
-            break;
-        case VIEW_INCOMPLETE:
-            if (e->completed) return 0;
-            break;
-        case VIEW_ALL:
-        default:
-            break;
-    }
-    return 1;
-}
-
 /* ---------------- Line editor / dialogs ---------------- */
 
 static int line_editor(const char *title, char *buf, int max_len) {
@@ -482,71 +355,6 @@ static int confirm_dialog(const char *msg) {
     return (ch == 'y' || ch == 'Y');
 }
 
-/* ---------------- Visible lists (respect collapse + order) ---------------- */
-
-static int build_visible_sections(HackPad *nb, int *out_idx, int max_out) {
-    int count = 0;
-    int collapse_depth = -1;
-
-    for (int i = 0; i < nb->section_count; i++) {
-        Section *s = &nb->sections[i];
-
-        if (collapse_depth >= 0) {
-            if (s->depth > collapse_depth) continue;
-            collapse_depth = -1;
-        }
-
-        if (count < max_out) out_idx[count++] = i;
-
-        if (s->collapsed) collapse_depth = s->depth;
-    }
-    return count;
-}
-
-static int build_visible_entries(HackPad *nb, int section_id, int *out_idx, int max_out) {
-    int count = 0;
-    int collapse_depth = -1;
-
-    for (int i = 0; i < nb->entry_count; i++) {
-        Entry *e = &nb->entries[i];
-        if (e->section_id != section_id) continue;
-        if (!entry_matches_filter(nb, e)) continue;
-
-        if (collapse_depth >= 0) {
-            if (e->depth > collapse_depth) continue;
-            collapse_depth = -1;
-        }
-
-        if (count < max_out) out_idx[count++] = i;
-
-        if (e->collapsed) collapse_depth = e->depth;
-    }
-    return count;
-}
-
-/* ---------------- Subtree end (for correct insertion) ---------------- */
-
-static int section_subtree_end_index(HackPad *nb, int sec_index) {
-    if (sec_index < 0 || sec_index >= nb->section_count) return sec_index;
-    int d = nb->sections[sec_index].depth;
-    int i = sec_index + 1;
-    while (i < nb->section_count && nb->sections[i].depth > d) i++;
-    return i - 1;
-}
-
-static int entry_subtree_end_index_in_section(HackPad *nb, int entry_index) {
-    if (entry_index < 0 || entry_index >= nb->entry_count) return entry_index;
-    int d = nb->entries[entry_index].depth;
-    int sid = nb->entries[entry_index].section_id;
-    int i = entry_index + 1;
-    while (i < nb->entry_count) {
-        if (nb->entries[i].section_id != sid) { i++; continue; }
-        if (nb->entries[i].depth <= d) break;
-        i++;
-    }
-    return i - 1;
-}
-
 /* ---------------- Draw ---------------- */
 
 static void draw_topbar(HackPad *nb) {
@@ -561,8 +369,8 @@ static void draw_topbar(HackPad *nb) {
     mvprintw(0, 9, "| %s | %s", nb->filename[0] ? nb->filename : "Untitled", secname);
 
     char flags[128] = {0};
-    if (nb->filter != VIEW_ALL) strcat(flags, " FILTER");
-    if (nb->show_timestamps) strcat(flags, " TS");
+    if (nb->filter.preds) strcat(flags, " FILTER");
+    if (nb->ui->show_timestamps) strcat(flags, " TS");
 
     int fl = (int)strlen(flags);
     if (fl > 0 && COLS > fl + 2) mvprintw(0, COLS - fl - 1, "%s", flags);
@@ -596,10 +404,14 @@ static void draw_help(WINDOW *w) {
     mvwprintw(w, y++, 4, "b : Add sub-entry (child of selected entry, after subtree)");
     mvwprintw(w, y++, 4, "E : Edit entry   T : Tags   P : Priority   C : Color");
     mvwprintw(w, y++, 4, "X : Done toggle  * : Pin    O : Collapse/expand entry");
+    mvwprintw(w, y++, 4, "K : Bulk delete (completed / by filter / archive section)");
+    mvwprintw(w, y++, 4, "u : Undo         U : Redo");
     y++;
     mvwprintw(w, y++, 2, "View / Filter:");
-    mvwprintw(w, y++, 4, "F : Filter by tag   V : View mode   R : Reset filters");
-    mvwprintw(w, y++, 4, "M : Toggle timestamps");
+    mvwprintw(w, y++, 4, "/ : Search all entries (text and tags)");
+    mvwprintw(w, y++, 4, "F : Filter (#a & !#b p:0-1 is:open color:red mod:<7d \"txt\")");
+    mvwprintw(w, y++, 4, "# : Tag browser");
+    mvwprintw(w, y++, 4, "V : View mode   R : Reset filters   M : Toggle timestamps");
     y++;
     mvwprintw(w, y++, 2, "File:");
     mvwprintw(w, y++, 4, "S : Save   W : Save as   Y : Export section   Q : Quit");
@@ -608,7 +420,27 @@ static void draw_help(WINDOW *w) {
     mvwprintw(w, y++, 2, "Close help: press ? or ESC");
     if (has_colors()) wattroff(w, COLOR_PAIR(CP_STATUS));
 
-    wrefresh(w);
+    wnoutrefresh(w);
+}
+
+/* Scroll offset that keeps sel_pos on screen, without leaving blank rows at the end */
+static int clamp_scroll(int scroll, int sel_pos, int count, int rows) {
+    if (rows < 1) rows = 1;
+    if (sel_pos >= 0) {
+        if (sel_pos < scroll) scroll = sel_pos;
+        if (sel_pos >= scroll + rows) scroll = sel_pos - rows + 1;
+    }
+    if (scroll > count - rows) scroll = count - rows;
+    if (scroll < 0) scroll = 0;
+    return scroll;
+}
+
+static void draw_scroll_marker(WINDOW *w, int scroll, int count, int rows, int sel_pos) {
+    if (count <= rows) return;
+    char buf[32];
+    snprintf(buf, sizeof(buf), " %d/%d ", sel_pos >= 0 ? sel_pos + 1 : scroll + 1, count);
+    int x = getmaxx(w) - (int)strlen(buf) - 2;
+    if (x > 1) mvwprintw(w, getmaxy(w) - 1, x, "%s", buf);
 }
 
 static void apply_color_attr(WINDOW *w, UiColor c, int selected) {
@@ -625,59 +457,194 @@ static void remove_color_attr(WINDOW *w, UiColor c, int selected) {
     if (color_is_orange(c)) wattroff(w, A_BOLD);
 }
 
-static void draw_sections(WINDOW *w, HackPad *nb) {
-    werase(w);
-    box(w, 0, 0);
+/* Blank a pane row between the borders before redrawing it in place */
+static void clear_pane_row(WINDOW *w, int row) {
+    mvwprintw(w, row, 1, "%*s", getmaxx(w) - 2, "");
+}
 
-    if (has_colors()) wattron(w, COLOR_PAIR(CP_HEADER) | A_BOLD);
-    mvwprintw(w, 0, 2, " SECTIONS ");
-    if (has_colors()) wattroff(w, COLOR_PAIR(CP_HEADER) | A_BOLD);
+/* Redraw the bottom border (and scroll marker) after a selection-only change */
+static void redraw_pane_bottom(WINDOW *w) {
+    mvwhline(w, getmaxy(w) - 1, 1, ACS_HLINE, getmaxx(w) - 2);
+}
 
-    /* heap visible list to avoid stack/ulimit issues */
-    int *vis = (int*)calloc((size_t)nb->section_count + 1, sizeof(int));
-    if (!vis) { mvwprintw(w, 1, 2, "OOM"); wrefresh(w); return; }
+/* Damage check: anything that changes more than the selected row forces a full pane repaint */
+static int pane_needs_full(PaneState *ps, WINDOW *w, int key, unsigned long gen, int scroll, int force) {
+    return force || !ps->valid || ps->key != key || ps->gen != gen || ps->scroll != scroll ||
+           ps->rows != getmaxy(w) || ps->cols != getmaxx(w);
+}
 
-    int vis_count = build_visible_sections(nb, vis, nb->section_count);
+static void pane_remember(PaneState *ps, WINDOW *w, int key, unsigned long gen, int scroll,
+                          int sel_id, int sel_pos, int focused) {
+    ps->valid = 1;
+    ps->key = key;
+    ps->gen = gen;
+    ps->scroll = scroll;
+    ps->sel_id = sel_id;
+    ps->sel_pos = sel_pos;
+    ps->focused = focused;
+    ps->rows = getmaxy(w);
+    ps->cols = getmaxx(w);
+}
+
+static void draw_section_row(WINDOW *w, HackPad *nb, Section *s, int row) {
+    int selected = (nb->focus == FOCUS_SECTIONS && s->id == nb->current_section_id);
+
+    if (selected) wattron(w, A_REVERSE);
+    apply_color_attr(w, s->color, selected);
+
+    int indent = s->depth * 2;
+    if (indent > 18) indent = 18;
+
+    char icon = s->collapsed ? '+' : '-';
+    char linebuf[256];
+    snprintf(linebuf, sizeof(linebuf), "%c %*s%s", icon, indent, "", s->name);
+
+    mvwprintw(w, row, 2, "%.*s", getmaxx(w) - 4, linebuf);
+
+    remove_color_attr(w, s->color, selected);
+    if (selected) wattroff(w, A_REVERSE);
+}
+
+static void draw_sections(WINDOW *w, HackPad *nb) {
+    PaneState *ps = &nb->ui->sec_drawn;
+
+    VisCache *vc = visible_sections(nb);
+    if (!vc) {
+        werase(w); box(w, 0, 0);
+        mvwprintw(w, 1, 2, "OOM");
+        ps->valid = 0;
+        wnoutrefresh(w);
+        return;
+    }
+    int *vis = vc->idx;
+    int vis_count = vc->count;
 
     if (find_section_index_by_id(nb, nb->current_section_id) < 0 && nb->section_count > 0)
         nb->current_section_id = nb->sections[0].id;
 
     int max_y = getmaxy(w) - 2;
-    int row = 1;
+    int focused = nb->focus == FOCUS_SECTIONS;
+
+    int sel_pos = vis_section_pos(nb, vc, nb->current_section_id);
+    nb->ui->sec_scroll = clamp_scroll(nb->ui->sec_scroll, sel_pos, vis_count, max_y);
+
+    if (pane_needs_full(ps, w, 0, nb->view_gen, nb->ui->sec_scroll, nb->ui->dirty & DIRTY_SECTIONS)) {
+        werase(w);
+        box(w, 0, 0);
+
+        if (has_colors()) wattron(w, COLOR_PAIR(CP_HEADER) | A_BOLD);
+        mvwprintw(w, 0, 2, " SECTIONS ");
+        if (has_colors()) wattroff(w, COLOR_PAIR(CP_HEADER) | A_BOLD);
+
+        /* only the rows inside the viewport are formatted */
+        int row = 1;
+        for (int i = nb->ui->sec_scroll; i < vis_count && row <= max_y; i++, row++)
+            draw_section_row(w, nb, &nb->sections[vis[i]], row);
+    } else if (ps->sel_id != nb->current_section_id || ps->focused != focused) {
+        /* row-level damage: old and new selection only */
+        int rows[2] = { ps->sel_pos, sel_pos };
+        for (int k = 0; k < 2; k++) {
+            int i = rows[k];
+            if (i < nb->ui->sec_scroll || i >= vis_count || i >= nb->ui->sec_scroll + max_y) continue;
+            clear_pane_row(w, 1 + i - nb->ui->sec_scroll);
+            draw_section_row(w, nb, &nb->sections[vis[i]], 1 + i - nb->ui->sec_scroll);
+        }
+        redraw_pane_bottom(w);
+    } else {
+        return;
+    }
+
+    draw_scroll_marker(w, nb->ui->sec_scroll, vis_count, max_y, sel_pos);
+    pane_remember(ps, w, 0, nb->view_gen, nb->ui->sec_scroll, nb->current_section_id, sel_pos, focused);
+    wnoutrefresh(w);
+}
+
+static void draw_entry_row(WINDOW *w, HackPad *nb, Entry *e, int row) {
+    int selected = (nb->focus == FOCUS_ENTRIES && e->id == nb->selected_entry_id);
+    EntryHot h = entry_hot(nb, (int)(e - nb->entries));
 
-    for (int i = 0; i < vis_count && row <= max_y; i++, row++) {
-        Section *s = &nb->sections[vis[i]];
-        int selected = (nb->focus == FOCUS_SECTIONS && s->id == nb->current_section_id);
+    if (selected) wattron(w, A_REVERSE);
 
-        if (selected) wattron(w, A_REVERSE);
-        apply_color_attr(w, s->color, selected);
+    int x = 2;
 
-        int indent = s->depth * 2;
-        if (indent > 18) indent = 18;
+    int indent = h.depth * 2;
+    if (indent > 18) indent = 18;
 
-        char icon = s->collapsed ? '+' : '-';
-        char linebuf[256];
-        snprintf(linebuf, sizeof(linebuf), "%c %*s%s", icon, indent, "", s->name);
+    char fold = h.collapsed ? '+' : '-';
+    mvwprintw(w, row, x, "%c %*s", fold, indent, "");
+    x += 2 + indent;
 
-        mvwprintw(w, row, 2, "%.*s", getmaxx(w) - 4, linebuf);
+    if (h.pinned) {
+        if (has_colors() && !selected) wattron(w, COLOR_PAIR(CP_PIN) | A_BOLD);
+        mvwprintw(w, row, x, "* ");
+        if (has_colors() && !selected) wattroff(w, COLOR_PAIR(CP_PIN) | A_BOLD);
+    } else {
+        mvwprintw(w, row, x, "  ");
+    }
+    x += 2;
 
-        remove_color_attr(w, s->color, selected);
-        if (selected) wattroff(w, A_REVERSE);
+    if (h.priority != PRIORITY_NONE) {
+        if (has_colors() && !selected) wattron(w, COLOR_PAIR(priority_color_pair(h.priority)) | A_BOLD);
+        mvwprintw(w, row, x, "[%s] ", priority_str(h.priority));
+        if (has_colors() && !selected) wattroff(w, COLOR_PAIR(priority_color_pair(h.priority)) | A_BOLD);
+        x += 5;
     }
 
-    free(vis);
-    wrefresh(w);
+    if (h.completed && has_colors() && !selected) wattron(w, COLOR_PAIR(CP_DIM));
+    mvwprintw(w, row, x, "%s ", h.completed ? "[x]" : "[ ]");
+    x += 4;
+
+    int max_text_len = getmaxx(w) - x - 22;
+    if (max_text_len < 10) max_text_len = 10;
+
+    int shown_len = e->text_len;
+    apply_color_attr(w, h.color, selected);
+    if (shown_len > max_text_len) {
+        shown_len = max_text_len;
+        mvwprintw(w, row, x, "%.*s...", max_text_len - 3, e->text);
+    } else {
+        mvwprintw(w, row, x, "%s", e->text);
+    }
+
+    if (h.completed && has_colors() && !selected) wattroff(w, COLOR_PAIR(CP_DIM));
+
+    if (e->tag_count > 0 && getmaxx(w) > 40) {
+        int tag_x = getmaxx(w) - 20;
+        if (tag_x > x + shown_len + 2) {
+            if (has_colors() && !selected) wattron(w, COLOR_PAIR(CP_TAG));
+            int shown = 0;
+            for (int t = 0; t < e->tag_count && shown < 2; t++, shown++) {
+                const char *tn = tag_name(nb, e->tags[t]);
+                mvwprintw(w, row, tag_x, "#%s", tn);
+                tag_x += (int)strlen(tn) + 2;
+            }
+            if (e->tag_count > 2) mvwprintw(w, row, tag_x, "+%d", e->tag_count - 2);
+            if (has_colors() && !selected) wattroff(w, COLOR_PAIR(CP_TAG));
+        }
+    }
+
+    if (nb->ui->show_timestamps && getmaxx(w) > 25) {
+        char timestr[32] = {0};
+        struct tm *tm = localtime(&e->modified);
+        if (tm) {
+            strftime(timestr, sizeof(timestr), "%m/%d %H:%M", tm);
+            mvwprintw(w, row, getmaxx(w) - 13, "%s", timestr);
+        }
+    }
+
+    remove_color_attr(w, h.color, selected);
+    if (selected) wattroff(w, A_REVERSE);
 }
 
-static void draw_entries(WINDOW *w, HackPad *nb) {
+/* Header and placeholder text; returns the section to list, or NULL */
+static Section *draw_entries_frame(WINDOW *w, HackPad *nb) {
     werase(w);
     box(w, 0, 0);
 
     int si = find_section_index_by_id(nb, nb->current_section_id);
     if (si < 0) {
         mvwprintw(w, 1, 2, "No section selected");
-        wrefresh(w);
-        return;
+        return NULL;
     }
 
     Section *sec = &nb->sections[si];
@@ -688,14 +655,35 @@ static void draw_entries(WINDOW *w, HackPad *nb) {
 
     if (sec->collapsed) {
         mvwprintw(w, 1, 2, "[Section collapsed - press O to expand]");
-        wrefresh(w);
+        return NULL;
+    }
+    return sec;
+}
+
+static void draw_entries(WINDOW *w, HackPad *nb) {
+    PaneState *ps = &nb->ui->ent_drawn;
+    int si = find_section_index_by_id(nb, nb->current_section_id);
+
+    if (si < 0 || nb->sections[si].collapsed) {
+        if (pane_needs_full(ps, w, nb->current_section_id, nb->view_gen, 0, nb->ui->dirty & DIRTY_ENTRIES)) {
+            draw_entries_frame(w, nb);
+            pane_remember(ps, w, nb->current_section_id, nb->view_gen, 0, -1, -1, 0);
+            wnoutrefresh(w);
+        }
         return;
     }
 
-    /* heap visible list to avoid stack/ulimit issues */
-    int *vis = (int*)calloc((size_t)nb->entry_count + 1, sizeof(int));
-    if (!vis) { mvwprintw(w, 1, 2, "OOM"); wrefresh(w); return; }
-    int vis_count = build_visible_entries(nb, sec->id, vis, nb->entry_count);
+    Section *sec = &nb->sections[si];
+    VisCache *vc = visible_entries(nb, sec->id);
+    if (!vc) {
+        draw_entries_frame(w, nb);
+        mvwprintw(w, 1, 2, "OOM");
+        ps->valid = 0;
+        wnoutrefresh(w);
+        return;
+    }
+    int *vis = vc->idx;
+    int vis_count = vc->count;
 
     if (vis_count == 0) nb->selected_entry_id = -1;
     if (nb->selected_entry_id != -1) {
@@ -705,89 +693,35 @@ static void draw_entries(WINDOW *w, HackPad *nb) {
     if (nb->selected_entry_id == -1 && vis_count > 0) nb->selected_entry_id = nb->entries[vis[0]].id;
 
     int max_y = getmaxy(w) - 2;
-    int row = 1;
-
-    for (int i = 0; i < vis_count && row <= max_y; i++, row++) {
-        Entry *e = &nb->entries[vis[i]];
-        int selected = (nb->focus == FOCUS_ENTRIES && e->id == nb->selected_entry_id);
-
-        if (selected) wattron(w, A_REVERSE);
-
-        int x = 2;
-
-        int indent = e->depth * 2;
-        if (indent > 18) indent = 18;
-
-        char fold = e->collapsed ? '+' : '-';
-        mvwprintw(w, row, x, "%c %*s", fold, indent, "");
-        x += 2 + indent;
-
-        if (e->pinned) {
-            if (has_colors() && !selected) wattron(w, COLOR_PAIR(CP_PIN) | A_BOLD);
-            mvwprintw(w, row, x, "* ");
-            if (has_colors() && !selected) wattroff(w, COLOR_PAIR(CP_PIN) | A_BOLD);
-        } else {
-            mvwprintw(w, row, x, "  ");
-        }
-        x += 2;
-
-        if (e->priority != PRIORITY_NONE) {
-            if (has_colors() && !selected) wattron(w, COLOR_PAIR(priority_color_pair(e->priority)) | A_BOLD);
-            mvwprintw(w, row, x, "[%s] ", priority_str(e->priority));
-            if (has_colors() && !selected) wattroff(w, COLOR_PAIR(priority_color_pair(e->priority)) | A_BOLD);
-            x += 5;
-        }
-
-        if (e->completed && has_colors() && !selected) wattron(w, COLOR_PAIR(CP_DIM));
-        mvwprintw(w, row, x, "%s ", e->completed ? "[x]" : "[ ]");
-        x += 4;
-
-        int max_text_len = getmaxx(w) - x - 22;
-        if (max_text_len < 10) max_text_len = 10;
-
-        char display_text[MAX_TEXT];
-        memset(display_text, 0, sizeof(display_text));
-        if ((int)strlen(e->text) > max_text_len) {
-            strncpy(display_text, e->text, (size_t)(max_text_len - 3));
-            display_text[max_text_len - 3] = '\0';
-            strcat(display_text, "...");
-        } else {
-            strncpy(display_text, e->text, MAX_TEXT - 1);
-        }
-        apply_color_attr(w, e->color, selected);
-        mvwprintw(w, row, x, "%s", display_text);
-
-        if (e->completed && has_colors() && !selected) wattroff(w, COLOR_PAIR(CP_DIM));
-
-        if (e->tag_count > 0 && getmaxx(w) > 40) {
-            int tag_x = getmaxx(w) - 20;
-            if (tag_x > x + (int)strlen(display_text) + 2) {
-                if (has_colors() && !selected) wattron(w, COLOR_PAIR(CP_TAG));
-                int shown = 0;
-                for (int t = 0; t < e->tag_count && shown < 2; t++, shown++) {
-                    mvwprintw(w, row, tag_x, "#%s", e->tags[t]);
-                    tag_x += (int)strlen(e->tags[t]) + 2;
-                }
-                if (e->tag_count > 2) mvwprintw(w, row, tag_x, "+%d", e->tag_count - 2);
-                if (has_colors() && !selected) wattroff(w, COLOR_PAIR(CP_TAG));
-            }
-        }
-
-        if (nb->show_timestamps && getmaxx(w) > 25) {
-            char timestr[32] = {0};
-            struct tm *tm = localtime(&e->modified);
-            if (tm) {
-                strftime(timestr, sizeof(timestr), "%m/%d %H:%M", tm);
-                mvwprintw(w, row, getmaxx(w) - 13, "%s", timestr);
-            }
+    int focused = nb->focus == FOCUS_ENTRIES;
+
+    int sel_pos = nb->selected_entry_id != -1 ? vis_entry_pos(nb, vc, nb->selected_entry_id) : -1;
+    nb->ui->ent_scroll = clamp_scroll(nb->ui->ent_scroll, sel_pos, vis_count, max_y);
+
+    if (pane_needs_full(ps, w, sec->id, nb->view_gen, nb->ui->ent_scroll, nb->ui->dirty & DIRTY_ENTRIES)) {
+        draw_entries_frame(w, nb);
+
+        /* only the rows inside the viewport are formatted */
+        int row = 1;
+        for (int i = nb->ui->ent_scroll; i < vis_count && row <= max_y; i++, row++)
+            draw_entry_row(w, nb, &nb->entries[vis[i]], row);
+    } else if (ps->sel_id != nb->selected_entry_id || ps->focused != focused) {
+        /* row-level damage: old and new selection only */
+        int rows[2] = { ps->sel_pos, sel_pos };
+        for (int k = 0; k < 2; k++) {
+            int i = rows[k];
+            if (i < nb->ui->ent_scroll || i >= vis_count || i >= nb->ui->ent_scroll + max_y) continue;
+            clear_pane_row(w, 1 + i - nb->ui->ent_scroll);
+            draw_entry_row(w, nb, &nb->entries[vis[i]], 1 + i - nb->ui->ent_scroll);
         }
-
-        remove_color_attr(w, e->color, selected);
-        if (selected) wattroff(w, A_REVERSE);
+        redraw_pane_bottom(w);
+    } else {
+        return;
     }
 
-    free(vis);
-    wrefresh(w);
+    draw_scroll_marker(w, nb->ui->ent_scroll, vis_count, max_y, sel_pos);
+    pane_remember(ps, w, sec->id, nb->view_gen, nb->ui->ent_scroll, nb->selected_entry_id, sel_pos, focused);
+    wnoutrefresh(w);
 }
 
 static void draw_sections_footer(WINDOW *w, HackPad *nb) {
@@ -797,7 +731,7 @@ static void draw_sections_footer(WINDOW *w, HackPad *nb) {
     mvwprintw(w, 0, 1, "N new  B sub  O fold  D del  C color");
     if (nb->focus == FOCUS_SECTIONS) wattroff(w, A_BOLD);
     if (has_colors()) wattroff(w, COLOR_PAIR(CP_STATUS));
-    wrefresh(w);
+    wnoutrefresh(w);
 }
 
 static void draw_entries_footer(WINDOW *w, HackPad *nb) {
@@ -807,254 +741,28 @@ static void draw_entries_footer(WINDOW *w, HackPad *nb) {
     mvwprintw(w, 0, 1, "A add  b sub  E edit  T tag  P pri  C color  X done  * pin");
     if (nb->focus == FOCUS_ENTRIES) wattroff(w, A_BOLD);
     if (has_colors()) wattroff(w, COLOR_PAIR(CP_STATUS));
-    wrefresh(w);
+    wnoutrefresh(w);
 }
 
-/* ---------------- Save / Load ---------------- */
-
-static UiColor parse_color_badge(const char *txt) {
-    if (!txt) return HP_COLOR_NONE;
-    if (strstr(txt, "[RED]"))     return HP_COLOR_RED;
-    if (strstr(txt, "[GREEN]"))   return HP_COLOR_GREEN;
-    if (strstr(txt, "[YELLOW]"))  return HP_COLOR_YELLOW;
-    if (strstr(txt, "[ORANGE]"))  return HP_COLOR_ORANGE;
-    if (strstr(txt, "[MAGENTA]")) return HP_COLOR_MAGENTA;
-    if (strstr(txt, "[CYAN]"))    return HP_COLOR_CYAN;
-    if (strstr(txt, "[WHITE]"))   return HP_COLOR_WHITE;
-    return HP_COLOR_NONE;
-}
-
-static void save_hackpad(HackPad *nb, const char *file) {
-    FILE *f = fopen(file, "w");
-    if (!f) { status_msg("ERROR: Could not save file!"); return; }
-
-    time_t now = time(NULL);
-
-    fprintf(f, "# HackPad Modern\n");
-    fprintf(f, "Created: %s", ctime(&nb->created_time));
-    fprintf(f, "Modified: %s\n", ctime(&now));
-
-    for (int i = 0; i < nb->section_count; i++) {
-        Section *s = &nb->sections[i];
-
-        int level = 2 + s->depth;
-        for (int k = 0; k < level; k++) fputc('#', f);
-        fprintf(f, " %s%s", s->name, s->collapsed ? " [COLLAPSED]" : "");
-        if (s->color != HP_COLOR_NONE) fprintf(f, " [%s]", color_str(s->color));
-        fprintf(f, "\n\n");
-
-        for (int j = 0; j < nb->entry_count; j++) {
-            Entry *e = &nb->entries[j];
-            if (e->section_id != s->id) continue;
-
-            int indent = e->depth * 2;
-            for (int sp = 0; sp < indent; sp++) fputc(' ', f);
-
-            fprintf(f, "- %s %s", e->completed ? "[x]" : "[ ]", e->text);
-
-            if (e->tag_count > 0) {
-                fprintf(f, " #");
-                for (int t = 0; t < e->tag_count; t++) {
-                    fprintf(f, "%s", e->tags[t]);
-                    if (t < e->tag_count - 1) fprintf(f, " #");
-                }
-            }
-
-            fprintf(f, " {created:%ld,modified:%ld}", (long)e->created, (long)e->modified);
-
-            if (e->priority != PRIORITY_NONE) fprintf(f, " [%s]", priority_str(e->priority));
-            if (e->color != HP_COLOR_NONE) fprintf(f, " [%s]", color_str(e->color));
-            if (e->pinned) fprintf(f, " [PIN]");
-            if (e->collapsed) fprintf(f, " [COLLAPSED]");
-
-            fprintf(f, "\n");
-        }
-        fprintf(f, "\n");
+/* getch() that wakes up every second to drive autosave */
+static int next_key(HackPad *nb) {
+    for (;;) {
+        if (nb->autosave) timeout(1000);
+        int ch = getch();
+        timeout(-1);
+        if (ch != ERR) return ch;
+        autosave_tick(nb);
+        doupdate();
     }
-
-    fclose(f);
-    status_msg("Saved.");
-}
-
-static void load_hackpad(HackPad *nb, const char *file) {
-    FILE *f = fopen(file, "r");
-    if (!f) return;
-
-    char line[MAX_TEXT * 2];
-    int section_stack[32];
-    int stack_depth = 0;
-
-    int current_section_id = -1;
-
-    int entry_parent_at_depth[256];
-    for (int i = 0; i < 256; i++) entry_parent_at_depth[i] = -1;
-
-    while (fgets(line, sizeof(line), f)) {
-        line[strcspn(line, "\n")] = 0;
-
-        if (strncmp(line, "Created: ", 9) == 0) {
-            struct tm tm = {0};
-            char wk[4] = {0}, mon[4] = {0};
-            int mday=0, hh=0, mm=0, ss=0, year=0;
-            char *t = line + 9;
-            if (sscanf(t, "%3s %3s %d %d:%d:%d %d", wk, mon, &mday, &hh, &mm, &ss, &year) == 7) {
-                const char *months[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
-                int mon_idx = 0;
-                for (int i = 0; i < 12; i++) if (strcmp(mon, months[i]) == 0) { mon_idx = i; break; }
-                tm.tm_mday = mday; tm.tm_hour = hh; tm.tm_min = mm; tm.tm_sec = ss;
-                tm.tm_year = year - 1900; tm.tm_mon = mon_idx;
-                nb->created_time = mktime(&tm);
-            }
-            continue;
-        }
-
-        if (line[0] == '#' && line[1] == '#') {
-            int level = count_heading_level(line);
-            int depth = level - 2;
-            if (depth < 0) depth = 0;
-            if (depth > 30) depth = 30;
-
-            char *name = line + level;
-            while (*name && isspace((unsigned char)*name)) name++;
-
-            int collapsed = 0;
-            char *cpos = strstr(name, " [COLLAPSED]");
-            if (cpos) { *cpos = '\0'; collapsed = 1; }
-            trim_trailing_spaces(name);
-
-            if (nb->section_count >= MAX_SECTIONS) continue;
-
-            /* parse section color badge from the original line */
-            UiColor sc = parse_color_badge(line);
-
-            Section *s = &nb->sections[nb->section_count++];
-            memset(s, 0, sizeof(*s));
-            s->id = nb->next_section_id++;
-            s->depth = depth;
-            s->collapsed = collapsed;
-            s->color = sc;
-            strncpy(s->name, name, MAX_NAME - 1);
-
-            while (stack_depth > depth) stack_depth--;
-            if (depth == 0) s->parent_id = -1;
-            else s->parent_id = section_stack[depth - 1];
-
-            section_stack[depth] = s->id;
-            if (stack_depth <= depth) stack_depth = depth + 1;
-
-            current_section_id = s->id;
-            for (int i = 0; i < 256; i++) entry_parent_at_depth[i] = -1;
-            continue;
-        }
-
-        int lead = count_leading_spaces(line);
-        char *p = line + lead;
-
-        if (strncmp(p, "- ", 2) == 0 && current_section_id != -1) {
-            if (nb->entry_count >= MAX_ENTRIES) continue;
-
-            int depth = lead / 2;
-            if (depth < 0) depth = 0;
-            if (depth > 200) depth = 200;
-
-            Entry *e = &nb->entries[nb->entry_count++];
-            memset(e, 0, sizeof(*e));
-            e->id = nb->next_entry_id++;
-            e->section_id = current_section_id;
-            e->depth = depth;
-            e->parent_id = (depth == 0) ? -1 : entry_parent_at_depth[depth - 1];
-            e->color = HP_COLOR_NONE;
-
-            char *txt = p + 2;
-            if (strncmp(txt, "[x] ", 4) == 0) { e->completed = 1; txt += 4; }
-            else if (strncmp(txt, "[ ] ", 4) == 0) { e->completed = 0; txt += 4; }
-
-            char temp[MAX_TEXT * 2];
-            memset(temp, 0, sizeof(temp));
-            strncpy(temp, txt, sizeof(temp) - 1);
-
-            char *ts = strstr(temp, "{created:");
-            if (ts) {
-                long c = 0, m = 0;
-                if (sscanf(ts, "{created:%ld,modified:%ld}", &c, &m) == 2) {
-                    e->created = (time_t)c;
-                    e->modified = (time_t)m;
-                } else {
-                    e->created = e->modified = time(NULL);
-                }
-                *ts = '\0';
-                trim_trailing_spaces(temp);
-            } else {
-                e->created = e->modified = time(NULL);
-            }
-
-            if (strstr(txt, "[PIN]")) e->pinned = 1;
-            if (strstr(txt, "[COLLAPSED]")) e->collapsed = 1;
-
-            if (strstr(txt, "[P0]")) e->priority = PRIORITY_CRITICAL;
-            else if (strstr(txt, "[P1]")) e->priority = PRIORITY_HIGH;
-            else if (strstr(txt, "[P2]")) e->priority = PRIORITY_MEDIUM;
-            else if (strstr(txt, "[P3]")) e->priority = PRIORITY_LOW;
-            else e->priority = PRIORITY_NONE;
-
-            e->color = parse_color_badge(txt);
-
-            char *badge = strstr(temp, " [");
-            if (badge) { *badge = '\0'; trim_trailing_spaces(temp); }
-
-            e->tag_count = 0;
-            char *hash = strchr(temp, '#');
-            if (hash && hash > temp) {
-                if (hash > temp && *(hash - 1) == ' ') *(hash - 1) = '\0';
-                char *tag = strtok(hash + 1, " #");
-                while (tag && e->tag_count < MAX_TAGS) {
-                    strncpy(e->tags[e->tag_count], tag, MAX_TAG_LEN - 1);
-                    e->tags[e->tag_count][MAX_TAG_LEN - 1] = '\0';
-                    e->tag_count++;
-                    tag = strtok(NULL, " #");
-                }
-                *hash = '\0';
-                trim_trailing_spaces(temp);
-            }
-
-            strncpy(e->text, temp, MAX_TEXT - 1);
-            e->text[MAX_TEXT - 1] = '\0';
-
-            entry_parent_at_depth[depth] = e->id;
-            continue;
-        }
-    }
-
-    fclose(f);
-}
-
-/* ---------------- Actions: insertion helpers ---------------- */
-
-static void insert_section_at(HackPad *nb, int insert_pos, Section *s) {
-    if (nb->section_count >= MAX_SECTIONS) return;
-    if (insert_pos < 0) insert_pos = 0;
-    if (insert_pos > nb->section_count) insert_pos = nb->section_count;
-
-    for (int i = nb->section_count; i > insert_pos; i--) nb->sections[i] = nb->sections[i - 1];
-    nb->sections[insert_pos] = *s;
-    nb->section_count++;
-}
-
-static void insert_entry_at(HackPad *nb, int insert_pos, Entry *e) {
-    if (nb->entry_count >= MAX_ENTRIES) return;
-    if (insert_pos < 0) insert_pos = 0;
-    if (insert_pos > nb->entry_count) insert_pos = nb->entry_count;
-
-    for (int i = nb->entry_count; i > insert_pos; i--) nb->entries[i] = nb->entries[i - 1];
-    nb->entries[insert_pos] = *e;
-    nb->entry_count++;
 }
 
 /* ---------------- Actions ---------------- */
 
-static void add_section_same_level(HackPad *nb) {
-    if (nb->section_count >= MAX_SECTIONS) { status_msg("ERROR: Max sections reached"); return; }
+/* Key handlers: ask for input, make the change through the core (see
+   "Edits" in hackpad_core.c) and report. A failing core call leaves its
+   reason in nb->error, which the main loop shows (see show_error). */
 
+static void add_section_same_level(HackPad *nb) {
     int cur_idx = find_section_index_by_id(nb, nb->current_section_id);
     int parent_id = -1;
     int depth = 0;
@@ -1071,24 +779,15 @@ static void add_section_same_level(HackPad *nb) {
     char buf[MAX_NAME] = {0};
     if (!line_editor("New Section", buf, MAX_NAME)) return;
 
-    Section s;
-    memset(&s, 0, sizeof(s));
-    s.id = nb->next_section_id++;
-    s.parent_id = parent_id;
-    s.depth = depth;
-    s.collapsed = 0;
-    s.color = HP_COLOR_NONE;
-    strncpy(s.name, buf, MAX_NAME - 1);
-
-    insert_section_at(nb, insert_after + 1, &s);
+    int id = create_section(nb, insert_after + 1, parent_id, depth, buf);
+    if (id < 0) return;
 
-    nb->current_section_id = s.id;
+    nb->current_section_id = id;
     nb->focus = FOCUS_SECTIONS;
     status_msg("Section created");
 }
 
 static void add_sub_section(HackPad *nb) {
-    if (nb->section_count >= MAX_SECTIONS) { status_msg("ERROR: Max sections reached"); return; }
     int cur_idx = find_section_index_by_id(nb, nb->current_section_id);
     if (cur_idx < 0) { status_msg("Select a section"); return; }
 
@@ -1096,25 +795,15 @@ static void add_sub_section(HackPad *nb) {
     if (!line_editor("New Sub-Section", buf, MAX_NAME)) return;
 
     int insert_after = section_subtree_end_index(nb, cur_idx);
+    int id = create_section(nb, insert_after + 1, nb->current_section_id, nb->sections[cur_idx].depth + 1, buf);
+    if (id < 0) return;
 
-    Section s;
-    memset(&s, 0, sizeof(s));
-    s.id = nb->next_section_id++;
-    s.parent_id = nb->current_section_id;
-    s.depth = nb->sections[cur_idx].depth + 1;
-    s.collapsed = 0;
-    s.color = HP_COLOR_NONE;
-    strncpy(s.name, buf, MAX_NAME - 1);
-
-    insert_section_at(nb, insert_after + 1, &s);
-
-    nb->current_section_id = s.id;
+    nb->current_section_id = id;
     nb->focus = FOCUS_SECTIONS;
     status_msg("Sub-section created");
 }
 
 static void add_entry(HackPad *nb, const char *preset) {
-    if (nb->entry_count >= MAX_ENTRIES) { status_msg("ERROR: Max entries reached"); return; }
     int si = find_section_index_by_id(nb, nb->current_section_id);
     if (si < 0) { status_msg("Select a section first"); return; }
     if (nb->sections[si].collapsed) { status_msg("Section is collapsed"); return; }
@@ -1124,62 +813,41 @@ static void add_entry(HackPad *nb, const char *preset) {
     if (!line_editor("New Entry", buf, MAX_TEXT)) return;
 
     /* Insert after selected entry subtree if there's a selected entry in this section; else append at end of section's entries */
-    int insert_pos = nb->entry_count;
+    int after = nb->sections[si].last_entry;
     int sel_idx = find_entry_index_by_id(nb, nb->selected_entry_id);
     if (sel_idx >= 0 && nb->entries[sel_idx].section_id == nb->current_section_id) {
-        insert_pos = entry_subtree_end_index_in_section(nb, sel_idx) + 1;
-    } else {
-        /* place after last entry belonging to this section */
-        for (int i = nb->entry_count - 1; i >= 0; i--) {
-            if (nb->entries[i].section_id == nb->current_section_id) { insert_pos = i + 1; break; }
-        }
+        after = entry_subtree_end_index_in_section(nb, sel_idx);
     }
 
-    Entry e;
-    memset(&e, 0, sizeof(e));
-    e.id = nb->next_entry_id++;
-    e.section_id = nb->current_section_id;
-    e.parent_id = -1;
-    e.depth = 0;
-    e.collapsed = 0;
-    e.color = HP_COLOR_NONE;
-    strncpy(e.text, buf, MAX_TEXT - 1);
-    e.created = e.modified = time(NULL);
-
-    insert_entry_at(nb, insert_pos, &e);
+    int id = create_entry(nb, nb->current_section_id, after, -1, 0, buf);
+    if (id < 0) return;
 
-    nb->selected_entry_id = e.id;
+    nb->selected_entry_id = id;
     nb->focus = FOCUS_ENTRIES;
     status_msg("Entry added");
 }
 
 static void add_sub_entry(HackPad *nb) {
-    if (nb->entry_count >= MAX_ENTRIES) { status_msg("ERROR: Max entries reached"); return; }
     int ei = find_entry_index_by_id(nb, nb->selected_entry_id);
     if (ei < 0) { status_msg("Select an entry first"); return; }
 
-    Entry *parent = &nb->entries[ei];
+    if (nb->cols.depth[ei] >= MAX_DEPTH) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Entries nest at most %d levels deep", MAX_DEPTH);
+        status_msg(msg);
+        return;
+    }
 
     char buf[MAX_TEXT] = {0};
     if (!line_editor("New Sub-Entry", buf, MAX_TEXT)) return;
 
     /* Insert after parent's subtree */
-    int insert_pos = entry_subtree_end_index_in_section(nb, ei) + 1;
-
-    Entry e;
-    memset(&e, 0, sizeof(e));
-    e.id = nb->next_entry_id++;
-    e.section_id = parent->section_id;
-    e.parent_id = parent->id;
-    e.depth = parent->depth + 1;
-    e.collapsed = 0;
-    e.color = HP_COLOR_NONE;
-    strncpy(e.text, buf, MAX_TEXT - 1);
-    e.created = e.modified = time(NULL);
-
-    insert_entry_at(nb, insert_pos, &e);
-
-    nb->selected_entry_id = e.id;
+    Entry *parent = &nb->entries[ei];
+    int after = entry_subtree_end_index_in_section(nb, ei);
+    int id = create_entry(nb, parent->section_id, after, parent->id, nb->cols.depth[ei] + 1, buf);
+    if (id < 0) return;
+
+    nb->selected_entry_id = id;
     nb->focus = FOCUS_ENTRIES;
     status_msg("Sub-entry added");
 }
@@ -1189,15 +857,15 @@ static void edit_entry(HackPad *nb) {
     if (ei < 0) { status_msg("No entry selected"); return; }
 
     Entry *e = &nb->entries[ei];
-    char buf[MAX_TEXT];
-    memset(buf, 0, sizeof(buf));
-    strncpy(buf, e->text, MAX_TEXT - 1);
+    /* leave room to grow texts that are already longer than the editor default */
+    int cap = e->text_len + MAX_TEXT;
+    char *buf = (char*)malloc((size_t)cap);
+    if (!buf) { status_msg("ERROR: Out of memory"); return; }
+    memcpy(buf, e->text, (size_t)e->text_len + 1);
 
-    if (line_editor("Edit Entry", buf, MAX_TEXT)) {
-        strncpy(e->text, buf, MAX_TEXT - 1);
-        e->modified = time(NULL);
+    if (line_editor("Edit Entry", buf, cap) && update_entry_text(nb, ei, buf) == HP_OK)
         status_msg("Entry updated");
-    }
+    free(buf);
 }
 
 static void edit_tags(HackPad *nb) {
@@ -1208,21 +876,11 @@ static void edit_tags(HackPad *nb) {
     char buf[MAX_TEXT] = {0};
     for (int i = 0; i < e->tag_count; i++) {
         if (i) strncat(buf, " ", sizeof(buf) - strlen(buf) - 1);
-        strncat(buf, e->tags[i], sizeof(buf) - strlen(buf) - 1);
+        strncat(buf, tag_name(nb, e->tags[i]), sizeof(buf) - strlen(buf) - 1);
     }
 
-    if (line_editor("Tags (space/comma-separated)", buf, MAX_TEXT)) {
-        e->tag_count = 0;
-        char *tag = strtok(buf, " ,");
-        while (tag && e->tag_count < MAX_TAGS) {
-            strncpy(e->tags[e->tag_count], tag, MAX_TAG_LEN - 1);
-            e->tags[e->tag_count][MAX_TAG_LEN - 1] = '\0';
-            e->tag_count++;
-            tag = strtok(NULL, " ,");
-        }
-        e->modified = time(NULL);
+    if (line_editor("Tags (space/comma-separated)", buf, MAX_TEXT) && update_entry_tags(nb, ei, buf) == HP_OK)
         status_msg("Tags updated");
-    }
 }
 
 static void set_priority(HackPad *nb) {
@@ -1232,9 +890,9 @@ static void set_priority(HackPad *nb) {
     const char *opts[] = {"None","Low","Medium","High","Critical"};
     int choice = menu_dialog("Set Priority", opts, 5);
     if (choice >= 0) {
-        nb->entries[ei].priority = (Priority)choice;
-        nb->entries[ei].modified = time(NULL);
-        status_msg("Priority updated");
+        EntryHot h = entry_hot(nb, ei);
+        h.priority = (Priority)choice;
+        if (update_entry_attrs(nb, ei, &h) == HP_OK) status_msg("Priority updated");
     }
 }
 
@@ -1245,9 +903,9 @@ static void set_entry_color(HackPad *nb) {
     const char *opts[] = {"None","Red","Green","Yellow","Orange","Magenta","Cyan","White"};
     int choice = menu_dialog("Set Entry Color", opts, 8);
     if (choice >= 0) {
-        nb->entries[ei].color = (UiColor)choice;
-        nb->entries[ei].modified = time(NULL);
-        status_msg("Entry color updated");
+        EntryHot h = entry_hot(nb, ei);
+        h.color = (UiColor)choice;
+        if (update_entry_attrs(nb, ei, &h) == HP_OK) status_msg("Entry color updated");
     }
 }
 
@@ -1257,151 +915,424 @@ static void set_section_color(HackPad *nb) {
 
     const char *opts[] = {"None","Red","Green","Yellow","Orange","Magenta","Cyan","White"};
     int choice = menu_dialog("Set Section Color", opts, 8);
-    if (choice >= 0) {
-        nb->sections[si].color = (UiColor)choice;
+    if (choice >= 0 && update_section_attrs(nb, si, nb->sections[si].collapsed, (UiColor)choice) == HP_OK)
         status_msg("Section color updated");
-    }
 }
 
 static void toggle_complete(HackPad *nb) {
     int ei = find_entry_index_by_id(nb, nb->selected_entry_id);
     if (ei < 0) { status_msg("No entry selected"); return; }
-    nb->entries[ei].completed = !nb->entries[ei].completed;
-    nb->entries[ei].modified = time(NULL);
-    status_msg(nb->entries[ei].completed ? "Marked complete" : "Marked incomplete");
+    EntryHot h = entry_hot(nb, ei);
+    h.completed = !h.completed;
+    if (update_entry_attrs(nb, ei, &h) == HP_OK) status_msg(h.completed ? "Marked complete" : "Marked incomplete");
 }
 
 static void toggle_pin(HackPad *nb) {
     int ei = find_entry_index_by_id(nb, nb->selected_entry_id);
     if (ei < 0) { status_msg("No entry selected"); return; }
-    nb->entries[ei].pinned = !nb->entries[ei].pinned;
-    nb->entries[ei].modified = time(NULL);
-    status_msg(nb->entries[ei].pinned ? "Pinned" : "Unpinned");
+    EntryHot h = entry_hot(nb, ei);
+    h.pinned = !h.pinned;
+    if (update_entry_attrs(nb, ei, &h) == HP_OK) status_msg(h.pinned ? "Pinned" : "Unpinned");
 }
 
 static void toggle_fold(HackPad *nb) {
     if (nb->focus == FOCUS_SECTIONS) {
         int si = find_section_index_by_id(nb, nb->current_section_id);
-        if (si >= 0) nb->sections[si].collapsed = !nb->sections[si].collapsed;
+        if (si < 0) return;
+        update_section_attrs(nb, si, !nb->sections[si].collapsed, nb->sections[si].color);
     } else {
         int ei = find_entry_index_by_id(nb, nb->selected_entry_id);
-        if (ei >= 0) nb->entries[ei].collapsed = !nb->entries[ei].collapsed;
+        if (ei < 0) return;
+        EntryHot h = entry_hot(nb, ei);
+        h.collapsed = !h.collapsed;
+        update_entry_attrs(nb, ei, &h);
     }
 }
 
+/* Section si's subtree is gone: select what took its place */
+static void select_after_section_removal(HackPad *nb, int si) {
+    /* pick a sane next selection */
+    if (nb->section_count > 0) {
+        int pick = si;
+        if (pick >= nb->section_count) pick = nb->section_count - 1;
+        nb->current_section_id = nb->sections[pick].id;
+    } else {
+        nb->current_section_id = -1;
+    }
+
+    nb->selected_entry_id = -1;
+}
+
 static void delete_section(HackPad *nb) {
     int si = find_section_index_by_id(nb, nb->current_section_id);
     if (si < 0) { status_msg("No section selected"); return; }
 
+    /* undo brings it back, so only ask when there is no undo */
     char msg[256];
     snprintf(msg, sizeof(msg), "Delete section '%s' (entries inside will be deleted)?", nb->sections[si].name);
+    if (!nb->undo && !confirm_dialog(msg)) { status_msg("Cancelled"); return; }
+
+    if (delete_section_subtree(nb, si) != HP_OK) return;
+    select_after_section_removal(nb, si);
+    status_msg(nb->undo ? "Section deleted (u: undo)" : "Section deleted");
+}
+
+static void delete_entry(HackPad *nb) {
+    int ei = find_entry_index_by_id(nb, nb->selected_entry_id);
+    if (ei < 0) { status_msg("No entry selected"); return; }
+
+    if (!nb->undo && !confirm_dialog("Delete this entry (and its sub-entries)?")) { status_msg("Cancelled"); return; }
+
+    /* select the next entry in the same section, if any */
+    int next = nb->entry_next[entry_subtree_end_index_in_section(nb, ei)];
+    int next_id = next >= 0 ? nb->entries[next].id : -1;
+
+    if (delete_entry_subtree(nb, ei) < 0) return;
+    nb->selected_entry_id = next_id;
+    status_msg(nb->undo ? "Entry deleted (u: undo)" : "Entry deleted");
+}
+
+/* Move section si and its sub-sections to "<file>.archive" (see archive_section) */
+static void archive_section_key(HackPad *nb, int si) {
+    char path[272], msg[512];
+    snprintf(path, sizeof(path), "%s.archive", nb->filename);
+    snprintf(msg, sizeof(msg), "Move section '%s' and its sub-sections to %s?", nb->sections[si].name, path);
     if (!confirm_dialog(msg)) { status_msg("Cancelled"); return; }
 
-    int del_id = nb->sections[si].id;
-    int del_depth = nb->sections[si].depth;
+    if (archive_section(nb, si, path) != HP_OK) return;
+    select_after_section_removal(nb, si);
+    snprintf(msg, sizeof(msg), "Section archived to %s", path);
+    status_msg(msg);
+}
 
-    /* delete section subtree in one shot (since order is depth-first) */
-    int end = section_subtree_end_index(nb, si);
+/* K: remove many entries at once (see remove_entries_where) */
+static void bulk_delete(HackPad *nb) {
+    const char *options[] = {"Completed entries in this section (and sub-sections)","Completed entries everywhere",
+                             "Entries matching a filter, everywhere...","Archive this section..."};
+    int choice = menu_dialog("Bulk Delete", options, 4);
+    if (choice < 0) return;
 
-    /* delete entries belonging to any section in this subtree */
-    for (int i = 0; i < nb->entry_count; ) {
-        int secid = nb->entries[i].section_id;
-        int in_subtree = 0;
-        for (int sidx = si; sidx <= end; sidx++) {
-            if (nb->sections[sidx].id == secid) { in_subtree = 1; break; }
-        }
-        if (in_subtree) {
-            for (int k = i; k < nb->entry_count - 1; k++) nb->entries[k] = nb->entries[k + 1];
-            nb->entry_count--;
-            continue;
-        }
-        i++;
-    }
+    int si = find_section_index_by_id(nb, nb->current_section_id);
+    if ((choice == 0 || choice == 3) && si < 0) { status_msg("No section selected"); return; }
+    if (choice == 3) { archive_section_key(nb, si); return; }
 
-    /* remove the section subtree */
-    int remove_count = end - si + 1;
-    for (int i = si; i + remove_count < nb->section_count; i++) {
-        nb->sections[i] = nb->sections[i + remove_count];
+    char src[MAX_FILTER_LEN] = "is:done";
+    if (choice == 2) {
+        snprintf(src, sizeof(src), "%s", nb->filter_text);
+        if (!line_editor("Delete entries matching (#tag is:done p:3 ...)", src, MAX_FILTER_LEN)) return;
     }
-    nb->section_count -= remove_count;
-
-    /* pick a sane next selection */
-    if (nb->section_count > 0) {
-        int pick = si;
-        if (pick >= nb->section_count) pick = nb->section_count - 1;
-        nb->current_section_id = nb->sections[pick].id;
-    } else {
-        nb->current_section_id = -1;
+    ViewQuery q;
+    const char *err = NULL;
+    char msg[MAX_FILTER_LEN + 64];
+    if (!viewq_compile(nb, &q, src, &err)) {
+        snprintf(msg, sizeof(msg), "ERROR: Filter: %s", err);
+        status_msg(msg);
+        return;
     }
+    if (!q.preds) { status_msg("Give at least one condition"); return; }
 
-    nb->selected_entry_id = -1;
-    (void)del_id; (void)del_depth;
-    status_msg("Section deleted");
+    int first = 0, last = nb->section_count - 1;
+    if (choice == 0) last = section_subtree_end_index(nb, first = si);
+    snprintf(msg, sizeof(msg), "Delete entries matching '%s' and their sub-entries?", src);
+    if (!confirm_dialog(msg)) { status_msg("Cancelled"); return; }
+
+    int n = remove_entries_where(nb, first, last, &q);
+    snprintf(msg, sizeof(msg), "%d entr%s deleted", n, n == 1 ? "y" : "ies");
+    status_msg(msg);
 }
 
-static void delete_entry(HackPad *nb) {
-    int ei = find_entry_index_by_id(nb, nb->selected_entry_id);
-    if (ei < 0) { status_msg("No entry selected"); return; }
+/* u / U */
+static void undo_key(HackPad *nb, int redo) {
+    int rc = undo_step(nb, redo);
+    if (rc == HP_OK) status_msg(redo ? "Redone" : "Undone");
+    else if (rc == HP_ERR_NOOP) {
+        status_msg(nb->error);
+        nb->error[0] = '\0';
+    }
+}
+
+/* ---------------- Search ---------------- */
+
+/* Scrollable list of hits, "section  text"; returns the picked hit or -1 */
+static int search_results_dialog(HackPad *nb, const char *title, SearchHit *hits, int count) {
+    int h = LINES - 4, w = COLS - 6;
+    if (h < 6) h = 6;
+    if (w < 30) w = 30;
+
+    WINDOW *win = newwin(h, w, 2, 3);
+    keypad(win, TRUE);
+
+    int rows = h - 3;
+    int name_w = w / 4 < 20 ? w / 4 : 20;
+    int selected = 0, scroll = 0;
+
+    while (1) {
+        werase(win);
+        box(win, 0, 0);
+        if (has_colors()) wattron(win, COLOR_PAIR(CP_HEADER) | A_BOLD);
+        mvwprintw(win, 0, 2, " %s ", title);
+        if (has_colors()) wattroff(win, COLOR_PAIR(CP_HEADER) | A_BOLD);
 
-    if (!confirm_dialog("Delete this entry (and its sub-entries)?")) { status_msg("Cancelled"); return; }
+        scroll = clamp_scroll(scroll, selected, count, rows);
+        for (int r = 0; r < rows && scroll + r < count; r++) {
+            int i = scroll + r;
+            Entry *e = &nb->entries[hits[i].idx];
+            int si = find_section_index_by_id(nb, e->section_id);
 
-    int start = ei;
-    int end = entry_subtree_end_index_in_section(nb, ei);
-    int remove_count = end - start + 1;
-    int sid = nb->entries[start].section_id;
+            if (i == selected) wattron(win, A_REVERSE);
+            mvwhline(win, r + 1, 1, ' ', w - 2);
+            if (has_colors() && i != selected) wattron(win, COLOR_PAIR(CP_DIM));
+            mvwaddnstr(win, r + 1, 2, si >= 0 ? nb->sections[si].name : "", name_w);
+            if (has_colors() && i != selected) wattroff(win, COLOR_PAIR(CP_DIM));
+            mvwaddnstr(win, r + 1, 3 + name_w, e->text, w - name_w - 5);
+            if (i == selected) wattroff(win, A_REVERSE);
+        }
+
+        mvwprintw(win, h - 2, 2, "Enter:Go  ESC:Close  %d/%d", selected + 1, count);
+        wrefresh(win);
+
+        int ch = wgetch(win);
+        if (ch == 27 || ch == 'q') { delwin(win); return -1; }
+        if (ch == '\n') { delwin(win); return selected; }
+        if ((ch == KEY_UP || ch == 'k') && selected > 0) selected--;
+        if ((ch == KEY_DOWN || ch == 'j') && selected < count - 1) selected++;
+        if (ch == KEY_PPAGE) selected = selected > rows ? selected - rows : 0;
+        if (ch == KEY_NPAGE) selected = selected + rows < count ? selected + rows : count - 1;
+        if (ch == KEY_HOME || ch == 'g') selected = 0;
+        if (ch == KEY_END || ch == 'G') selected = count - 1;
+    }
+}
 
-    /* remove contiguous subtree entries (depth-first in this section) */
-    for (int i = start; i + remove_count < nb->entry_count; i++) {
-        nb->entries[i] = nb->entries[i + remove_count];
+static void search_entries(HackPad *nb) {
+    if (!line_editor("Search (text and tags, all sections)", nb->ui->search_text, (int)sizeof(nb->ui->search_text))) return;
+
+    const char *q = nb->ui->search_text;
+    while (*q == ' ') q++;
+    if (!*q) return;
+
+    SearchHit *hits = NULL;
+    const char *how = "";
+    int n = search_query(nb, q, &hits);
+    if (n == 0) {
+        free(hits);
+        n = search_scan(nb, q, &hits);
+        how = " (substring)";
     }
-    nb->entry_count -= remove_count;
+    if (n < 0) { status_msg("ERROR: Out of memory"); return; }
+    if (n == 0) { free(hits); status_msg("No matches"); return; }
 
-    /* clear selection */
-    nb->selected_entry_id = -1;
+    qsort(hits, (size_t)n, sizeof(SearchHit), cmp_search_hit);
 
-    /* try to select next visible entry in same section */
-    for (int i = start; i < nb->entry_count; i++) {
-        if (nb->entries[i].section_id == sid) { nb->selected_entry_id = nb->entries[i].id; break; }
+    char title[256];
+    snprintf(title, sizeof(title), "%d match%s for '%.64s'%s", n, n == 1 ? "" : "es", q, how);
+    int pick = search_results_dialog(nb, title, hits, n);
+    if (pick >= 0) {
+        jump_to_entry(nb, hits[pick].idx);
+        status_msg("Jumped to search result");
     }
-    status_msg("Entry deleted");
+    free(hits);
 }
 
 /* ---------------- Filter / Export ---------------- */
 
-static void filter_by_tag(HackPad *nb) {
-    if (line_editor("Filter by tag", nb->filter_tag, MAX_TAG_LEN)) {
-        nb->filter = VIEW_TAGGED;
-        status_msg("Filtering by tag (R to reset)");
+static void filter_status(HackPad *nb) {
+    char msg[MAX_FILTER_LEN + 32];
+    if (!nb->filter.preds) { status_msg("Filters reset"); return; }
+    snprintf(msg, sizeof(msg), "Filter: %s (R to reset)", nb->filter_text);
+    status_msg(msg);
+}
+
+/* Install a modified copy of the filter (formatted and compiled again) */
+static void update_filter(HackPad *nb, const ViewQuery *q) {
+    char text[MAX_FILTER_LEN];
+    viewq_format(q, text, sizeof(text));
+    if (set_filter(nb, text) == HP_OK) filter_status(nb);
+}
+
+static void edit_filter(HackPad *nb) {
+    char text[MAX_FILTER_LEN];
+    snprintf(text, sizeof(text), "%s", nb->filter_text);
+    if (line_editor("Filter (#a & !#b  p:0-1  is:open  color:red  mod:<7d  \"text\")", text, MAX_FILTER_LEN) &&
+        set_filter(nb, text) == HP_OK)
+        filter_status(nb);
+}
+
+typedef struct {
+    const char *name;       /* first spelling of the fold class */
+    int count;              /* entries carrying it */
+} TagCount;
+
+static int cmp_tag_count(const void *a, const void *b) {
+    const TagCount *x = (const TagCount*)a, *y = (const TagCount*)b;
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return strcasecmp(x->name, y->name);
+}
+
+/* Tags (case variants merged) with entry counts, most used first. Enter
+   filters on the tag alone; & | ! add it to the current tag filter. */
+static void tag_browser(HackPad *nb) {
+    int *counts = (int*)calloc((size_t)nb->tags.count + 1, sizeof(int));
+    TagCount *list = (TagCount*)malloc(((size_t)nb->tags.count + 1) * sizeof(TagCount));
+    if (!counts || !list) { free(counts); free(list); status_msg("ERROR: Out of memory"); return; }
+
+    for (int ei = 0; ei < nb->entry_slots; ei++) {
+        const Entry *e = &nb->entries[ei];
+        for (int i = 0; i < e->tag_count; i++) {
+            int cls = nb->tags.fold[e->tags[i]], dup = 0;
+            for (int j = 0; j < i && !dup; j++) dup = nb->tags.fold[e->tags[j]] == cls;
+            if (!dup) counts[cls]++;
+        }
     }
+    int count = 0;
+    for (int id = 0; id < nb->tags.count; id++)
+        if (counts[id] > 0) { list[count].name = tag_name(nb, id); list[count].count = counts[id]; count++; }
+    free(counts);
+    if (count == 0) { free(list); status_msg("No tags"); return; }
+    qsort(list, (size_t)count, sizeof(TagCount), cmp_tag_count);
+
+    int h = LINES - 4, w = 50;
+    if (h < 6) h = 6;
+    if (w > COLS - 4) w = COLS - 4;
+
+    WINDOW *win = newwin(h, w, 2, (COLS - w) / 2);
+    keypad(win, TRUE);
+
+    int rows = h - 3;
+    int selected = 0, scroll = 0, op = 0;
+    char title[64];
+    snprintf(title, sizeof(title), "Tags (%d)", count);
+
+    while (!op) {
+        werase(win);
+        box(win, 0, 0);
+        if (has_colors()) wattron(win, COLOR_PAIR(CP_HEADER) | A_BOLD);
+        mvwprintw(win, 0, 2, " %s ", title);
+        if (has_colors()) wattroff(win, COLOR_PAIR(CP_HEADER) | A_BOLD);
+
+        scroll = clamp_scroll(scroll, selected, count, rows);
+        for (int r = 0; r < rows && scroll + r < count; r++) {
+            int i = scroll + r;
+            if (i == selected) wattron(win, A_REVERSE);
+            mvwhline(win, r + 1, 1, ' ', w - 2);
+            mvwprintw(win, r + 1, 2, "%7d  #", list[i].count);
+            waddnstr(win, list[i].name, w - 14);
+            if (i == selected) wattroff(win, A_REVERSE);
+        }
+
+        mvwprintw(win, h - 2, 2, "Enter:Only  &:And  |:Or  !:Not  ESC:Close");
+        wrefresh(win);
+
+        int ch = wgetch(win);
+        if (ch == 27 || ch == 'q') op = 27;
+        if (ch == '\n' || ch == '&' || ch == '|' || ch == '!') op = ch;
+        if ((ch == KEY_UP || ch == 'k') && selected > 0) selected--;
+        if ((ch == KEY_DOWN || ch == 'j') && selected < count - 1) selected++;
+        if (ch == KEY_PPAGE) selected = selected > rows ? selected - rows : 0;
+        if (ch == KEY_NPAGE) selected = selected + rows < count ? selected + rows : count - 1;
+        if (ch == KEY_HOME || ch == 'g') selected = 0;
+        if (ch == KEY_END || ch == 'G') selected = count - 1;
+    }
+    delwin(win);
+
+    const char *name = list[selected].name;
+    free(list);
+    if (op == 27) return;
+    if (strpbrk(name, " \t&|!()")) { status_msg("ERROR: Tag cannot be used in a filter expression"); return; }
+
+    /* the other predicates of the filter stay as they are */
+    ViewQuery q = nb->filter;
+    const char *cur = (q.preds & VQ_TAGS) ? q.tags.text : "";
+    const char *err = NULL;
+    char expr[MAX_TAG_LEN * 2];
+    if (op == '\n' || (!*cur && op != '!')) snprintf(expr, sizeof(expr), "#%s", name);
+    else if (!*cur)                         snprintf(expr, sizeof(expr), "!#%s", name);
+    else if (op == '&')                     snprintf(expr, sizeof(expr), "%s & #%s", cur, name);
+    else if (op == '|')                     snprintf(expr, sizeof(expr), "%s | #%s", cur, name);
+    else                                    snprintf(expr, sizeof(expr), "%s & !#%s", cur, name);
+    if (strlen(expr) >= MAX_TAG_LEN) { status_msg("ERROR: Tag filter too long"); return; }
+
+    if (!tagq_compile(nb, &q.tags, expr, &err)) { status_msg("ERROR: Tag filter: bad expression"); return; }
+    q.preds |= VQ_TAGS;
+    update_filter(nb, &q);
 }
 
+/* Narrow the filter one predicate at a time; the others are kept */
 static void change_view_mode(HackPad *nb) {
-    const char *options[] = {"All entries","By tag","By priority","Completed only","Incomplete only"};
-    int choice = menu_dialog("View Mode", options, 5);
-    if (choice >= 0) {
-        nb->filter = (ViewFilter)choice;
-        if (choice == VIEW_PRIORITY) {
-            const char *pri_opts[] = {"Low (P3)","Medium (P2)","High (P1)","Critical (P0)"};
-            int pri = menu_dialog("Select Priority", pri_opts, 4);
-            if (pri >= 0) {
-                nb->filter_priority = (Priority)(pri + 1);
-                status_msg("View mode changed");
-            } else {
-                nb->filter = VIEW_ALL;
+    const char *options[] = {"All entries (clear filter)","Tags...","Priority...","Completed only",
+                             "Incomplete only","Pinned only","Color...","Modified within...","Text..."};
+    int choice = menu_dialog("View Mode", options, 9);
+    if (choice < 0) return;
+
+    ViewQuery q = nb->filter;
+    const char *err = NULL;
+    switch (choice) {
+        case 0:
+            memset(&q, 0, sizeof(q));
+            break;
+        case 1: {
+            char expr[MAX_TAG_LEN];
+            snprintf(expr, sizeof(expr), "%s", (q.preds & VQ_TAGS) ? q.tags.text : "");
+            if (!line_editor("Tags (#a & #b | !#c)", expr, MAX_TAG_LEN)) return;
+            if (!tagq_compile(nb, &q.tags, expr, &err)) {
+                char msg[160];
+                snprintf(msg, sizeof(msg), "ERROR: Tag filter: %s", err);
+                status_msg(msg);
+                return;
             }
-        } else {
-            status_msg("View mode changed");
+            q.preds = q.tags.len ? (q.preds | VQ_TAGS) : (q.preds & ~VQ_TAGS);
+            break;
+        }
+        case 2: {
+            static const unsigned masks[] = {
+                1u << PRIORITY_CRITICAL, (1u << PRIORITY_CRITICAL) | (1u << PRIORITY_HIGH),
+                1u << PRIORITY_HIGH, 1u << PRIORITY_MEDIUM, 1u << PRIORITY_LOW, 1u << PRIORITY_NONE
+            };
+            const char *pri_opts[] = {"Critical (P0)","High and up (P0-P1)","High (P1)","Medium (P2)","Low (P3)","No priority"};
+            int pri = menu_dialog("Select Priority", pri_opts, 6);
+            if (pri < 0) return;
+            q.prio_mask = masks[pri];
+            q.preds |= VQ_PRIORITY;
+            break;
+        }
+        case 3: q.preds = (q.preds & ~VQ_OPEN) | VQ_DONE; break;
+        case 4: q.preds = (q.preds & ~VQ_DONE) | VQ_OPEN; break;
+        case 5: q.preds = (q.preds & ~VQ_UNPINNED) | VQ_PINNED; break;
+        case 6: {
+            const char *col_opts[] = {"None","Red","Green","Yellow","Orange","Magenta","Cyan","White"};
+            int col = menu_dialog("Select Color", col_opts, 8);
+            if (col < 0) return;
+            q.color_mask = 1u << col;
+            q.preds |= VQ_COLOR;
+            break;
+        }
+        case 7: {
+            const char *mod_opts[] = {"1 hour","24 hours","7 days","30 days"};
+            const char *specs[] = {"<1h","<1d","<7d","<30d"};
+            int m = menu_dialog("Modified within", mod_opts, 4);
+            if (m < 0) return;
+            snprintf(q.mod_spec, sizeof(q.mod_spec), "%s", specs[m]);
+            q.preds |= VQ_MODIFIED;
+            break;
+        }
+        case 8: {
+            char text[MAX_NAME];
+            snprintf(text, sizeof(text), "%s", q.text);
+            if (!line_editor("Entry text contains", text, (int)sizeof(text))) return;
+            if (!text[0]) { q.preds &= ~VQ_TEXT; break; }
+            if (strchr(text, '"')) { status_msg("ERROR: Filter text cannot contain '\"'"); return; }
+            set_filter_text(&q, text, strlen(text));
+            break;
         }
     }
+    update_filter(nb, &q);
 }
 
 static void reset_filters(HackPad *nb) {
-    nb->filter = VIEW_ALL;
-    nb->filter_tag[0] = '\0';
+    set_filter(nb, "");
     status_msg("Filters reset");
 }
 
-static void export_section(HackPad *nb) {
+static void export_section_key(HackPad *nb) {
     int si = find_section_index_by_id(nb, nb->current_section_id);
     if (si < 0) { status_msg("No section selected"); return; }
 
@@ -1409,61 +1340,25 @@ static void export_section(HackPad *nb) {
     snprintf(filename, sizeof(filename), "%s_export.md", nb->sections[si].name);
     if (!line_editor("Export to", filename, 256)) return;
 
-    FILE *f = fopen(filename, "w");
-    if (!f) { status_msg("ERROR: Could not create export file"); return; }
-
-    fprintf(f, "# %s\n\n", nb->sections[si].name);
-
-    int *vis = (int*)calloc((size_t)nb->entry_count + 1, sizeof(int));
-    if (!vis) { fclose(f); status_msg("OOM"); return; }
-    int vis_count = build_visible_entries(nb, nb->sections[si].id, vis, nb->entry_count);
-
-    for (int i = 0; i < vis_count; i++) {
-        Entry *e = &nb->entries[vis[i]];
-        int indent = e->depth * 2;
-        for (int sp = 0; sp < indent; sp++) fputc(' ', f);
-        fprintf(f, "- %s %s", e->completed ? "[x]" : "[ ]", e->text);
-
-        if (e->tag_count > 0) {
-            fprintf(f, " (");
-            for (int t = 0; t < e->tag_count; t++) {
-                fprintf(f, "#%s", e->tags[t]);
-                if (t < e->tag_count - 1) fprintf(f, " ");
-            }
-            fprintf(f, ")");
-        }
-        if (e->priority != PRIORITY_NONE) fprintf(f, " [%s]", priority_str(e->priority));
-        if (e->color != HP_COLOR_NONE) fprintf(f, " [%s]", color_str(e->color));
-        if (e->pinned) fprintf(f, " [PIN]");
-        fprintf(f, "\n");
-    }
-
-    free(vis);
-    fclose(f);
-    status_msg("Section exported");
+    if (export_section(nb, si, filename) == HP_OK) status_msg("Section exported");
 }
 
 /* ---------------- Navigation ---------------- */
 
 static void move_section_selection(HackPad *nb, int delta) {
-    int *vis = (int*)calloc((size_t)nb->section_count + 1, sizeof(int));
-    if (!vis) return;
-    int vis_count = build_visible_sections(nb, vis, nb->section_count);
-    if (vis_count <= 0) { free(vis); return; }
-
-    int cur_pos = 0;
-    for (int i = 0; i < vis_count; i++) {
-        if (nb->sections[vis[i]].id == nb->current_section_id) { cur_pos = i; break; }
-    }
+    VisCache *vc = visible_sections(nb);
+    if (!vc || vc->count <= 0) return;
+
+    int cur_pos = vis_section_pos(nb, vc, nb->current_section_id);
+    if (cur_pos < 0) cur_pos = 0;
 
     int new_pos = cur_pos + delta;
     if (new_pos < 0) new_pos = 0;
-    if (new_pos >= vis_count) new_pos = vis_count - 1;
+    if (new_pos >= vc->count) new_pos = vc->count - 1;
 
-    nb->current_section_id = nb->sections[vis[new_pos]].id;
+    nb->current_section_id = nb->sections[vc->idx[new_pos]].id;
     nb->selected_entry_id = -1;
-
-    free(vis);
+    vc->hint = new_pos;
 }
 
 static void move_entry_selection(HackPad *nb, int delta) {
@@ -1471,113 +1366,112 @@ static void move_entry_selection(HackPad *nb, int delta) {
     if (si < 0) return;
     int sid = nb->sections[si].id;
 
-    int *vis = (int*)calloc((size_t)nb->entry_count + 1, sizeof(int));
-    if (!vis) return;
-    int vis_count = build_visible_entries(nb, sid, vis, nb->entry_count);
-    if (vis_count <= 0) { nb->selected_entry_id = -1; free(vis); return; }
+    VisCache *vc = visible_entries(nb, sid);
+    if (!vc) return;
+    if (vc->count <= 0) { nb->selected_entry_id = -1; return; }
 
-    int cur_pos = 0;
-    for (int i = 0; i < vis_count; i++) {
-        if (nb->entries[vis[i]].id == nb->selected_entry_id) { cur_pos = i; break; }
-    }
+    int cur_pos = vis_entry_pos(nb, vc, nb->selected_entry_id);
+    if (cur_pos < 0) cur_pos = 0;
 
     int new_pos = cur_pos + delta;
     if (new_pos < 0) new_pos = 0;
-    if (new_pos >= vis_count) new_pos = vis_count - 1;
+    if (new_pos >= vc->count) new_pos = vc->count - 1;
 
-    nb->selected_entry_id = nb->entries[vis[new_pos]].id;
-    free(vis);
+    nb->selected_entry_id = nb->entries[vc->idx[new_pos]].id;
+    vc->hint = new_pos;
 }
 
 /* ---------------- Resize-safe window management ---------------- */
 
 static void destroy_windows(HackPad *nb) {
-    if (nb->secw)  { delwin(nb->secw);  nb->secw = NULL; }
-    if (nb->entw)  { delwin(nb->entw);  nb->entw = NULL; }
-    if (nb->secf)  { delwin(nb->secf);  nb->secf = NULL; }
-    if (nb->entf)  { delwin(nb->entf);  nb->entf = NULL; }
-    if (nb->helpw) { delwin(nb->helpw); nb->helpw = NULL; }
+    if (nb->ui->secw)  { delwin(nb->ui->secw);  nb->ui->secw = NULL; }
+    if (nb->ui->entw)  { delwin(nb->ui->entw);  nb->ui->entw = NULL; }
+    if (nb->ui->secf)  { delwin(nb->ui->secf);  nb->ui->secf = NULL; }
+    if (nb->ui->entf)  { delwin(nb->ui->entf);  nb->ui->entf = NULL; }
+    if (nb->ui->helpw) { delwin(nb->ui->helpw); nb->ui->helpw = NULL; }
 }
 
 static void create_windows(HackPad *nb) {
     destroy_windows(nb);
 
-    nb->sw = 28;
-    if (nb->sw > COLS - 30) nb->sw = (COLS > 60) ? 28 : (COLS / 2);
-    if (nb->sw < 20) nb->sw = (COLS > 40) ? 20 : (COLS / 2);
-    if (nb->sw < 10) nb->sw = 10;
+    nb->ui->sw = 28;
+    if (nb->ui->sw > COLS - 30) nb->ui->sw = (COLS > 60) ? 28 : (COLS / 2);
+    if (nb->ui->sw < 20) nb->ui->sw = (COLS > 40) ? 20 : (COLS / 2);
+    if (nb->ui->sw < 10) nb->ui->sw = 10;
 
     int main_h = LINES - 3;
     if (main_h < 5) main_h = 5;
 
-    int ent_w = COLS - nb->sw;
+    int ent_w = COLS - nb->ui->sw;
     if (ent_w < 10) ent_w = 10;
 
-    nb->secw  = newwin(main_h, nb->sw, 1, 0);
-    nb->entw  = newwin(main_h, ent_w, 1, nb->sw);
+    nb->ui->secw  = newwin(main_h, nb->ui->sw, 1, 0);
+    nb->ui->entw  = newwin(main_h, ent_w, 1, nb->ui->sw);
+
+    nb->ui->secf  = newwin(1, nb->ui->sw, LINES - 2, 0);
+    nb->ui->entf  = newwin(1, ent_w, LINES - 2, nb->ui->sw);
 
-    nb->secf  = newwin(1, nb->sw, LINES - 2, 0);
-    nb->entf  = newwin(1, ent_w, LINES - 2, nb->sw);
+    nb->ui->helpw = newwin(LINES - 2, COLS, 1, 0);
 
-    nb->helpw = newwin(LINES - 2, COLS, 1, 0);
+    keypad(nb->ui->secw, TRUE);
+    keypad(nb->ui->entw, TRUE);
+    keypad(nb->ui->secf, TRUE);
+    keypad(nb->ui->entf, TRUE);
+    keypad(nb->ui->helpw, TRUE);
+}
 
-    keypad(nb->secw, TRUE);
-    keypad(nb->entw, TRUE);
-    keypad(nb->secf, TRUE);
-    keypad(nb->entf, TRUE);
-    keypad(nb->helpw, TRUE);
+/* One frame: repaint damaged regions into the virtual screen, then a single doupdate() */
+static void render_frame(HackPad *nb) {
+    if (nb->ui->dirty & DIRTY_TOPBAR) {
+        draw_topbar(nb);
+        wnoutrefresh(stdscr);
+    }
+    draw_sections(nb->ui->secw, nb);
+    draw_entries(nb->ui->entw, nb);
+    if (nb->ui->dirty & DIRTY_FOOTERS) {
+        draw_sections_footer(nb->ui->secf, nb);
+        draw_entries_footer(nb->ui->entf, nb);
+    }
+    nb->ui->dirty = 0;
+    doupdate();
 }
 
 static void redraw_all(HackPad *nb) {
     erase();
-    refresh();
-    draw_topbar(nb);
+    status_msg("Ready. ? help | Q quit");
+    show_error(nb);
 
-    if (nb->show_help) {
-        draw_help(nb->helpw);
-    } else {
-        draw_sections(nb->secw, nb);
-        draw_entries(nb->entw, nb);
-        draw_sections_footer(nb->secf, nb);
-        draw_entries_footer(nb->entf, nb);
+    if (nb->ui->show_help) {
+        draw_topbar(nb);
+        wnoutrefresh(stdscr);
+        draw_help(nb->ui->helpw);
+        doupdate();
+        return;
     }
-    status_msg("Ready. ? help | Q quit");
+    nb->ui->dirty = DIRTY_ALL;
+    render_frame(nb);
 }
 
 /* ---------------- MAIN ---------------- */
 
 int main(int argc, char *argv[]) {
-    HackPad nb;
-    memset(&nb, 0, sizeof(nb));
-
-    nb.focus = FOCUS_SECTIONS;
-    nb.created_time = time(NULL);
-    nb.filter = VIEW_ALL;
-
-    nb.next_section_id = 1;
-    nb.next_entry_id = 1;
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) return batch_main(argc - 1, argv + 1);
 
+    HackPad nb;
     const char *file = (argc > 1) ? argv[1] : "HackPad.md";
-    strncpy(nb.filename, file, sizeof(nb.filename) - 1);
-
-    load_hackpad(&nb, file);
-
-    if (nb.section_count == 0) {
-        const char *defaults[] = {"Hosts", "IPs", "Credentials", "Exploits", "Vulnerabilities", "Notes"};
-        for (int i = 0; i < 5; i++) {
-            Section *s = &nb.sections[nb.section_count++];
-            memset(s, 0, sizeof(*s));
-            s->id = nb.next_section_id++;
-            s->parent_id = -1;
-            s->depth = 0;
-            s->collapsed = 0;
-            s->color = HP_COLOR_NONE;
-            strncpy(s->name, defaults[i], MAX_NAME - 1);
-        }
+    /* saving a notebook that did not load whole would lose the rest */
+    if (open_hackpad(&nb, file) != HP_OK) {
+        fprintf(stderr, "HackPad: %s: %s\n", file, nb.error);
+        close_hackpad(&nb);
+        return 1;
     }
 
-    nb.current_section_id = nb.sections[0].id;
-    nb.selected_entry_id = -1;
+    Frontend ui;
+    memset(&ui, 0, sizeof(ui));
+    nb.ui = &ui;
+
+    autosave_start(&nb);
+    undo_start(&nb);
 
     ui_init();
     create_windows(&nb);
@@ -1585,7 +1479,7 @@ int main(int argc, char *argv[]) {
     redraw_all(&nb);
 
     int ch;
-    while ((ch = getch()) != 'q' && ch != 'Q') {
+    while ((ch = next_key(&nb)) != 'q' && ch != 'Q') {
 
         /* Resize: rebuild windows and redraw */
         if (ch == KEY_RESIZE) {
@@ -1599,52 +1493,66 @@ int main(int argc, char *argv[]) {
         }
 
         /* Help overlay: MUST be closable */
-        if (nb.show_help) {
+        if (ui.show_help) {
             if (ch == '?' || ch == 27) { /* '?' or ESC closes help */
-                nb.show_help = 0;
+                ui.show_help = 0;
                 redraw_all(&nb);
             } else if (ch == 'q' || ch == 'Q') {
                 break;
             } else {
-                draw_help(nb.helpw);
+                draw_help(ui.helpw);
+                doupdate();
             }
             continue;
         }
 
+        /* navigation narrows this; anything else may have opened a dialog over the panes */
+        int damage = DIRTY_ALL;
+        int nav_damage = nb.focus == FOCUS_SECTIONS ? DIRTY_TOPBAR : 0;
+
         switch (ch) {
             case '?':
-                nb.show_help = 1;
-                draw_help(nb.helpw);
-                break;
+                ui.show_help = 1;
+                draw_help(ui.helpw);
+                doupdate();
+                continue;
 
             case KEY_LEFT:
             case 'h':
                 nb.focus = FOCUS_SECTIONS;
+                damage = DIRTY_FOOTERS;
                 break;
 
             case KEY_RIGHT:
             case 'l':
                 nb.focus = FOCUS_ENTRIES;
+                damage = DIRTY_FOOTERS;
                 break;
 
             case KEY_UP:
             case 'k':
                 if (nb.focus == FOCUS_SECTIONS) move_section_selection(&nb, -1);
                 else move_entry_selection(&nb, -1);
+                damage = nav_damage;
                 break;
 
             case KEY_DOWN:
             case 'j':
                 if (nb.focus == FOCUS_SECTIONS) move_section_selection(&nb, +1);
                 else move_entry_selection(&nb, +1);
+                damage = nav_damage;
                 break;
 
             case KEY_PPAGE:
-                if (nb.focus == FOCUS_ENTRIES) move_entry_selection(&nb, -10);
+                if (nb.focus == FOCUS_ENTRIES) move_entry_selection(&nb, -(getmaxy(ui.entw) - 2));
+                else move_section_selection(&nb, -(getmaxy(ui.secw) - 2));
+                damage = nav_damage;
                 break;
 
             case KEY_NPAGE:
-                if (nb.focus == FOCUS_ENTRIES) move_entry_selection(&nb, +10);
+                if (nb.focus == FOCUS_ENTRIES) move_entry_selection(&nb, +(getmaxy(ui.entw) - 2));
+                else move_section_selection(&nb, +(getmaxy(ui.secw) - 2));
+                damage = nav_damage;
                 break;
 
             case 'n':
@@ -1711,9 +1619,29 @@ int main(int argc, char *argv[]) {
                 else delete_entry(&nb);
                 break;
 
+            case 'K':
+                bulk_delete(&nb);
+                break;
+
+            case 'u':
+                undo_key(&nb, 0);
+                break;
+
+            case 'U':
+                undo_key(&nb, 1);
+                break;
+
             case 'f':
             case 'F':
-                filter_by_tag(&nb);
+                edit_filter(&nb);
+                break;
+
+            case '/':
+                search_entries(&nb);
+                break;
+
+            case '#':
+                tag_browser(&nb);
                 break;
 
             case 'v':
@@ -1728,41 +1656,45 @@ int main(int argc, char *argv[]) {
 
             case 'm':
             case 'M':
-                nb.show_timestamps = !nb.show_timestamps;
-                status_msg(nb.show_timestamps ? "Timestamps ON" : "Timestamps OFF");
+                ui.show_timestamps = !ui.show_timestamps;
+                status_msg(ui.show_timestamps ? "Timestamps ON" : "Timestamps OFF");
                 break;
 
             case 'y':
             case 'Y':
-                export_section(&nb);
+                export_section_key(&nb);
                 break;
 
             case 's':
             case 'S':
-                save_hackpad(&nb, nb.filename);
+                if (save_hackpad(&nb, nb.filename) == HP_OK) status_msg("Saved.");
                 break;
 
             case 'w':
             case 'W': {
                 char newfile[256] = {0};
                 strncpy(newfile, nb.filename, sizeof(newfile) - 1);
-                if (line_editor("Save As", newfile, (int)sizeof(newfile))) {
-                    strncpy(nb.filename, newfile, sizeof(nb.filename) - 1);
-                    save_hackpad(&nb, nb.filename);
-                }
+                if (line_editor("Save As", newfile, (int)sizeof(newfile)) && save_hackpad_as(&nb, newfile) == HP_OK)
+                    status_msg("Saved.");
             } break;
         }
 
-        draw_topbar(&nb);
-        draw_sections(nb.secw, &nb);
-        draw_entries(nb.entw, &nb);
-        draw_sections_footer(nb.secf, &nb);
-        draw_entries_footer(nb.entf, &nb);
+        undo_commit(&nb);
+        autosave_tick(&nb);
+        show_error(&nb);
+        ui.dirty |= damage;
+        render_frame(&nb);
     }
 
-    if (confirm_dialog("Save before quitting?")) save_hackpad(&nb, nb.filename);
+    /* with a working journal nothing is at risk; just fold it into the file */
+    autosave_wait(&nb);
+    if (nb.data_gen != nb.saved_gen) {
+        if (journal_active(&nb)) save_hackpad(&nb, nb.filename);
+        else if (confirm_dialog("Save before quitting?")) save_hackpad(&nb, nb.filename);
+    }
 
     destroy_windows(&nb);
     ui_shutdown();
+    close_hackpad(&nb);
     return 0;
 }
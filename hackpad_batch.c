@@ -0,0 +1,570 @@
+/*  HackPad batch mode - scripted changes without the terminal
+    Copyright (C) 2025  <Kasem Shibli> <kasem545@proton.me>
+
+    HackPad --batch FILE [COMMAND ARGS...]
+
+    Loads FILE once, runs one command given on the command line or, without
+    one, a command per line read from stdin, and saves once at the end if a
+    command changed anything (query and export alone never write). The run is
+    all or nothing: the first failing command stops it and nothing is
+    written. No journal is kept meanwhile, the single save replaces it.
+
+    Commands (words are split on blanks; "..." keeps blanks, \" and \\ escape):
+
+      add SECTION TEXT [OPTION...]          one entry at the end of SECTION
+      import SECTION [OPTION...]            one entry per following line, up to
+                                            a line holding only "." (or up to
+                                            EOF when given on the command line);
+                                            two leading spaces nest one level
+      import-scan SECTION FILE              nmap/masscan output (XML, JSON or
+                                            grepable; "-" is stdin when given on
+                                            the command line), hosts merged by
+                                            IP (see hackpad_scan.c)
+      merge FILE                            fold in another notebook: entries
+                                            match by content and section path,
+                                            the later-modified side wins, the
+                                            rest is added (see merge_hackpad)
+      query [FILTER]                        print matching entries, one per line:
+                                            id, section, open/done, priority,
+                                            text and tags, tab separated
+      export SECTION PATH [where FILTER]    the section as a markdown list
+      set-tag ID TAG...                     #tag or tag replaces the tags,
+      set-tag TAG... where FILTER           +tag adds and -tag drops one
+      complete ID | where FILTER            mark entries done
+
+    OPTION is #tag, p:0-3, color:NAME, is:done, is:pinned or under:ID (as the
+    last sub-entry of entry ID). FILTER is the filter line of the F key.
+    Sections are matched by name and created at the end when missing. Entry
+    ids are the ones query prints for the file as it is on disk; they shift
+    once entries are added or removed in front of them. Blank lines and lines
+    starting with '#' are skipped.
+*/
+
+#define _XOPEN_SOURCE 700
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <errno.h>
+
+#include "hackpad_core.h"
+
+#define BATCH_MAX_WORDS 64
+
+/* One command: its words and, for query and "where", the filter line as written */
+typedef struct {
+    char *w[BATCH_MAX_WORDS];
+    int n;
+    const char *filter;
+} BatchCmd;
+
+typedef struct {
+    HackPad *nb;
+    FILE *in;               /* command lines and import bodies */
+    int from_argv;          /* single command; an import body runs to EOF */
+    long line;
+
+    /* last section looked up by name; most runs stick to one */
+    int section_id;
+    char section[MAX_NAME];
+} Batch;
+
+/* Options of add and import */
+typedef struct {
+    char tags[MAX_TEXT];
+    int tag_count;
+    int has_attrs;
+    EntryHot hot;
+    int under;              /* parent entry id, -1: top level */
+} BatchOpts;
+
+static int batch_fail(Batch *b, int code, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(b->nb->error, sizeof(b->nb->error), fmt, ap);
+    va_end(ap);
+    return code;
+}
+
+/* ---------------- Parsing ---------------- */
+
+static int is_blank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+/* Decode the word at *pp in place and move past it; NULL at the end of the line */
+static char *next_word(char **pp) {
+    char *p = *pp;
+    while (is_blank(*p)) p++;
+    if (!*p) { *pp = p; return NULL; }
+
+    char *word = p, *out = p;
+    int quoted = 0;
+    while (*p && (quoted || !is_blank(*p))) {
+        if (*p == '"') { quoted = !quoted; p++; continue; }
+        if (*p == '\\' && (p[1] == '"' || p[1] == '\\')) p++;
+        *out++ = *p++;
+    }
+    if (*p) p++;
+    *out = '\0';
+    *pp = p;
+    return word;
+}
+
+/* Does the raw text at p start with the word w? */
+static int at_word(const char *p, const char *w) {
+    size_t n = strlen(w);
+    return strncmp(p, w, n) == 0 && (p[n] == '\0' || is_blank(p[n]));
+}
+
+/* Split a command line; the filter of query / "where" is kept as written */
+static int parse_line(Batch *b, char *line, BatchCmd *cmd) {
+    memset(cmd, 0, sizeof(*cmd));
+    char *p = line;
+    for (;;) {
+        while (is_blank(*p)) p++;
+        if (cmd->n > 0 && (strcmp(cmd->w[0], "query") == 0 || at_word(p, "where"))) {
+            if (strcmp(cmd->w[0], "query") != 0) p += 5;
+            cmd->filter = p;
+            break;
+        }
+        char *w = next_word(&p);
+        if (!w) break;
+        if (cmd->n == BATCH_MAX_WORDS) return batch_fail(b, HP_ERR_LIMIT, "Too many words");
+        cmd->w[cmd->n++] = w;
+    }
+    return HP_OK;
+}
+
+/* The same from argv, which the shell has split already. 'buf' holds the
+   filter words joined back together. */
+static int parse_args(Batch *b, int argc, char *argv[], BatchCmd *cmd, char *buf, size_t size) {
+    memset(cmd, 0, sizeof(*cmd));
+    int i = 0, filter = 0;
+    for (; i < argc; i++) {
+        if (cmd->n > 0 && strcmp(cmd->w[0], "query") == 0) { filter = 1; break; }
+        if (cmd->n > 0 && strcmp(argv[i], "where") == 0) { filter = 1; i++; break; }
+        if (cmd->n == BATCH_MAX_WORDS) return batch_fail(b, HP_ERR_LIMIT, "Too many words");
+        cmd->w[cmd->n++] = argv[i];
+    }
+    if (filter) {
+        buf[0] = '\0';
+        for (size_t len = 0; i < argc; i++) {
+            int n = snprintf(buf + len, size - len, "%s%s", len ? " " : "", argv[i]);
+            if (n < 0 || (size_t)n >= size - len) return batch_fail(b, HP_ERR_LIMIT, "Filter too long");
+            len += (size_t)n;
+        }
+        cmd->filter = buf;
+    }
+    return HP_OK;
+}
+
+static int parse_id(const char *s, int *out) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (!*s || *end || v < 0 || v > 0x7fffffff) return 0;
+    *out = (int)v;
+    return 1;
+}
+
+static int append_tag(char *tags, size_t size, const char *tag) {
+    size_t n = strlen(tags);
+    int w = snprintf(tags + n, size - n, "%s%s", n ? " " : "", tag);
+    return w >= 0 && (size_t)w < size - n;
+}
+
+static int parse_opts(Batch *b, char **w, int n, BatchOpts *o) {
+    memset(o, 0, sizeof(*o));
+    o->hot.priority = PRIORITY_NONE;
+    o->hot.color = HP_COLOR_NONE;
+    o->under = -1;
+
+    for (int i = 0; i < n; i++) {
+        const char *v = w[i];
+        if (v[0] == '#' && v[1]) {
+            if (o->tag_count == MAX_TAGS || !append_tag(o->tags, sizeof(o->tags), v + 1))
+                return batch_fail(b, HP_ERR_LIMIT, "At most %d tags per entry", MAX_TAGS);
+            o->tag_count++;
+        } else if (strncmp(v, "p:", 2) == 0) {
+            if (v[2] >= '0' && v[2] <= '3' && !v[3]) o->hot.priority = (Priority)(PRIORITY_CRITICAL - (v[2] - '0'));
+            else if (strcasecmp(v + 2, "none") == 0) o->hot.priority = PRIORITY_NONE;
+            else return batch_fail(b, HP_ERR_SYNTAX, "p: takes 0-3 or none");
+            o->has_attrs = 1;
+        } else if (strncmp(v, "color:", 6) == 0) {
+            int col = HP_COLOR_NONE;
+            if (strcasecmp(v + 6, "none") != 0) {
+                for (col = HP_COLOR_RED; col <= HP_COLOR_WHITE; col++)
+                    if (strcasecmp(v + 6, color_str((UiColor)col)) == 0) break;
+                if (col > HP_COLOR_WHITE) return batch_fail(b, HP_ERR_SYNTAX, "Unknown color '%s'", v + 6);
+            }
+            o->hot.color = (UiColor)col;
+            o->has_attrs = 1;
+        } else if (strcmp(v, "is:done") == 0) {
+            o->hot.completed = 1;
+            o->has_attrs = 1;
+        } else if (strcmp(v, "is:pinned") == 0) {
+            o->hot.pinned = 1;
+            o->has_attrs = 1;
+        } else if (strncmp(v, "under:", 6) == 0) {
+            if (!parse_id(v + 6, &o->under)) return batch_fail(b, HP_ERR_SYNTAX, "under: takes an entry id");
+        } else {
+            return batch_fail(b, HP_ERR_SYNTAX, "Unknown option '%s'", v);
+        }
+    }
+    return HP_OK;
+}
+
+/* ---------------- Targets ---------------- */
+
+/* Section named name, created at the end of the list when there is none */
+static int section_by_name(Batch *b, const char *name, int create) {
+    HackPad *nb = b->nb;
+    if (b->section[0] && strcmp(b->section, name) == 0 && find_section_index_by_id(nb, b->section_id) >= 0)
+        return b->section_id;
+
+    int id = -1;
+    for (int i = 0; i < nb->section_count && id < 0; i++)
+        if (strcmp(nb->sections[i].name, name) == 0) id = nb->sections[i].id;
+    if (id < 0 && !create) return batch_fail(b, HP_ERR_NOTFOUND, "No section '%s'", name);
+    if (id < 0) {
+        if (!*name || strlen(name) >= MAX_NAME) return batch_fail(b, HP_ERR_SYNTAX, "Bad section name");
+        id = create_section(nb, nb->section_count, -1, 0, name);
+        if (id < 0) return id;
+    }
+    b->section_id = id;
+    strncpy(b->section, name, sizeof(b->section) - 1);
+    return id;
+}
+
+/* Entry slots the command applies to: one id, or every entry matching its
+   filter, in notebook order. *out is the caller's to free. */
+static int select_entries(Batch *b, const BatchCmd *cmd, const char *id_word, int **out) {
+    HackPad *nb = b->nb;
+    *out = NULL;
+    if (!cmd->filter) {
+        int id, ei;
+        if (!id_word || !parse_id(id_word, &id) || (ei = find_entry_index_by_id(nb, id)) < 0)
+            return batch_fail(b, HP_ERR_NOTFOUND, "No entry '%s'", id_word ? id_word : "");
+        if (!(*out = (int*)malloc(sizeof(int)))) return batch_fail(b, HP_ERR_NOMEM, "Out of memory");
+        (*out)[0] = ei;
+        return 1;
+    }
+
+    ViewQuery q;
+    const char *err = NULL;
+    if (!viewq_compile(nb, &q, cmd->filter, &err)) return batch_fail(b, HP_ERR_SYNTAX, "Filter: %s", err);
+    if (!(*out = (int*)malloc((size_t)(nb->entry_count > 0 ? nb->entry_count : 1) * sizeof(int))))
+        return batch_fail(b, HP_ERR_NOMEM, "Out of memory");
+
+    int count = 0;
+    for (int si = 0; si < nb->section_count; si++) {
+        for (int i = nb->sections[si].first_entry; i >= 0; i = nb->entry_next[i])
+            if (viewq_match(nb, &q, i)) (*out)[count++] = i;
+    }
+    return count;
+}
+
+/* ---------------- Commands ---------------- */
+
+/* Slot that new entries of section_id are appended after: the section's
+   last entry, or the last sub-entry of entry parent (-1: top level) */
+static int append_point(Batch *b, int section_id, int parent, int *after) {
+    HackPad *nb = b->nb;
+    int si = find_section_index_by_id(nb, section_id);
+    *after = nb->sections[si].last_entry;
+    if (parent < 0) return HP_OK;
+
+    int pi = find_entry_index_by_id(nb, parent);
+    if (pi < 0 || nb->entries[pi].section_id != section_id)
+        return batch_fail(b, HP_ERR_NOTFOUND, "No entry %d in section '%s'", parent, nb->sections[si].name);
+    *after = entry_subtree_end_index_in_section(nb, pi);
+    return HP_OK;
+}
+
+/* New entry with o's tags and attributes after slot 'after', one level below
+   entry parent; returns its id */
+static int add_one(Batch *b, int section_id, int after, int parent, const char *text, const BatchOpts *o) {
+    HackPad *nb = b->nb;
+    if (!*text) return batch_fail(b, HP_ERR_SYNTAX, "Empty entry text");
+
+    int depth = parent >= 0 ? entry_hot(nb, find_entry_index_by_id(nb, parent)).depth + 1 : 0;
+    int id = create_entry(nb, section_id, after, parent, depth, text);
+    if (id < 0) return id;
+    int ei = find_entry_index_by_id(nb, id);
+    int rc = HP_OK;
+    if (o->tag_count) rc = update_entry_tags(nb, ei, o->tags);
+    if (rc == HP_OK && o->has_attrs) rc = update_entry_attrs(nb, ei, &o->hot);
+    return rc == HP_OK ? id : rc;
+}
+
+static int cmd_add(Batch *b, BatchCmd *cmd) {
+    if (cmd->n < 3 || cmd->filter) return batch_fail(b, HP_ERR_SYNTAX, "usage: add SECTION TEXT [OPTION...]");
+    BatchOpts o;
+    int rc = parse_opts(b, cmd->w + 3, cmd->n - 3, &o);
+    if (rc != HP_OK) return rc;
+    int sid = section_by_name(b, cmd->w[1], 1);
+    if (sid < 0) return sid;
+    int after;
+    rc = append_point(b, sid, o.under, &after);
+    if (rc == HP_OK) rc = add_one(b, sid, after, o.under, cmd->w[2], &o);
+    return rc < 0 ? rc : HP_OK;
+}
+
+/* Body lines up to "." become entries; indentation nests them under the
+   nearest shallower line before */
+static int cmd_import(Batch *b, BatchCmd *cmd) {
+    if (cmd->n < 2 || cmd->filter) return batch_fail(b, HP_ERR_SYNTAX, "usage: import SECTION [OPTION...]");
+    BatchOpts o;
+    int rc = parse_opts(b, cmd->w + 2, cmd->n - 2, &o);
+    if (rc != HP_OK) return rc;
+    int sid = section_by_name(b, cmd->w[1], 1);
+    if (sid < 0) return sid;
+
+    /* each line lands right after the one before, which ends the subtree it joins */
+    int after;
+    rc = append_point(b, sid, o.under, &after);
+    if (rc != HP_OK) return rc;
+
+    int parents[MAX_DEPTH + 1];
+    int level = -1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    rc = HP_OK;
+    while ((len = getline(&line, &cap, b->in)) >= 0) {
+        b->line++;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (!b->from_argv && strcmp(line, ".") == 0) break;
+
+        int indent = 0;
+        char *text = line;
+        for (; *text == ' ' || *text == '\t'; text++) indent += *text == '\t' ? 2 : 1;
+        if (!*text) continue;
+
+        int d = indent / 2;
+        if (d > level + 1) d = level + 1;
+        if (d > MAX_DEPTH) { rc = batch_fail(b, HP_ERR_LIMIT, "Entries nest at most %d levels deep", MAX_DEPTH); break; }
+        int id = add_one(b, sid, after, d > 0 ? parents[d - 1] : o.under, text, &o);
+        if (id < 0) { rc = id; break; }
+        after = find_entry_index_by_id(b->nb, id);
+        parents[d] = id;
+        level = d;
+    }
+    free(line);
+    return rc;
+}
+
+static int cmd_import_scan(Batch *b, BatchCmd *cmd) {
+    HackPad *nb = b->nb;
+    if (cmd->n != 3 || cmd->filter) return batch_fail(b, HP_ERR_SYNTAX, "usage: import-scan SECTION FILE");
+    const char *path = cmd->w[2];
+    int from_stdin = strcmp(path, "-") == 0;
+    if (from_stdin && !b->from_argv) return batch_fail(b, HP_ERR_SYNTAX, "stdin holds the commands; name the scan file");
+
+    int sid = section_by_name(b, cmd->w[1], 1);
+    if (sid < 0) return sid;
+    FILE *f = from_stdin ? b->in : fopen(path, "r");
+    if (!f) return batch_fail(b, HP_ERR_IO, "Could not open %s: %s", path, strerror(errno));
+
+    int rc = import_scan(nb, sid, f, NULL);
+    if (!from_stdin) fclose(f);
+    return rc;
+}
+
+static int cmd_merge(Batch *b, BatchCmd *cmd) {
+    if (cmd->n != 2 || cmd->filter) return batch_fail(b, HP_ERR_SYNTAX, "usage: merge FILE");
+    return merge_hackpad(b->nb, cmd->w[1], NULL);
+}
+
+static int cmd_query(Batch *b, BatchCmd *cmd) {
+    HackPad *nb = b->nb;
+    ViewQuery q;
+    const char *err = NULL;
+    if (!viewq_compile(nb, &q, cmd->filter ? cmd->filter : "", &err)) return batch_fail(b, HP_ERR_SYNTAX, "Filter: %s", err);
+
+    for (int si = 0; si < nb->section_count; si++) {
+        const Section *s = &nb->sections[si];
+        for (int i = s->first_entry; i >= 0; i = nb->entry_next[i]) {
+            if (!viewq_match(nb, &q, i)) continue;
+            const Entry *e = &nb->entries[i];
+            EntryHot h = entry_hot(nb, i);
+            printf("%d\t%s\t%s\t%s\t%s\t", e->id, s->name, h.completed ? "done" : "open",
+                   h.priority != PRIORITY_NONE ? priority_str(h.priority) : "-", e->text);
+            for (int t = 0; t < e->tag_count; t++) printf("%s#%s", t ? " " : "", tag_name(nb, e->tags[t]));
+            putchar('\n');
+        }
+    }
+    return ferror(stdout) ? batch_fail(b, HP_ERR_IO, "Could not write to stdout") : HP_OK;
+}
+
+static int cmd_export(Batch *b, BatchCmd *cmd) {
+    HackPad *nb = b->nb;
+    if (cmd->n != 3) return batch_fail(b, HP_ERR_SYNTAX, "usage: export SECTION PATH [where FILTER]");
+    int sid = section_by_name(b, cmd->w[1], 0);
+    if (sid < 0) return sid;
+
+    int rc = set_filter(nb, cmd->filter ? cmd->filter : "");
+    if (rc == HP_OK) rc = export_section(nb, find_section_index_by_id(nb, sid), cmd->w[2]);
+    set_filter(nb, "");
+    return rc;
+}
+
+/* Tag name of a set-tag word: "+#x", "-x", "#x" -> "x"; NULL when empty */
+static const char *tag_word(const char *v) {
+    v += v[0] == '+' || v[0] == '-';
+    v += v[0] == '#';
+    return *v ? v : NULL;
+}
+
+/* Does the space separated list hold tag, ignoring ASCII case? */
+static int has_tag(const char *list, const char *tag) {
+    size_t n = strlen(tag);
+    for (const char *p = list; *p; ) {
+        const char *end = strchr(p, ' ');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len == n && strncasecmp(p, tag, n) == 0) return 1;
+        p += len + (end != NULL);
+    }
+    return 0;
+}
+
+static int cmd_set_tag(Batch *b, BatchCmd *cmd) {
+    HackPad *nb = b->nb;
+    int ntags = cmd->filter ? cmd->n - 1 : cmd->n - 2;
+    if (ntags < 0) return batch_fail(b, HP_ERR_SYNTAX, "usage: set-tag ID TAG... | set-tag TAG... where FILTER");
+    char **tags = cmd->w + (cmd->filter ? 1 : 2);
+
+    /* plain tags replace the set; with none the current tags are edited */
+    int replace = 0;
+    for (int t = 0; t < ntags; t++) {
+        if (!tag_word(tags[t])) return batch_fail(b, HP_ERR_SYNTAX, "Bad tag '%s'", tags[t]);
+        if (tags[t][0] != '+' && tags[t][0] != '-') replace = 1;
+    }
+
+    int *sel;
+    int count = select_entries(b, cmd, cmd->filter ? NULL : cmd->w[1], &sel);
+    if (count < 0) return count;
+
+    int rc = HP_OK;
+    for (int k = 0; k < count && rc == HP_OK; k++) {
+        const Entry *e = &nb->entries[sel[k]];
+        char cur[MAX_TEXT] = "", next[MAX_TEXT] = "";
+        for (int t = 0; t < e->tag_count; t++) append_tag(cur, sizeof(cur), tag_name(nb, e->tags[t]));
+
+        /* kept or added tags, then the drops, so "-x" wins over a plain or added x */
+        char list[MAX_TEXT];
+        strcpy(list, replace ? "" : cur);
+        for (int t = 0; t < ntags; t++) {
+            const char *v = tag_word(tags[t]);
+            if (tags[t][0] != '-' && !has_tag(list, v)) append_tag(list, sizeof(list), v);
+        }
+        for (char *p = list, *end; *p; p = end ? end + 1 : p + strlen(p)) {
+            if ((end = strchr(p, ' '))) *end = '\0';
+            int drop = 0;
+            for (int t = 0; t < ntags && !drop; t++)
+                drop = tags[t][0] == '-' && strcasecmp(p, tag_word(tags[t])) == 0;
+            if (!drop) append_tag(next, sizeof(next), p);
+        }
+        if (strcmp(next, cur) != 0) rc = update_entry_tags(nb, sel[k], next);
+    }
+    free(sel);
+    return rc;
+}
+
+static int cmd_complete(Batch *b, BatchCmd *cmd) {
+    HackPad *nb = b->nb;
+    if (cmd->filter ? cmd->n != 1 : cmd->n != 2) return batch_fail(b, HP_ERR_SYNTAX, "usage: complete ID | where FILTER");
+
+    int *sel;
+    int count = select_entries(b, cmd, cmd->filter ? NULL : cmd->w[1], &sel);
+    if (count < 0) return count;
+
+    int rc = HP_OK;
+    for (int k = 0; k < count && rc == HP_OK; k++) {
+        EntryHot h = entry_hot(nb, sel[k]);
+        if (h.completed) continue;
+        h.completed = 1;
+        rc = update_entry_attrs(nb, sel[k], &h);
+    }
+    free(sel);
+    return rc;
+}
+
+static int run_cmd(Batch *b, BatchCmd *cmd) {
+    if (cmd->filter && strcmp(cmd->w[0], "query") != 0) {
+        const char *p = cmd->filter;
+        while (is_blank(*p)) p++;
+        if (!*p) return batch_fail(b, HP_ERR_SYNTAX, "where needs a filter");
+    }
+    static const struct { const char *name; int (*run)(Batch *, BatchCmd *); } cmds[] = {
+        {"add", cmd_add}, {"import", cmd_import}, {"import-scan", cmd_import_scan}, {"merge", cmd_merge},
+        {"query", cmd_query}, {"export", cmd_export}, {"set-tag", cmd_set_tag}, {"complete", cmd_complete}
+    };
+    for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++)
+        if (strcmp(cmd->w[0], cmds[i].name) == 0) return cmds[i].run(b, cmd);
+    return batch_fail(b, HP_ERR_SYNTAX, "Unknown command '%s'", cmd->w[0]);
+}
+
+/* ---------------- Entry point ---------------- */
+
+static void report(Batch *b, int rc) {
+    const char *why = b->nb->error[0] ? b->nb->error : hp_strerror(rc);
+    if (b->from_argv) fprintf(stderr, "HackPad: %s\n", why);
+    else fprintf(stderr, "HackPad: line %ld: %s\n", b->line, why);
+}
+
+/* argv[0] is "--batch"; returns the exit status */
+int batch_main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: HackPad --batch FILE [COMMAND ARGS...]\n");
+        return 2;
+    }
+
+    HackPad nb;
+    Batch b;
+    memset(&b, 0, sizeof(b));
+    b.nb = &nb;
+    b.in = stdin;
+    b.from_argv = argc > 2;
+
+    /* never save over a file that could not be read */
+    int rc = open_hackpad(&nb, argv[1]);
+    if (rc != HP_OK) {
+        report(&b, rc);
+        close_hackpad(&nb);
+        return 1;
+    }
+    journal_suspend(&nb);
+    /* a replayed journal alone is no reason to write: another session may
+       still be appending to it */
+    unsigned long opened_gen = nb.data_gen;
+
+    BatchCmd cmd;
+    if (b.from_argv) {
+        char filter[MAX_FILTER_LEN];
+        rc = parse_args(&b, argc - 2, argv + 2, &cmd, filter, sizeof(filter));
+        if (rc == HP_OK) rc = run_cmd(&b, &cmd);
+    } else {
+        char *line = NULL;
+        size_t cap = 0;
+        ssize_t len;
+        while (rc == HP_OK && (len = getline(&line, &cap, stdin)) >= 0) {
+            b.line++;
+            while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+            char *p = line;
+            while (is_blank(*p)) p++;
+            if (!*p || *p == '#') continue;
+            rc = parse_line(&b, p, &cmd);
+            if (rc == HP_OK) rc = run_cmd(&b, &cmd);
+        }
+        free(line);
+    }
+
+    if (rc == HP_OK && fflush(stdout) != 0) rc = batch_fail(&b, HP_ERR_IO, "Could not write to stdout");
+    if (rc == HP_OK && nb.data_gen != opened_gen) {
+        nb.error[0] = '\0';
+        rc = save_hackpad(&nb, nb.filename);
+    }
+    if (rc != HP_OK) report(&b, rc);
+    close_hackpad(&nb);
+    return rc == HP_OK ? 0 : 1;
+}
@@ -0,0 +1,4098 @@
+/*  HackPad core - the notebook engine behind HackPad
+    Copyright (C) 2025  <Kasem Shibli> <kasem545@proton.me>
+
+    Everything but the terminal: the data model, markdown and .hpb
+    load/save, autosave, journal, undo, filters, search and the edits
+    themselves. No curses and no prompts here; hackpad_core.h is the API.
+
+    Compile with the ncurses frontend:
+      gcc hackpad.c hackpad_batch.c hackpad_scan.c hackpad_core.c -lncurses -lpthread -o HackPad
+
+    or with any other program (bench/, batch tools):
+      gcc tool.c hackpad_core.c -lpthread
+
+    The Makefile does both (make, make core). hackpad_core_internal.h
+    declares the few internals bench/ and tests/ reach past the API.
+*/
+
+#define _XOPEN_SOURCE 700
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <time.h>
+#include <strings.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hackpad_core_internal.h"
+
+#define ARENA_CHUNK   (64 * 1024)
+
+/* ---------------- Status codes ---------------- */
+
+const char *hp_strerror(int code) {
+    switch (code) {
+        case HP_OK:           return "OK";
+        case HP_ERR_NOMEM:    return "out of memory";
+        case HP_ERR_IO:       return "I/O error";
+        case HP_ERR_SYNTAX:   return "syntax error";
+        case HP_ERR_NOTFOUND: return "not found";
+        case HP_ERR_LIMIT:    return "limit exceeded";
+        case HP_ERR_NOOP:     return "nothing to do";
+        case HP_ERR_STATE:    return "does not match the notebook";
+        default:              return "unknown error";
+    }
+}
+
+/* Leave the reason for a failure in nb->error; returns code */
+static int hp_fail(HackPad *nb, int code, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(nb->error, sizeof(nb->error), fmt, ap);
+    va_end(ap);
+    return code;
+}
+
+/* ---------------- Case-insensitive substring search ---------------- */
+
+/* hp_memcasemem() finds needle in haystack ignoring ASCII case (what
+   strncasecmp does in the C locale). The vector versions compare the folded
+   first and last needle bytes against 16/32 haystack positions at once and
+   only verify the middle where both hit. The widest version the CPU supports
+   is picked on first use; the scalar one covers everything else and the tails. */
+
+#ifdef HACKPAD_X86_SIMD
+  #include <immintrin.h>
+#endif
+
+static inline unsigned char fold_byte(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static inline int fold_eq(const char *a, const char *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (fold_byte((unsigned char)a[i]) != fold_byte((unsigned char)b[i])) return 0;
+    }
+    return 1;
+}
+
+const char *memcasemem_scalar(const char *h, size_t hlen, const char *n, size_t nlen) {
+    unsigned char first = fold_byte((unsigned char)n[0]);
+    unsigned char last = fold_byte((unsigned char)n[nlen - 1]);
+    for (size_t i = 0; i + nlen <= hlen; i++) {
+        if (fold_byte((unsigned char)h[i]) != first) continue;
+        if (fold_byte((unsigned char)h[i + nlen - 1]) != last) continue;
+        if (fold_eq(h + i + 1, n + 1, nlen < 2 ? 0 : nlen - 2)) return h + i;
+    }
+    return NULL;
+}
+
+#ifdef HACKPAD_X86_SIMD
+
+/* 'A'..'Z' -> 'a'..'z'; bytes >= 0x80 compare negative and stay put */
+static inline __m128i fold_sse2(__m128i x) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(x, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+const char *memcasemem_sse2(const char *h, size_t hlen, const char *n, size_t nlen) {
+    const __m128i first = _mm_set1_epi8((char)fold_byte((unsigned char)n[0]));
+    const __m128i last = _mm_set1_epi8((char)fold_byte((unsigned char)n[nlen - 1]));
+    size_t mid = nlen < 2 ? 0 : nlen - 2;
+
+    size_t i = 0;
+    for (; i + nlen - 1 + 16 <= hlen; i += 16) {
+        __m128i a = fold_sse2(_mm_loadu_si128((const __m128i*)(h + i)));
+        __m128i b = fold_sse2(_mm_loadu_si128((const __m128i*)(h + i + nlen - 1)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                                  _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (fold_eq(h + at + 1, n + 1, mid)) return h + at;
+            mask &= mask - 1;
+        }
+    }
+    return i + nlen <= hlen ? memcasemem_scalar(h + i, hlen - i, n, nlen) : NULL;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fold_avx2(__m256i x) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), x));
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+const char *memcasemem_avx2(const char *h, size_t hlen, const char *n, size_t nlen) {
+    const __m256i first = _mm256_set1_epi8((char)fold_byte((unsigned char)n[0]));
+    const __m256i last = _mm256_set1_epi8((char)fold_byte((unsigned char)n[nlen - 1]));
+    size_t mid = nlen < 2 ? 0 : nlen - 2;
+
+    size_t i = 0;
+    for (; i + nlen - 1 + 32 <= hlen; i += 32) {
+        __m256i a = fold_avx2(_mm256_loadu_si256((const __m256i*)(h + i)));
+        __m256i b = fold_avx2(_mm256_loadu_si256((const __m256i*)(h + i + nlen - 1)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                                        _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (fold_eq(h + at + 1, n + 1, mid)) return h + at;
+            mask &= mask - 1;
+        }
+    }
+    /* the SSE2 tail is legacy-encoded: clear the upper halves first
+       (gcc drops its own vzeroupper when this becomes a tail call) */
+    _mm256_zeroupper();
+    return i + nlen <= hlen ? memcasemem_sse2(h + i, hlen - i, n, nlen) : NULL;
+}
+
+#endif
+
+static MemcasememFn memcasemem_select(void) {
+#ifdef HACKPAD_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return memcasemem_avx2;
+    return memcasemem_sse2;
+#else
+    return memcasemem_scalar;
+#endif
+}
+
+static MemcasememFn memcasemem_impl;
+
+static const char *hp_memcasemem(const char *h, size_t hlen, const char *n, size_t nlen) {
+    if (nlen == 0) return h;
+    if (nlen > hlen) return NULL;
+    if (!memcasemem_impl) memcasemem_impl = memcasemem_select();
+    return memcasemem_impl(h, hlen, n, nlen);
+}
+
+/* ---------------- Storage ---------------- */
+
+static int grow_capacity(int cap, int need) {
+    int n = cap > 0 ? cap : 16;
+    while (n < need) n *= 2;
+    return n;
+}
+
+static int reserve_sections(HackPad *nb, int need) {
+    if (need <= nb->section_cap) return 1;
+    int cap = grow_capacity(nb->section_cap, need);
+    Section *p = (Section*)realloc(nb->sections, (size_t)cap * sizeof(Section));
+    if (!p) return 0;
+    nb->sections = p;
+    nb->section_cap = cap;
+    return 1;
+}
+
+static int reserve_entries(HackPad *nb, int need) {
+    if (need <= nb->entry_cap) return 1;
+    int cap = grow_capacity(nb->entry_cap, need);
+    Entry *p = (Entry*)realloc(nb->entries, (size_t)cap * sizeof(Entry));
+    if (!p) return 0;
+    nb->entries = p;
+
+    uint8_t **cols[] = { &nb->cols.depth, &nb->cols.flags, &nb->cols.priority, &nb->cols.color };
+    for (size_t c = 0; c < sizeof(cols) / sizeof(cols[0]); c++) {
+        uint8_t *q = (uint8_t*)realloc(*cols[c], (size_t)cap);
+        if (!q) return 0;
+        *cols[c] = q;
+    }
+    int **links[] = { &nb->entry_next, &nb->entry_prev };
+    for (size_t l = 0; l < sizeof(links) / sizeof(links[0]); l++) {
+        int *q = (int*)realloc(*links[l], (size_t)cap * sizeof(int));
+        if (!q) return 0;
+        *links[l] = q;
+    }
+    nb->entry_cap = cap;
+    return 1;
+}
+
+static void cols_free(EntryCols *c) {
+    free(c->depth);
+    free(c->flags);
+    free(c->priority);
+    free(c->color);
+    memset(c, 0, sizeof(*c));
+}
+
+EntryHot entry_hot(const HackPad *nb, int i) {
+    const EntryCols *c = &nb->cols;
+    EntryHot h;
+    h.depth = c->depth[i];
+    h.collapsed = (c->flags[i] & EF_COLLAPSED) != 0;
+    h.completed = (c->flags[i] & EF_COMPLETED) != 0;
+    h.pinned = (c->flags[i] & EF_PINNED) != 0;
+    h.priority = (Priority)c->priority[i];
+    h.color = (UiColor)c->color[i];
+    return h;
+}
+
+static void entry_set_hot(HackPad *nb, int i, const EntryHot *h) {
+    EntryCols *c = &nb->cols;
+    c->depth[i] = (uint8_t)h->depth;
+    c->flags[i] = (uint8_t)((h->collapsed ? EF_COLLAPSED : 0) | (h->completed ? EF_COMPLETED : 0) |
+                            (h->pinned ? EF_PINNED : 0));
+    c->priority[i] = (uint8_t)h->priority;
+    c->color[i] = (uint8_t)h->color;
+}
+
+static void entry_set_flag(HackPad *nb, int i, int flag, int on) {
+    if (on) nb->cols.flags[i] |= (uint8_t)flag;
+    else nb->cols.flags[i] &= (uint8_t)~flag;
+}
+
+int entry_flag(const HackPad *nb, int i, int flag) { return (nb->cols.flags[i] & flag) != 0; }
+
+/* A zeroed entry slot with hot attributes h, in no list yet; -1 on OOM */
+static int alloc_entry_slot(HackPad *nb, const EntryHot *h) {
+    int slot;
+    if (nb->entry_free) {
+        slot = nb->entry_free - 1;
+        nb->entry_free = nb->entry_next[slot] + 1;
+    } else {
+        if (!reserve_entries(nb, nb->entry_slots + 1)) return -1;
+        slot = nb->entry_slots++;
+    }
+    memset(&nb->entries[slot], 0, sizeof(Entry));
+    entry_set_hot(nb, slot, h);
+    nb->entry_next[slot] = nb->entry_prev[slot] = -1;
+    nb->entry_count++;
+    return slot;
+}
+
+/* slot must already be out of its section's list */
+static void free_entry_slot(HackPad *nb, int slot) {
+    memset(&nb->entries[slot], 0, sizeof(Entry));
+    nb->entries[slot].id = -1;
+    nb->entries[slot].text = "";
+    nb->entry_next[slot] = nb->entry_free - 1;
+    nb->entry_free = slot + 1;
+    nb->entry_count--;
+}
+
+int entry_live(const HackPad *nb, int slot) { return nb->entries[slot].id >= 0; }
+
+/* Lists are walked by position (journal records, undo), so each section keeps
+   one (slot, position) pair: lookups start from the nearest of the front, the
+   back and that hint, and edits cluster around the cursor. Linking and
+   unlinking keep the hint where they can tell how it moves, and drop it
+   otherwise. */
+static void note_position(Section *s, int slot, int pos) {
+    s->pos_slot = slot + 1;
+    s->pos = pos;
+}
+
+/* Put slot into s's list right after 'after' (-1: at the front) */
+static void link_entry(HackPad *nb, Section *s, int slot, int after) {
+    int next = after >= 0 ? nb->entry_next[after] : s->first_entry;
+    nb->entry_prev[slot] = after;
+    nb->entry_next[slot] = next;
+    if (after >= 0) nb->entry_next[after] = slot;
+    else s->first_entry = slot;
+    if (next >= 0) nb->entry_prev[next] = slot;
+    else s->last_entry = slot;
+    s->entry_count++;
+
+    if (next < 0) note_position(s, slot, s->entry_count - 1);
+    else if (after < 0) note_position(s, slot, 0);
+    else if (s->pos_slot - 1 == after) note_position(s, slot, s->pos + 1);
+    else if (s->pos_slot - 1 == next) note_position(s, slot, s->pos);
+    else s->pos_slot = 0;
+}
+
+/* Take the run first..last (count entries) out of s's list; the slots stay allocated */
+static void unlink_entries(HackPad *nb, Section *s, int first, int last, int count) {
+    int prev = nb->entry_prev[first], next = nb->entry_next[last];
+    if (prev >= 0) nb->entry_next[prev] = next;
+    else s->first_entry = next;
+    if (next >= 0) nb->entry_prev[next] = prev;
+    else s->last_entry = prev;
+    s->entry_count -= count;
+
+    if (prev < 0 && next >= 0) note_position(s, next, 0);
+    else if (next < 0 && prev >= 0) note_position(s, prev, s->entry_count - 1);
+    else if (next >= 0 && s->pos_slot - 1 == next) s->pos -= count;
+    else if (prev < 0 || s->pos_slot - 1 != prev) s->pos_slot = 0;
+}
+
+/* The n-th entry slot of s, -1 if there is none */
+int entry_at(const HackPad *nb, Section *s, int n) {
+    if (n < 0 || n >= s->entry_count) return -1;
+    int i = s->first_entry, from = 0;
+    if (s->entry_count - 1 - n < n) {
+        i = s->last_entry;
+        from = s->entry_count - 1;
+    }
+    if (s->pos_slot && abs(n - s->pos) < abs(n - from)) {
+        i = s->pos_slot - 1;
+        from = s->pos;
+    }
+    for (; from < n; from++) i = nb->entry_next[i];
+    for (; from > n; from--) i = nb->entry_prev[i];
+    note_position(s, i, n);
+    return i;
+}
+
+/* Where slot sits in its section s, counted from the front. Walks both ways
+   at once until it meets an end of the list or the hint. */
+static int entry_position(const HackPad *nb, Section *s, int slot) {
+    int hint = s->pos_slot - 1, back = slot, fwd = slot, pos;
+    for (int n = 0;; n++) {
+        if (back == hint) { pos = s->pos + n; break; }
+        if (fwd == hint) { pos = s->pos - n; break; }
+        if (nb->entry_prev[back] < 0) { pos = n; break; }
+        if (nb->entry_next[fwd] < 0) { pos = s->entry_count - 1 - n; break; }
+        back = nb->entry_prev[back];
+        fwd = nb->entry_next[fwd];
+    }
+    note_position(s, slot, pos);
+    return pos;
+}
+
+/* Append a zeroed section, or an entry slot (hot attributes h) at the end of s; NULL on OOM */
+Section *append_section(HackPad *nb) {
+    if (!reserve_sections(nb, nb->section_count + 1)) return NULL;
+    Section *s = &nb->sections[nb->section_count++];
+    memset(s, 0, sizeof(*s));
+    s->first_entry = s->last_entry = -1;
+    return s;
+}
+
+Entry *append_entry(HackPad *nb, Section *s, const EntryHot *h) {
+    int slot = alloc_entry_slot(nb, h);
+    if (slot < 0) return NULL;
+    link_entry(nb, s, slot, s->last_entry);
+    return &nb->entries[slot];
+}
+
+/* ---------------- String arena / tag interning ---------------- */
+
+static const char *arena_strndup(StrArena *a, const char *s, size_t len) {
+    ArenaChunk *c = a->count > 0 ? &a->chunks[a->count - 1] : NULL;
+
+    if (!c || c->cap - c->used < len + 1) {
+        if (a->count == a->cap) {
+            int cap = grow_capacity(a->cap, a->count + 1);
+            ArenaChunk *p = (ArenaChunk*)realloc(a->chunks, (size_t)cap * sizeof(ArenaChunk));
+            if (!p) return NULL;
+            a->chunks = p;
+            a->cap = cap;
+        }
+        size_t sz = len + 1 > ARENA_CHUNK ? len + 1 : ARENA_CHUNK;
+        char *base = (char*)malloc(sz);
+        if (!base) return NULL;
+        c = &a->chunks[a->count++];
+        c->base = base;
+        c->used = 0;
+        c->cap = sz;
+    }
+
+    char *dst = c->base + c->used;
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    c->used += len + 1;
+    return dst;
+}
+
+static void arena_free(StrArena *a) {
+    for (int i = 0; i < a->count; i++) free(a->chunks[i].base);
+    free(a->chunks);
+    memset(a, 0, sizeof(*a));
+}
+
+static uint32_t hash_bytes(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) { h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+static uint32_t hash_folded(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) { h ^= fold_byte((unsigned char)s[i]); h *= 16777619u; }
+    return h;
+}
+
+static void tagdict_slot_put(int *slots, int slot_cap, uint32_t h, int id) {
+    int k = (int)(h & (uint32_t)(slot_cap - 1));
+    while (slots[k] >= 0) k = (k + 1) & (slot_cap - 1);
+    slots[k] = id;
+}
+
+static int tagdict_rehash(TagDict *d, int slot_cap) {
+    int *slots = (int*)malloc((size_t)slot_cap * sizeof(int));
+    int *fold_slots = (int*)malloc((size_t)slot_cap * sizeof(int));
+    if (!slots || !fold_slots) { free(slots); free(fold_slots); return 0; }
+    for (int i = 0; i < slot_cap; i++) slots[i] = fold_slots[i] = -1;
+    for (int id = 0; id < d->count; id++) {
+        size_t len = strlen(d->names[id]);
+        tagdict_slot_put(slots, slot_cap, hash_bytes(d->names[id], len), id);
+        if (d->fold[id] == id) tagdict_slot_put(fold_slots, slot_cap, hash_folded(d->names[id], len), id);
+    }
+    free(d->slots);
+    free(d->fold_slots);
+    d->slots = slots;
+    d->fold_slots = fold_slots;
+    d->slot_cap = slot_cap;
+    return 1;
+}
+
+/* Fold class of tag[0..len) ignoring ASCII case, -1 if no spelling of it exists */
+static int tag_class(const TagDict *d, const char *tag, size_t len) {
+    if (d->slot_cap == 0) return -1;
+    int k = (int)(hash_folded(tag, len) & (uint32_t)(d->slot_cap - 1));
+    while (d->fold_slots[k] >= 0) {
+        const char *n = d->names[d->fold_slots[k]];
+        if (strncasecmp(n, tag, len) == 0 && n[len] == '\0') return d->fold_slots[k];
+        k = (k + 1) & (d->slot_cap - 1);
+    }
+    return -1;
+}
+
+/* Returns the id of tag[0..len), adding it if new; HP_ERR_LIMIT past
+   UINT16_MAX distinct tags or HP_ERR_NOMEM, with nb->error set */
+int intern_tag(HackPad *nb, const char *tag, size_t len) {
+    TagDict *d = &nb->tags;
+    uint32_t h = hash_bytes(tag, len);
+
+    if (d->slot_cap > 0) {
+        int k = (int)(h & (uint32_t)(d->slot_cap - 1));
+        while (d->slots[k] >= 0) {
+            const char *n = d->names[d->slots[k]];
+            if (strncmp(n, tag, len) == 0 && n[len] == '\0') return d->slots[k];
+            k = (k + 1) & (d->slot_cap - 1);
+        }
+    }
+
+    if (d->count >= UINT16_MAX) return hp_fail(nb, HP_ERR_LIMIT, "More than %d distinct tags", UINT16_MAX);
+    if (d->count == d->cap) {
+        int cap = grow_capacity(d->cap, d->count + 1);
+        const char **p = (const char**)realloc((void*)d->names, (size_t)cap * sizeof(char*));
+        if (!p) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+        d->names = p;
+        uint16_t *f = (uint16_t*)realloc(d->fold, (size_t)cap * sizeof(uint16_t));
+        if (!f) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+        d->fold = f;
+        d->cap = cap;
+    }
+    const char *name = arena_strndup(&nb->strings, tag, len);
+    if (!name) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+
+    int id = d->count;
+    int cls = tag_class(d, tag, len);
+    d->names[id] = name;
+    d->fold[id] = (uint16_t)(cls >= 0 ? cls : id);
+    d->count++;
+
+    if (d->count * 2 > d->slot_cap) {
+        if (!tagdict_rehash(d, d->slot_cap ? d->slot_cap * 2 : 64)) {
+            d->count--;
+            return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+        }
+    } else {
+        tagdict_slot_put(d->slots, d->slot_cap, h, id);
+        if (cls < 0) tagdict_slot_put(d->fold_slots, d->slot_cap, hash_folded(tag, len), id);
+    }
+    return id;
+}
+
+const char *tag_name(HackPad *nb, int id) {
+    return (id >= 0 && id < nb->tags.count) ? nb->tags.names[id] : "";
+}
+
+int entry_set_text(HackPad *nb, Entry *e, const char *txt) {
+    size_t len = strlen(txt);
+    const char *p = arena_strndup(&nb->strings, txt, len);
+    if (!p) return 0;
+    e->text = p;
+    e->text_len = (int)len;
+    return 1;
+}
+
+/* Replace e's tags with the tokens of buf split on any char in delims;
+   HP_OK or intern_tag's error, with e's tags left partly set */
+static int entry_set_tags(HackPad *nb, Entry *e, char *buf, const char *delims) {
+    e->tag_count = 0;
+    char *tag = strtok(buf, delims);
+    while (tag && e->tag_count < MAX_TAGS) {
+        int id = intern_tag(nb, tag, strlen(tag));
+        if (id < 0) return id;
+        e->tags[e->tag_count++] = (uint16_t)id;
+        tag = strtok(NULL, delims);
+    }
+    return HP_OK;
+}
+
+/* ---------------- Id -> index maps ---------------- */
+
+static int reserve_id_map(int **map, int *cap, int need) {
+    if (need <= *cap) return 1;
+    int n = grow_capacity(*cap, need);
+    int *p = (int*)realloc(*map, (size_t)n * sizeof(int));
+    if (!p) return 0;
+    for (int i = *cap; i < n; i++) p[i] = -1;
+    *map = p;
+    *cap = n;
+    return 1;
+}
+
+/* Refresh the map for every slot from 'from' on, after a section shift or a load */
+void reindex_sections(HackPad *nb, int from) {
+    if (!reserve_id_map(&nb->section_index_by_id, &nb->section_index_cap, nb->next_section_id)) return;
+    for (int i = from; i < nb->section_count; i++) nb->section_index_by_id[nb->sections[i].id] = i;
+}
+
+void reindex_entries(HackPad *nb, int from) {
+    if (!reserve_id_map(&nb->entry_index_by_id, &nb->entry_index_cap, nb->next_entry_id)) return;
+    for (int i = from; i < nb->entry_slots; i++)
+        if (entry_live(nb, i)) nb->entry_index_by_id[nb->entries[i].id] = i;
+}
+
+static void unindex_section(HackPad *nb, int id) {
+    if (id >= 0 && id < nb->section_index_cap) nb->section_index_by_id[id] = -1;
+}
+
+static void unindex_entry(HackPad *nb, int id) {
+    if (id >= 0 && id < nb->entry_index_cap) nb->entry_index_by_id[id] = -1;
+}
+
+static void search_free(SearchIndex *x);
+
+void free_hackpad(HackPad *nb) {
+    free(nb->vis_sections.idx);
+    free(nb->vis_entries.idx);
+    memset(&nb->vis_sections, 0, sizeof(nb->vis_sections));
+    memset(&nb->vis_entries, 0, sizeof(nb->vis_entries));
+    free(nb->section_index_by_id);
+    free(nb->entry_index_by_id);
+    nb->section_index_by_id = nb->entry_index_by_id = NULL;
+    nb->section_index_cap = nb->entry_index_cap = 0;
+    arena_free(&nb->strings);
+    free((void*)nb->tags.names);
+    free(nb->tags.fold);
+    free(nb->tags.slots);
+    free(nb->tags.fold_slots);
+    memset(&nb->tags, 0, sizeof(nb->tags));
+    free(nb->sections);
+    free(nb->entries);
+    cols_free(&nb->cols);
+    free(nb->entry_next);
+    free(nb->entry_prev);
+    nb->sections = NULL;
+    nb->entries = NULL;
+    nb->entry_next = nb->entry_prev = NULL;
+    nb->section_count = nb->section_cap = 0;
+    nb->entry_count = nb->entry_cap = nb->entry_slots = nb->entry_free = 0;
+    search_free(&nb->search);
+    if (nb->hpb_map) munmap((void*)nb->hpb_map, nb->hpb_len);
+    nb->hpb_map = NULL;
+    nb->hpb_len = 0;
+}
+
+/* ---------------- Helpers ---------------- */
+
+const char* priority_str(Priority p) {
+    switch(p) {
+        case PRIORITY_CRITICAL: return "P0";
+        case PRIORITY_HIGH:     return "P1";
+        case PRIORITY_MEDIUM:   return "P2";
+        case PRIORITY_LOW:      return "P3";
+        default:                return "";
+    }
+}
+
+const char* color_str(UiColor c) {
+    switch(c) {
+        case HP_COLOR_RED:     return "RED";
+        case HP_COLOR_GREEN:   return "GREEN";
+        case HP_COLOR_YELLOW:  return "YELLOW";
+        case HP_COLOR_ORANGE:  return "ORANGE";
+        case HP_COLOR_MAGENTA: return "MAGENTA";
+        case HP_COLOR_CYAN:    return "CYAN";
+        case HP_COLOR_WHITE:   return "WHITE";
+        default:               return "";
+    }
+}
+
+/* Span helpers for the loader: [s, end) is never NUL-terminated */
+static const char *skip_char(const char *s, const char *end, char c) {
+    while (s < end && *s == c) s++;
+    return s;
+}
+
+static const char *rtrim_span(const char *s, const char *end) {
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    return end;
+}
+
+static int span_starts(const char *s, const char *end, const char *lit) {
+    size_t n = strlen(lit);
+    return (size_t)(end - s) >= n && memcmp(s, lit, n) == 0;
+}
+
+/* O(1) via the id maps; the scan only runs if a map could not be grown */
+int find_section_index_by_id(HackPad *nb, int id) {
+    if (id < 0) return -1;
+    if (id < nb->section_index_cap) return nb->section_index_by_id[id];
+    for (int i = 0; i < nb->section_count; i++)
+        if (nb->sections[i].id == id) return i;
+    return -1;
+}
+
+int find_entry_index_by_id(HackPad *nb, int id) {
+    if (id < 0) return -1;
+    if (id < nb->entry_index_cap) return nb->entry_index_by_id[id];
+    for (int i = 0; i < nb->entry_slots; i++)
+        if (nb->entries[i].id == id) return i;
+    return -1;
+}
+
+/* ---------------- Tag expressions ---------------- */
+
+/* "#smb & #creds & !#tested", "web | (#smb !#tested)": '!' binds tightest,
+   then '&' (also implied between adjacent terms), then '|'. The '#' is
+   optional and tags compare ignoring ASCII case. Compiled to postfix code;
+   an entry is matched by testing its tag classes against the terms once and
+   running the code over the resulting bits. */
+
+typedef struct {
+    TagQuery *q;
+    const char *p;
+    const char *err;
+} TagqParser;
+
+static void tagq_skip(TagqParser *ps) {
+    while (*ps->p == ' ' || *ps->p == '\t') ps->p++;
+}
+
+static int tagq_emit(TagqParser *ps, int op) {
+    if (ps->q->len >= TAGQ_MAX_CODE) { ps->err = "expression too long"; return 0; }
+    ps->q->code[ps->q->len++] = (uint8_t)op;
+    return 1;
+}
+
+static int tagq_or(TagqParser *ps);
+
+static int tagq_unary(TagqParser *ps) {
+    tagq_skip(ps);
+    if (*ps->p == '!') {
+        ps->p++;
+        return tagq_unary(ps) && tagq_emit(ps, TAGQ_NOT);
+    }
+    if (*ps->p == '(') {
+        ps->p++;
+        if (!tagq_or(ps)) return 0;
+        tagq_skip(ps);
+        if (*ps->p != ')') { ps->err = "missing ')'"; return 0; }
+        ps->p++;
+        return 1;
+    }
+
+    if (*ps->p == '#') ps->p++;
+    const char *t = ps->p;
+    while (*ps->p && !strchr(" \t&|!()", *ps->p)) ps->p++;
+    if (ps->p == t) { ps->err = "expected a tag"; return 0; }
+
+    TagQuery *q = ps->q;
+    int off = (int)(t - q->text), len = (int)(ps->p - t);
+    int n = 0;
+    while (n < q->nterms &&
+           !(q->term_len[n] == len && strncasecmp(q->text + q->term_off[n], t, (size_t)len) == 0)) n++;
+    if (n == q->nterms) {
+        if (n == TAGQ_MAX_TERMS) { ps->err = "too many tags"; return 0; }
+        q->term_off[n] = off;
+        q->term_len[n] = len;
+        q->nterms++;
+    }
+    return tagq_emit(ps, n);
+}
+
+static int tagq_and(TagqParser *ps) {
+    if (!tagq_unary(ps)) return 0;
+    for (;;) {
+        tagq_skip(ps);
+        if (*ps->p == '&') {
+            while (*ps->p == '&') ps->p++;
+        } else if (!*ps->p || *ps->p == '|' || *ps->p == ')') {
+            return 1;
+        }
+        if (!tagq_unary(ps) || !tagq_emit(ps, TAGQ_AND)) return 0;
+    }
+}
+
+static int tagq_or(TagqParser *ps) {
+    if (!tagq_and(ps)) return 0;
+    for (;;) {
+        tagq_skip(ps);
+        if (*ps->p != '|') return 1;
+        while (*ps->p == '|') ps->p++;
+        if (!tagq_and(ps) || !tagq_emit(ps, TAGQ_OR)) return 0;
+    }
+}
+
+/* Look the terms up again; tags may have been added since */
+static void tagq_resolve(HackPad *nb, TagQuery *q) {
+    for (int n = 0; n < q->nterms; n++)
+        q->term_class[n] = tag_class(&nb->tags, q->text + q->term_off[n], (size_t)q->term_len[n]);
+    q->tags_seen = nb->tags.count;
+}
+
+/* Compile expr into *out. Returns 0 with *err set on a syntax error, leaving *out alone. */
+int tagq_compile(HackPad *nb, TagQuery *out, const char *expr, const char **err) {
+    TagQuery q;
+    memset(&q, 0, sizeof(q));
+    snprintf(q.text, sizeof(q.text), "%s", expr);
+
+    TagqParser ps = { &q, q.text, NULL };
+    tagq_skip(&ps);
+    if (*ps.p) {
+        if (!tagq_or(&ps)) { *err = ps.err; return 0; }
+        tagq_skip(&ps);
+        if (*ps.p) { *err = *ps.p == ')' ? "unmatched ')'" : "unexpected input"; return 0; }
+    }
+    tagq_resolve(nb, &q);
+    *out = q;
+    return 1;
+}
+
+static int tagq_match(HackPad *nb, TagQuery *q, const Entry *e) {
+    if (q->len == 0) return e->tag_count > 0;
+    if (q->tags_seen != nb->tags.count) tagq_resolve(nb, q);
+
+    uint32_t have = 0;
+    for (int i = 0; i < e->tag_count; i++) {
+        int cls = nb->tags.fold[e->tags[i]];
+        for (int n = 0; n < q->nterms; n++)
+            if (q->term_class[n] == cls) have |= 1u << n;
+    }
+
+    /* bit 0 of 'stack' is the top; depth never exceeds the term count */
+    uint32_t stack = 0;
+    for (int i = 0; i < q->len; i++) {
+        uint32_t top = stack & 1u;
+        switch (q->code[i]) {
+            case TAGQ_NOT: stack ^= 1u; break;
+            case TAGQ_AND: stack >>= 1; stack &= ~1u | top; break;
+            case TAGQ_OR:  stack >>= 1; stack |= top; break;
+            default:       stack = (stack << 1) | ((have >> q->code[i]) & 1u); break;
+        }
+    }
+    return (int)(stack & 1u);
+}
+
+/* ---------------- View filter ---------------- */
+
+/* A filter line is a list of words, all of which must hold:
+
+     p:0-1  p:0,2  p:none     priority P0..P3 (ranges/lists), or no priority
+     is:done is:open is:pinned is:unpinned is:tagged is:untagged
+     color:red,cyan color:none
+     mod:<7d  mod:>2h         modified within / longer ago than (s m h d w)
+     mod:2025-01-01..2025-01-31  mod:2025-01-05  mod:2025-01-01..
+     "some text"  text:word   substring of the entry text, ignoring case
+
+   Any other word belongs to the tag expression (see tagq_compile), which is
+   ANDed with the rest. Predicates are tested cheapest first, text last. */
+
+static int parse_day(const char *s, const char *end, int next, time_t *out) {
+    char buf[16];
+    int y, m, d, n = 0;
+    if (end - s <= 0 || end - s >= (long)sizeof(buf)) return 0;
+    memcpy(buf, s, (size_t)(end - s));
+    buf[end - s] = '\0';
+    if (sscanf(buf, "%4d-%2d-%2d%n", &y, &m, &d, &n) != 3 || buf[n]) return 0;
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = y - 1900;
+    tm.tm_mon = m - 1;
+    tm.tm_mday = d + (next ? 1 : 0);
+    tm.tm_isdst = -1;
+    *out = mktime(&tm);
+    return *out != (time_t)-1;
+}
+
+static int parse_duration(const char *s, const char *end, long *out) {
+    long v = 0;
+    if (s >= end || !isdigit((unsigned char)*s)) return 0;
+    while (s < end && isdigit((unsigned char)*s) && v < 100000000L) v = v * 10 + (*s++ - '0');
+    if (end - s != 1) return 0;
+    switch (*s) {
+        case 's': *out = v; return 1;
+        case 'm': *out = v * 60; return 1;
+        case 'h': *out = v * 3600; return 1;
+        case 'd': *out = v * 86400; return 1;
+        case 'w': *out = v * 604800; return 1;
+        default:  return 0;
+    }
+}
+
+static int parse_mod_window(ViewQuery *q, const char *v, const char *end) {
+    time_t now = time(NULL);
+    long secs;
+    q->mod_from = (time_t)LONG_MIN;
+    q->mod_to = (time_t)LONG_MAX;
+
+    if (*v == '<' || *v == '>') {
+        if (!parse_duration(v + 1, end, &secs)) return 0;
+        if (*v == '<') q->mod_from = now - secs;
+        else q->mod_to = now - secs;
+        return 1;
+    }
+
+    const char *dots = strstr(v, "..");
+    if (!dots || dots + 2 > end) return parse_day(v, end, 0, &q->mod_from) && parse_day(v, end, 1, &q->mod_to);
+    if (dots > v && !parse_day(v, dots, 0, &q->mod_from)) return 0;
+    if (dots + 2 < end && !parse_day(dots + 2, end, 1, &q->mod_to)) return 0;
+    return 1;
+}
+
+/* p: values are P numbers, Priority counts the other way round */
+static unsigned prio_bit(int pn) { return 1u << (PRIORITY_CRITICAL - pn); }
+
+static int parse_prio_list(ViewQuery *q, const char *v, const char *end) {
+    while (v < end) {
+        const char *c = memchr(v, ',', (size_t)(end - v));
+        if (!c) c = end;
+        size_t n = (size_t)(c - v);
+        if (n == 4 && strncasecmp(v, "none", 4) == 0) {
+            q->prio_mask |= 1u << PRIORITY_NONE;
+        } else if (n == 3 && strncasecmp(v, "any", 3) == 0) {
+            q->prio_mask |= ~(1u << PRIORITY_NONE) & 0x1f;
+        } else if (n == 1 && v[0] >= '0' && v[0] <= '3') {
+            q->prio_mask |= prio_bit(v[0] - '0');
+        } else if (n == 3 && v[0] >= '0' && v[0] <= '3' && v[1] == '-' && v[2] >= v[0] && v[2] <= '3') {
+            for (int pn = v[0] - '0'; pn <= v[2] - '0'; pn++) q->prio_mask |= prio_bit(pn);
+        } else {
+            return 0;
+        }
+        v = c + 1;
+    }
+    return q->prio_mask != 0;
+}
+
+static int parse_color_list(ViewQuery *q, const char *v, const char *end) {
+    while (v < end) {
+        const char *c = memchr(v, ',', (size_t)(end - v));
+        if (!c) c = end;
+        size_t n = (size_t)(c - v);
+        int found = 0;
+        for (int col = HP_COLOR_NONE; col <= HP_COLOR_WHITE && !found; col++) {
+            const char *name = col == HP_COLOR_NONE ? "none" : color_str((UiColor)col);
+            if (strlen(name) == n && strncasecmp(name, v, n) == 0) { q->color_mask |= 1u << col; found = 1; }
+        }
+        if (!found) return 0;
+        v = c + 1;
+    }
+    return q->color_mask != 0;
+}
+
+int set_filter_text(ViewQuery *q, const char *t, size_t len) {
+    if (len == 0 || len >= sizeof(q->text)) return 0;
+    memcpy(q->text, t, len);
+    q->text[len] = '\0';
+    q->text_len = (int)len;
+    q->preds |= VQ_TEXT;
+    return 1;
+}
+
+/* 1: handled, 0: bad value (*err set), -1: not a predicate key */
+static int viewq_predicate(ViewQuery *q, const char *k, size_t klen, const char *v, const char *end, const char **err) {
+    if (klen == 1 && k[0] == 'p') {
+        if (!parse_prio_list(q, v, end)) { *err = "p: takes 0-3, ranges like 0-1, none or any"; return 0; }
+        q->preds |= VQ_PRIORITY;
+        return 1;
+    }
+    if (klen == 2 && memcmp(k, "is", 2) == 0) {
+        static const struct { const char *name; unsigned pred; } is[] = {
+            {"done", VQ_DONE}, {"open", VQ_OPEN}, {"pinned", VQ_PINNED}, {"unpinned", VQ_UNPINNED},
+            {"tagged", VQ_TAGGED}, {"untagged", VQ_UNTAGGED}
+        };
+        for (size_t i = 0; i < sizeof(is) / sizeof(is[0]); i++) {
+            if (strlen(is[i].name) == (size_t)(end - v) && strncasecmp(is[i].name, v, (size_t)(end - v)) == 0) {
+                q->preds |= is[i].pred;
+                return 1;
+            }
+        }
+        *err = "is: takes done, open, pinned, unpinned, tagged or untagged";
+        return 0;
+    }
+    if (klen == 5 && memcmp(k, "color", 5) == 0) {
+        if (!parse_color_list(q, v, end)) { *err = "unknown color"; return 0; }
+        q->preds |= VQ_COLOR;
+        return 1;
+    }
+    if (klen == 3 && memcmp(k, "mod", 3) == 0) {
+        if ((size_t)(end - v) >= sizeof(q->mod_spec) || !parse_mod_window(q, v, end)) {
+            *err = "mod: takes <7d, >2h, a YYYY-MM-DD day or a from..to range";
+            return 0;
+        }
+        memcpy(q->mod_spec, v, (size_t)(end - v));
+        q->mod_spec[end - v] = '\0';
+        q->preds |= VQ_MODIFIED;
+        return 1;
+    }
+    if (klen == 4 && memcmp(k, "text", 4) == 0) {
+        if (!set_filter_text(q, v, (size_t)(end - v))) { *err = "text: needs a word"; return 0; }
+        return 1;
+    }
+    return -1;
+}
+
+/* Predicates left out allow every value */
+static void viewq_masks(ViewQuery *q) {
+    q->prio_ok = (q->preds & VQ_PRIORITY) ? q->prio_mask : ~0u;
+    q->color_ok = (q->preds & VQ_COLOR) ? q->color_mask : ~0u;
+    q->flags_ok = 0;
+    for (unsigned f = 0; f <= (EF_COLLAPSED | EF_COMPLETED | EF_PINNED); f++) {
+        if ((q->preds & VQ_DONE) && !(f & EF_COMPLETED)) continue;
+        if ((q->preds & VQ_OPEN) && (f & EF_COMPLETED)) continue;
+        if ((q->preds & VQ_PINNED) && !(f & EF_PINNED)) continue;
+        if ((q->preds & VQ_UNPINNED) && (f & EF_PINNED)) continue;
+        q->flags_ok |= 1u << f;
+    }
+}
+
+/* Compile a filter line into *out. Returns 0 with *err set on a bad word, leaving *out alone. */
+int viewq_compile(HackPad *nb, ViewQuery *out, const char *src, const char **err) {
+    ViewQuery q;
+    memset(&q, 0, sizeof(q));
+    char tags[MAX_TAG_LEN];
+    size_t tl = 0;
+
+    const char *p = src;
+    for (;;) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+
+        if (*p == '"') {
+            const char *close = strchr(p + 1, '"');
+            if (!close) { *err = "missing closing '\"'"; return 0; }
+            if (!set_filter_text(&q, p + 1, (size_t)(close - p - 1))) { *err = "bad quoted text"; return 0; }
+            p = close + 1;
+            continue;
+        }
+
+        const char *w = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+        const char *colon = memchr(w, ':', (size_t)(p - w));
+        int r = colon ? viewq_predicate(&q, w, (size_t)(colon - w), colon + 1, p, err) : -1;
+        if (r == 0) return 0;
+        if (r < 0) {
+            if (tl + (size_t)(p - w) + 2 > sizeof(tags)) { *err = "tag expression too long"; return 0; }
+            if (tl) tags[tl++] = ' ';
+            memcpy(tags + tl, w, (size_t)(p - w));
+            tl += (size_t)(p - w);
+        }
+    }
+    tags[tl] = '\0';
+
+    if (!tagq_compile(nb, &q.tags, tags, err)) return 0;
+    if (q.tags.len) q.preds |= VQ_TAGS;
+    viewq_masks(&q);
+    *out = q;
+    return 1;
+}
+
+static void viewq_append(char *buf, size_t size, const char *word) {
+    size_t n = strlen(buf);
+    if (n + 1 < size) snprintf(buf + n, size - n, "%s%s", n ? " " : "", word);
+}
+
+/* Canonical filter line for q; compiling it gives q back */
+void viewq_format(const ViewQuery *q, char *buf, size_t size) {
+    char w[MAX_NAME + 8];
+    buf[0] = '\0';
+    if (q->preds & VQ_TAGS) viewq_append(buf, size, q->tags.text);
+
+    if (q->preds & VQ_PRIORITY) {
+        size_t n = (size_t)snprintf(w, sizeof(w), "p:");
+        for (int pn = 0; pn <= 3; pn++) {
+            if (!(q->prio_mask & prio_bit(pn))) continue;
+            int last = pn;
+            while (last < 3 && (q->prio_mask & prio_bit(last + 1))) last++;
+            n += (size_t)snprintf(w + n, sizeof(w) - n, n > 2 ? ",%d" : "%d", pn);
+            if (last > pn) n += (size_t)snprintf(w + n, sizeof(w) - n, "-%d", last);
+            pn = last;
+        }
+        if (q->prio_mask & (1u << PRIORITY_NONE)) snprintf(w + n, sizeof(w) - n, n > 2 ? ",none" : "none");
+        viewq_append(buf, size, w);
+    }
+
+    if (q->preds & VQ_DONE)     viewq_append(buf, size, "is:done");
+    if (q->preds & VQ_OPEN)     viewq_append(buf, size, "is:open");
+    if (q->preds & VQ_PINNED)   viewq_append(buf, size, "is:pinned");
+    if (q->preds & VQ_UNPINNED) viewq_append(buf, size, "is:unpinned");
+    if (q->preds & VQ_TAGGED)   viewq_append(buf, size, "is:tagged");
+    if (q->preds & VQ_UNTAGGED) viewq_append(buf, size, "is:untagged");
+
+    if (q->preds & VQ_COLOR) {
+        size_t n = (size_t)snprintf(w, sizeof(w), "color:");
+        for (int col = HP_COLOR_NONE; col <= HP_COLOR_WHITE; col++) {
+            if (!(q->color_mask & (1u << col))) continue;
+            const char *name = col == HP_COLOR_NONE ? "none" : color_str((UiColor)col);
+            n += (size_t)snprintf(w + n, sizeof(w) - n, "%s", n > 6 ? "," : "");
+            for (; *name && n + 1 < sizeof(w); name++) w[n++] = (char)tolower((unsigned char)*name);
+            w[n] = '\0';
+        }
+        viewq_append(buf, size, w);
+    }
+
+    if (q->preds & VQ_MODIFIED) {
+        snprintf(w, sizeof(w), "mod:%s", q->mod_spec);
+        viewq_append(buf, size, w);
+    }
+    if (q->preds & VQ_TEXT) {
+        snprintf(w, sizeof(w), "\"%s\"", q->text);
+        viewq_append(buf, size, w);
+    }
+}
+
+static void invalidate_views(HackPad *nb);
+
+/* Replace the view filter; HP_ERR_SYNTAX if the line does not parse */
+int set_filter(HackPad *nb, const char *src) {
+    const char *err = NULL;
+    if (!viewq_compile(nb, &nb->filter, src, &err)) return hp_fail(nb, HP_ERR_SYNTAX, "Filter: %s", err);
+    viewq_format(&nb->filter, nb->filter_text, sizeof(nb->filter_text));
+    invalidate_views(nb);
+    return HP_OK;
+}
+
+/* Does entries[i] satisfy q? Full-text search is separate (see search_query).
+   The column test is branch-free; the Entry row is only read for row predicates. */
+int viewq_match(HackPad *nb, ViewQuery *q, int i) {
+    unsigned p = q->preds;
+    if (!p) return 1;
+
+    const EntryCols *c = &nb->cols;
+    if (!((q->prio_ok >> c->priority[i]) & (q->color_ok >> c->color[i]) & (q->flags_ok >> c->flags[i]) & 1u))
+        return 0;
+    if (!(p & VQ_ROW)) return 1;
+
+    Entry *e = &nb->entries[i];
+    if ((p & VQ_TAGGED) && e->tag_count == 0) return 0;
+    if ((p & VQ_UNTAGGED) && e->tag_count != 0) return 0;
+    if ((p & VQ_MODIFIED) && (e->modified < q->mod_from || e->modified >= q->mod_to)) return 0;
+    if ((p & VQ_TAGS) && !tagq_match(nb, &q->tags, e)) return 0;
+    if ((p & VQ_TEXT) && !hp_memcasemem(e->text, (size_t)e->text_len, q->text, (size_t)q->text_len)) return 0;
+    return 1;
+}
+
+int entry_matches_filter(HackPad *nb, int i) { return viewq_match(nb, &nb->filter, i); }
+
+/* ---------------- Search index ---------------- */
+
+/* Tokens are runs of [A-Za-z0-9._@-] with the punctuation trimmed off the
+   ends, lowercased. Each token is indexed whole, at every '.'/'-'/... boundary
+   ("10", "10.0", "10.0.0", "10.0.0.1") and by its alphanumeric words, so an
+   IP, a subnet, a CVE year or a username all hit the index. Edits re-index
+   the entry under a new version and deletes bump it; the old postings stay
+   until they outnumber the live ones and the next search rebuilds. */
+
+#define SEARCH_TOKEN_MAX  96
+#define SEARCH_QUERY_MAX  16
+
+typedef void (*SearchTokenFn)(void *ctx, const char *tok, size_t len, int weight);
+
+static int search_token_char(int c) {
+    return isalnum(c) || c == '.' || c == '-' || c == '_' || c == '@';
+}
+
+/* Feed the tokens of s[0..len) to fn; whole_only skips boundary prefixes and words */
+static void search_tokens(const char *s, size_t len, int weight, int whole_only,
+                          SearchTokenFn fn, void *ctx) {
+    char tok[SEARCH_TOKEN_MAX];
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && !isalnum((unsigned char)s[i])) i++;
+        size_t a = i;
+        while (i < len && search_token_char((unsigned char)s[i])) i++;
+        size_t b = i;
+        while (b > a && !isalnum((unsigned char)s[b - 1])) b--;
+        if (b == a) continue;
+
+        size_t n = b - a < SEARCH_TOKEN_MAX ? b - a : SEARCH_TOKEN_MAX;
+        for (size_t k = 0; k < n; k++) tok[k] = (char)tolower((unsigned char)s[a + k]);
+
+        if (whole_only) { fn(ctx, tok, n, weight); continue; }
+
+        /* boundary prefixes (the first word among them), then the whole token */
+        for (size_t k = 1; k < n; k++) {
+            if (!isalnum((unsigned char)tok[k]) && isalnum((unsigned char)tok[k - 1])) fn(ctx, tok, k, weight);
+        }
+        fn(ctx, tok, n, weight);
+
+        /* remaining words */
+        size_t w = 0;
+        while (w < n && isalnum((unsigned char)tok[w])) w++;
+        while (w < n) {
+            while (w < n && !isalnum((unsigned char)tok[w])) w++;
+            size_t ws = w;
+            while (w < n && isalnum((unsigned char)tok[w])) w++;
+            if (w > ws) fn(ctx, tok + ws, w - ws, weight);
+        }
+    }
+}
+
+static int search_rehash(SearchIndex *x, int slot_cap) {
+    int *slots = (int*)malloc((size_t)slot_cap * sizeof(int));
+    if (!slots) return 0;
+    for (int i = 0; i < slot_cap; i++) slots[i] = -1;
+    for (int id = 0; id < x->count; id++) {
+        uint32_t h = hash_bytes(x->terms[id], strlen(x->terms[id]));
+        int k = (int)(h & (uint32_t)(slot_cap - 1));
+        while (slots[k] >= 0) k = (k + 1) & (slot_cap - 1);
+        slots[k] = id;
+    }
+    free(x->slots);
+    x->slots = slots;
+    x->slot_cap = slot_cap;
+    return 1;
+}
+
+/* Term id of tok[0..len); adds it when add is set. -1 if absent or OOM. */
+static int search_term(SearchIndex *x, const char *tok, size_t len, int add) {
+    uint32_t h = hash_bytes(tok, len);
+    if (x->slot_cap > 0) {
+        int k = (int)(h & (uint32_t)(x->slot_cap - 1));
+        while (x->slots[k] >= 0) {
+            const char *t = x->terms[x->slots[k]];
+            if (strncmp(t, tok, len) == 0 && t[len] == '\0') return x->slots[k];
+            k = (k + 1) & (x->slot_cap - 1);
+        }
+    }
+    if (!add) return -1;
+
+    if (x->count == x->cap) {
+        int cap = grow_capacity(x->cap, x->count + 1);
+        const char **t = (const char**)realloc((void*)x->terms, (size_t)cap * sizeof(char*));
+        if (!t) return -1;
+        x->terms = t;
+        PostingList *l = (PostingList*)realloc(x->lists, (size_t)cap * sizeof(PostingList));
+        if (!l) return -1;
+        x->lists = l;
+        x->cap = cap;
+    }
+    const char *term = arena_strndup(&x->strings, tok, len);
+    if (!term) return -1;
+    x->terms[x->count] = term;
+    memset(&x->lists[x->count], 0, sizeof(PostingList));
+    x->count++;
+
+    if (x->count * 2 > x->slot_cap) {
+        if (!search_rehash(x, x->slot_cap ? x->slot_cap * 2 : 1024)) { x->count--; return -1; }
+    } else {
+        int k = (int)(h & (uint32_t)(x->slot_cap - 1));
+        while (x->slots[k] >= 0) k = (k + 1) & (x->slot_cap - 1);
+        x->slots[k] = x->count - 1;
+    }
+    return x->count - 1;
+}
+
+typedef struct {
+    SearchIndex *x;
+    int id;
+    uint16_t ver;
+    int nterms;
+} SearchAddCtx;
+
+static void search_add_token(void *ctx, const char *tok, size_t len, int weight) {
+    SearchAddCtx *c = (SearchAddCtx*)ctx;
+    int t = search_term(c->x, tok, len, 1);
+    if (t < 0) { c->x->oom = 1; return; }
+
+    /* an entry's postings go in back to back, so a repeat is always the last one */
+    PostingList *l = &c->x->lists[t];
+    if (l->count > 0 && l->p[l->count - 1].id == c->id && l->p[l->count - 1].ver == c->ver) {
+        Posting *p = &l->p[l->count - 1];
+        p->weight = (uint16_t)(p->weight + weight < UINT16_MAX ? p->weight + weight : UINT16_MAX);
+        return;
+    }
+    if (l->count == l->cap) {
+        int cap = grow_capacity(l->cap, l->count + 1);
+        Posting *p = (Posting*)realloc(l->p, (size_t)cap * sizeof(Posting));
+        if (!p) { c->x->oom = 1; return; }
+        l->p = p;
+        l->cap = cap;
+    }
+    l->p[l->count].id = c->id;
+    l->p[l->count].ver = c->ver;
+    l->p[l->count].weight = (uint16_t)weight;
+    l->count++;
+    c->nterms++;
+}
+
+static int search_reserve_docs(SearchIndex *x, int id) {
+    if (id < x->doc_cap) return 1;
+    int cap = grow_capacity(x->doc_cap, id + 1);
+    SearchDoc *d = (SearchDoc*)realloc(x->docs, (size_t)cap * sizeof(SearchDoc));
+    if (!d) return 0;
+    memset(d + x->doc_cap, 0, (size_t)(cap - x->doc_cap) * sizeof(SearchDoc));
+    x->docs = d;
+    x->doc_cap = cap;
+    return 1;
+}
+
+/* (Re)index e under a fresh version; its previous postings become stale */
+static void search_index_entry(HackPad *nb, Entry *e) {
+    SearchIndex *x = &nb->search;
+    if (!search_reserve_docs(x, e->id)) { x->oom = 1; return; }
+
+    SearchDoc *d = &x->docs[e->id];
+    x->stale += d->nterms;
+    x->live -= d->nterms;
+    d->ver++;
+
+    SearchAddCtx c = { x, e->id, d->ver, 0 };
+    search_tokens(e->text, (size_t)e->text_len, 1, 0, search_add_token, &c);
+    for (int t = 0; t < e->tag_count; t++) {
+        const char *tag = tag_name(nb, e->tags[t]);
+        search_tokens(tag, strlen(tag), 2, 0, search_add_token, &c);
+    }
+    d->nterms = (uint16_t)(c.nterms < UINT16_MAX ? c.nterms : UINT16_MAX);
+    x->live += d->nterms;
+}
+
+static void search_free(SearchIndex *x) {
+    for (int i = 0; i < x->count; i++) free(x->lists[i].p);
+    free((void*)x->terms);
+    free(x->lists);
+    free(x->slots);
+    free(x->docs);
+    arena_free(&x->strings);
+    memset(x, 0, sizeof(*x));
+}
+
+static int search_build(HackPad *nb) {
+    search_free(&nb->search);
+    for (int i = 0; i < nb->entry_slots; i++)
+        if (entry_live(nb, i)) search_index_entry(nb, &nb->entries[i]);
+    if (nb->search.oom) { search_free(&nb->search); return 0; }
+    nb->search.built = 1;
+    return 1;
+}
+
+/* Keep a built index current after e's text or tags changed (or e was added) */
+static void search_update(HackPad *nb, Entry *e) {
+    if (nb->search.built) search_index_entry(nb, e);
+}
+
+/* Entry id is going away */
+static void search_forget(HackPad *nb, int id) {
+    SearchIndex *x = &nb->search;
+    if (!x->built || id < 0 || id >= x->doc_cap) return;
+    x->stale += x->docs[id].nterms;
+    x->live -= x->docs[id].nterms;
+    x->docs[id].nterms = 0;
+    x->docs[id].ver++;
+}
+
+/* Candidate set keyed by entry id (open addressing) */
+typedef struct {
+    int id;
+    int matched;
+    long score;
+} SearchCand;
+
+typedef struct {
+    SearchIndex *x;
+    int terms[SEARCH_QUERY_MAX];
+    int count;
+    int missing;
+} SearchQueryCtx;
+
+static void search_query_token(void *ctx, const char *tok, size_t len, int weight) {
+    SearchQueryCtx *q = (SearchQueryCtx*)ctx;
+    (void)weight;
+    int t = search_term(q->x, tok, len, 0);
+    if (t < 0) { q->missing = 1; return; }
+    for (int i = 0; i < q->count; i++) if (q->terms[i] == t) return;
+    if (q->count < SEARCH_QUERY_MAX) q->terms[q->count++] = t;
+}
+
+static int ilog2u(unsigned long v) {
+    int n = 0;
+    while (v >>= 1) n++;
+    return n;
+}
+
+static int posting_live(SearchIndex *x, const Posting *p) {
+    return p->id < x->doc_cap && x->docs[p->id].ver == p->ver;
+}
+
+/* Entries holding every token of query, best first. Returns the hit count
+   (hits in *out, caller frees) or -1 on OOM. */
+int search_query(HackPad *nb, const char *query, SearchHit **out) {
+    SearchIndex *x = &nb->search;
+    *out = NULL;
+    if ((!x->built || x->stale > x->live) && !search_build(nb)) return -1;
+
+    SearchQueryCtx q;
+    memset(&q, 0, sizeof(q));
+    q.x = x;
+    search_tokens(query, strlen(query), 1, 1, search_query_token, &q);
+    if (q.missing || q.count == 0) return 0;
+
+    /* rarest term first: it bounds the candidate set */
+    for (int i = 1; i < q.count; i++) {
+        for (int j = i; j > 0 && x->lists[q.terms[j]].count < x->lists[q.terms[j - 1]].count; j--) {
+            int t = q.terms[j]; q.terms[j] = q.terms[j - 1]; q.terms[j - 1] = t;
+        }
+    }
+
+    PostingList *first = &x->lists[q.terms[0]];
+    int cap = 16;
+    while (cap < first->count * 2) cap <<= 1;
+    SearchCand *cand = (SearchCand*)malloc((size_t)cap * sizeof(SearchCand));
+    if (!cand) return -1;
+    for (int i = 0; i < cap; i++) cand[i].id = -1;
+
+    int ndocs = nb->entry_count > 0 ? nb->entry_count : 1;
+    for (int k = 0; k < q.count; k++) {
+        PostingList *l = &x->lists[q.terms[k]];
+        /* rarer terms weigh more: ~log2(N/df) */
+        long idf = 1 + ilog2u((unsigned long)ndocs) - ilog2u((unsigned long)(l->count > 0 ? l->count : 1));
+        if (idf < 1) idf = 1;
+
+        for (int i = 0; i < l->count; i++) {
+            const Posting *p = &l->p[i];
+            if (!posting_live(x, p)) continue;
+            int h = (int)(((uint32_t)p->id * 2654435761u) & (uint32_t)(cap - 1));
+            while (cand[h].id >= 0 && cand[h].id != p->id) h = (h + 1) & (cap - 1);
+            if (k == 0) {
+                cand[h].id = p->id;
+                cand[h].matched = 1;
+                cand[h].score = idf * p->weight;
+            } else if (cand[h].id == p->id && cand[h].matched == k) {
+                cand[h].matched++;
+                cand[h].score += idf * p->weight;
+            }
+        }
+    }
+
+    int n = 0;
+    SearchHit *hits = (SearchHit*)malloc((size_t)(first->count + 1) * sizeof(SearchHit));
+    if (!hits) { free(cand); return -1; }
+    for (int i = 0; i < cap; i++) {
+        if (cand[i].id < 0 || cand[i].matched != q.count) continue;
+        int ei = find_entry_index_by_id(nb, cand[i].id);
+        if (ei < 0) continue;
+        Entry *e = &nb->entries[ei];
+        hits[n].idx = ei;
+        hits[n].score = cand[i].score * 4 + (entry_flag(nb, ei, EF_PINNED) ? 2 : 0) + (entry_flag(nb, ei, EF_COMPLETED) ? 0 : 1);
+        hits[n].modified = e->modified;
+        n++;
+    }
+    free(cand);
+    *out = hits;
+    return n;
+}
+
+/* Fallback for text the tokenizer does not index (substrings, punctuation) */
+int search_scan(HackPad *nb, const char *query, SearchHit **out) {
+    *out = NULL;
+    int n = 0, cap = 0;
+    SearchHit *hits = NULL;
+    size_t qlen = strlen(query);
+    for (int i = 0; i < nb->entry_slots; i++) {
+        Entry *e = &nb->entries[i];
+        if (!entry_live(nb, i)) continue;
+        long score = 0;
+        if (hp_memcasemem(e->text, (size_t)e->text_len, query, qlen)) score += 4;
+        for (int t = 0; t < e->tag_count; t++) {
+            const char *tag = tag_name(nb, e->tags[t]);
+            if (hp_memcasemem(tag, strlen(tag), query, qlen)) { score += 8; break; }
+        }
+        if (!score) continue;
+
+        if (n == cap) {
+            cap = grow_capacity(cap, n + 1);
+            SearchHit *p = (SearchHit*)realloc(hits, (size_t)cap * sizeof(SearchHit));
+            if (!p) { free(hits); return -1; }
+            hits = p;
+        }
+        hits[n].idx = i;
+        hits[n].score = score + (entry_flag(nb, i, EF_PINNED) ? 2 : 0) + (entry_flag(nb, i, EF_COMPLETED) ? 0 : 1);
+        hits[n].modified = e->modified;
+        n++;
+    }
+    *out = hits;
+    return n;
+}
+
+int cmp_search_hit(const void *a, const void *b) {
+    const SearchHit *x = (const SearchHit*)a, *y = (const SearchHit*)b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    if (x->modified != y->modified) return x->modified < y->modified ? 1 : -1;
+    return x->idx - y->idx;
+}
+
+/* ---------------- Visible lists (respect collapse + order) ---------------- */
+
+int build_visible_sections(HackPad *nb, int *out_idx, int max_out) {
+    int count = 0;
+    int collapse_depth = -1;
+
+    for (int i = 0; i < nb->section_count; i++) {
+        Section *s = &nb->sections[i];
+
+        if (collapse_depth >= 0) {
+            if (s->depth > collapse_depth) continue;
+            collapse_depth = -1;
+        }
+
+        if (count < max_out) out_idx[count++] = i;
+
+        if (s->collapsed) collapse_depth = s->depth;
+    }
+    return count;
+}
+
+int build_visible_entries(HackPad *nb, int section_id, int *out_idx, int max_out) {
+    int count = 0;
+    int collapse_depth = -1;
+
+    int si = find_section_index_by_id(nb, section_id);
+    if (si < 0) return 0;
+    Section *s = &nb->sections[si];
+
+    const uint8_t *depth = nb->cols.depth, *flags = nb->cols.flags;
+    for (int i = s->first_entry; i >= 0; i = nb->entry_next[i]) {
+        if (!entry_matches_filter(nb, i)) continue;
+
+        if (collapse_depth >= 0) {
+            if (depth[i] > collapse_depth) continue;
+            collapse_depth = -1;
+        }
+
+        if (count < max_out) out_idx[count++] = i;
+
+        if (flags[i] & EF_COLLAPSED) collapse_depth = depth[i];
+    }
+    return count;
+}
+
+/* ---------------- Visible list cache ---------------- */
+
+static void invalidate_views(HackPad *nb) { nb->view_gen++; }
+
+static void mark_modified(HackPad *nb) { nb->data_gen++; }
+
+static int vis_reserve(VisCache *c, int need) {
+    if (need <= c->cap) return 1;
+    int cap = grow_capacity(c->cap, need);
+    int *p = (int*)realloc(c->idx, (size_t)cap * sizeof(int));
+    if (!p) return 0;
+    c->idx = p;
+    c->cap = cap;
+    return 1;
+}
+
+VisCache *visible_sections(HackPad *nb) {
+    VisCache *c = &nb->vis_sections;
+    if (c->built && c->gen == nb->view_gen) return c;
+    if (!vis_reserve(c, nb->section_count + 1)) return NULL;
+    c->count = build_visible_sections(nb, c->idx, nb->section_count);
+    c->gen = nb->view_gen;
+    c->built = 1;
+    c->hint = 0;
+    return c;
+}
+
+VisCache *visible_entries(HackPad *nb, int section_id) {
+    VisCache *c = &nb->vis_entries;
+    if (c->built && c->gen == nb->view_gen && c->key == section_id) return c;
+    int si = find_section_index_by_id(nb, section_id);
+    int n = si >= 0 ? nb->sections[si].entry_count : 0;
+    if (!vis_reserve(c, n + 1)) return NULL;
+    c->count = build_visible_entries(nb, section_id, c->idx, n);
+    c->key = section_id;
+    c->gen = nb->view_gen;
+    c->built = 1;
+    c->hint = 0;
+    return c;
+}
+
+/* Position of section/entry id in the cached list, or -1. O(1) on the
+   common path since navigation keeps the hint on the current selection. */
+int vis_section_pos(HackPad *nb, VisCache *c, int id) {
+    if (c->hint < c->count && nb->sections[c->idx[c->hint]].id == id) return c->hint;
+    for (int i = 0; i < c->count; i++)
+        if (nb->sections[c->idx[i]].id == id) return c->hint = i;
+    return -1;
+}
+
+int vis_entry_pos(HackPad *nb, VisCache *c, int id) {
+    if (c->hint < c->count && nb->entries[c->idx[c->hint]].id == id) return c->hint;
+    for (int i = 0; i < c->count; i++)
+        if (nb->entries[c->idx[i]].id == id) return c->hint = i;
+    return -1;
+}
+
+/* ---------------- Subtree end (for correct insertion) ---------------- */
+
+int section_subtree_end_index(HackPad *nb, int sec_index) {
+    if (sec_index < 0 || sec_index >= nb->section_count) return sec_index;
+    int d = nb->sections[sec_index].depth;
+    int i = sec_index + 1;
+    while (i < nb->section_count && nb->sections[i].depth > d) i++;
+    return i - 1;
+}
+
+/* Last slot of the sub-entry tree rooted at entry_index (the entry itself if it has none) */
+int entry_subtree_end_index_in_section(HackPad *nb, int entry_index) {
+    if (entry_index < 0 || entry_index >= nb->entry_slots) return entry_index;
+    const uint8_t *depth = nb->cols.depth;
+    int d = depth[entry_index];
+    int i = entry_index;
+    while (nb->entry_next[i] >= 0 && depth[nb->entry_next[i]] > d) i = nb->entry_next[i];
+    return i;
+}
+
+/* ---------------- Save / Load ---------------- */
+
+static int sb_reserve(StrBuf *b, size_t extra) {
+    if (b->oom) return 0;
+    if (b->len + extra <= b->cap) return 1;
+    size_t cap = b->cap ? b->cap : 64 * 1024;
+    while (cap < b->len + extra) cap *= 2;
+    char *p = (char*)realloc(b->data, cap);
+    if (!p) { b->oom = 1; return 0; }
+    b->data = p;
+    b->cap = cap;
+    return 1;
+}
+
+static void sb_putn(StrBuf *b, const char *s, size_t n) {
+    if (!sb_reserve(b, n)) return;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void sb_puts(StrBuf *b, const char *s) { sb_putn(b, s, strlen(s)); }
+
+static void sb_fill(StrBuf *b, char c, size_t n) {
+    if (!sb_reserve(b, n)) return;
+    memset(b->data + b->len, c, n);
+    b->len += n;
+}
+
+static void sb_long(StrBuf *b, long v) {
+    char tmp[24];
+    int n = 0;
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+    do { tmp[n++] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (v < 0) tmp[n++] = '-';
+    if (!sb_reserve(b, (size_t)n)) return;
+    while (n) b->data[b->len++] = tmp[--n];
+}
+
+void sb_free(StrBuf *b) {
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+/* "### Name [COLLAPSED] [RED]" (no newline; shared with the journal) */
+static void serialize_section_heading(StrBuf *out, Section *s) {
+    sb_fill(out, '#', (size_t)(2 + s->depth));
+    sb_puts(out, " ");
+    sb_puts(out, s->name);
+    if (s->collapsed) sb_puts(out, " [COLLAPSED]");
+    if (s->color != HP_COLOR_NONE) { sb_puts(out, " ["); sb_puts(out, color_str(s->color)); sb_puts(out, "]"); }
+}
+
+/* "  - [x] text #tag {created:N,modified:M} [P1] ..." (no newline; shared with the journal) */
+static void serialize_entry(HackPad *nb, StrBuf *out, int ei) {
+    const Entry *e = &nb->entries[ei];
+    EntryHot h = entry_hot(nb, ei);
+    sb_fill(out, ' ', (size_t)h.depth * 2);
+    sb_puts(out, h.completed ? "- [x] " : "- [ ] ");
+    sb_putn(out, e->text, (size_t)e->text_len);
+
+    for (int t = 0; t < e->tag_count; t++) {
+        sb_puts(out, " #");
+        sb_puts(out, tag_name(nb, e->tags[t]));
+    }
+
+    sb_puts(out, " {created:");
+    sb_long(out, (long)e->created);
+    sb_puts(out, ",modified:");
+    sb_long(out, (long)e->modified);
+    sb_puts(out, "}");
+
+    if (h.priority != PRIORITY_NONE) { sb_puts(out, " ["); sb_puts(out, priority_str(h.priority)); sb_puts(out, "]"); }
+    if (h.color != HP_COLOR_NONE) { sb_puts(out, " ["); sb_puts(out, color_str(h.color)); sb_puts(out, "]"); }
+    if (h.pinned) sb_puts(out, " [PIN]");
+    if (h.collapsed) sb_puts(out, " [COLLAPSED]");
+}
+
+/* Render the whole notebook as markdown into out */
+/* Heading and entries of sections[si], as they appear in the file */
+static void serialize_section(HackPad *nb, StrBuf *out, int si) {
+    Section *s = &nb->sections[si];
+
+    serialize_section_heading(out, s);
+    sb_puts(out, "\n\n");
+
+    for (int j = s->first_entry; j >= 0; j = nb->entry_next[j]) {
+        serialize_entry(nb, out, j);
+        sb_puts(out, "\n");
+    }
+    sb_puts(out, "\n");
+}
+
+void serialize_hackpad(HackPad *nb, StrBuf *out) {
+    time_t now = time(NULL);
+    char tbuf[64];
+
+    sb_puts(out, "# HackPad Modern\n");
+    sb_puts(out, "Created: ");
+    sb_puts(out, ctime_r(&nb->created_time, tbuf) ? tbuf : "\n");
+    sb_puts(out, "Modified: ");
+    sb_puts(out, ctime_r(&now, tbuf) ? tbuf : "\n");
+    sb_puts(out, "Journal: ");
+    sb_long(out, (long)nb->journal_seq);
+    sb_puts(out, "\n\n");
+
+    for (int i = 0; i < nb->section_count; i++) serialize_section(nb, out, i);
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t w = write(fd, data, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (w == 0) { errno = EIO; return -1; }
+        data += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+/* Replace file with data via temp file + fsync + rename(), so readers see the
+   old or the new contents and never a truncated mix. Returns 0 or -1/errno. */
+/* mode is for a file that does not exist yet; 0 keeps mkstemp's 0600 */
+static int write_file_atomic(const char *file, const char *data, size_t len, unsigned mode) {
+    size_t flen = strlen(file);
+    char *tmp = (char*)malloc(flen + 16);
+    if (!tmp) { errno = ENOMEM; return -1; }
+    memcpy(tmp, file, flen);
+    memcpy(tmp + flen, ".tmp.XXXXXX", 12);
+
+    int fd = mkstemp(tmp);
+    if (fd < 0) { free(tmp); return -1; }
+
+    /* keep the target's permissions (mkstemp creates 0600) */
+    struct stat st;
+    if (stat(file, &st) == 0) fchmod(fd, st.st_mode & 07777);
+    else if (mode) fchmod(fd, (mode_t)mode);
+
+    int err = 0;
+    if (write_all(fd, data, len) != 0 || fsync(fd) != 0) err = errno;
+    if (close(fd) != 0 && !err) err = errno;
+    if (!err && rename(tmp, file) != 0) err = errno;
+
+    if (err) {
+        unlink(tmp);
+        free(tmp);
+        errno = err;
+        return -1;
+    }
+
+    /* persist the rename itself */
+    const char *slash = strrchr(file, '/');
+    if (slash) {
+        size_t dlen = slash == file ? 1 : (size_t)(slash - file);
+        memcpy(tmp, file, dlen);
+        tmp[dlen] = '\0';
+    } else {
+        strcpy(tmp, ".");
+    }
+    int dfd = open(tmp, O_RDONLY);
+    if (dfd >= 0) { fsync(dfd); close(dfd); }
+
+    free(tmp);
+    return 0;
+}
+
+/* ---------------- Binary snapshot (.hpb) ---------------- */
+
+/* "<file>.hpb" is written after every successful save and mirrors the
+   markdown in a form that loads without parsing: a header, fixed-size
+   section/entry/tag tables and one blob of NUL-terminated strings that
+   entry texts point into directly (the file stays mapped). It is only used
+   when its header names the exact size and mtime of the markdown next to it,
+   so editing the .md by hand simply makes HackPad parse it again.
+   HACKPAD_SNAPSHOT=0 stops writing it. */
+
+#define HPB_MAGIC       "HACKPADB"
+#define HPB_VERSION     1
+#define HPB_BYTE_ORDER  0x01020304u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t byte_order;
+    uint32_t tag_count;
+    uint32_t section_count;
+    uint32_t entry_count;
+    uint64_t md_size;           /* the markdown this snapshot was taken with */
+    int64_t md_mtime_sec;
+    int64_t md_mtime_nsec;
+    uint64_t journal_seq;
+    int64_t created_time;
+    uint64_t sections_off;
+    uint64_t entries_off;
+    uint64_t tags_off;
+    uint64_t strings_off;
+    uint64_t strings_size;
+} HpbHeader;
+
+typedef struct {
+    uint64_t name_off;
+    uint32_t name_len;
+    uint32_t entry_count;
+    int32_t depth;
+    int32_t collapsed;
+    int32_t color;
+    int32_t pad;
+} HpbSection;
+
+typedef struct {
+    int64_t created;
+    int64_t modified;
+    uint64_t text_off;
+    uint32_t text_len;
+    int32_t depth;
+    uint16_t tags[MAX_TAGS];    /* indexes into the tag table */
+    uint8_t tag_count;
+    uint8_t completed;
+    uint8_t pinned;
+    uint8_t collapsed;
+    uint8_t priority;
+    uint8_t color;
+    uint8_t pad[2];
+} HpbEntry;
+
+typedef struct {
+    uint64_t off;
+    uint32_t len;
+    uint32_t pad;
+} HpbString;
+
+static int hpb_enabled(void) {
+    const char *env = getenv("HACKPAD_SNAPSHOT");
+    return !env || atoi(env) != 0;
+}
+
+static uint64_t hpb_string(StrBuf *blob, const char *s, size_t len) {
+    uint64_t off = blob->len;
+    sb_putn(blob, s, len);
+    sb_putn(blob, "", 1);
+    return off;
+}
+
+/* The snapshot of nb; the markdown it mirrors is stamped in by hpb_write */
+static void serialize_hpb(HackPad *nb, StrBuf *out) {
+    HpbHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, HPB_MAGIC, sizeof(h.magic));
+    h.version = HPB_VERSION;
+    h.header_size = sizeof(HpbHeader);
+    h.byte_order = HPB_BYTE_ORDER;
+    h.tag_count = (uint32_t)nb->tags.count;
+    h.section_count = (uint32_t)nb->section_count;
+    h.entry_count = (uint32_t)nb->entry_count;
+    h.journal_seq = nb->journal_seq;
+    h.created_time = (int64_t)nb->created_time;
+    h.sections_off = sizeof(HpbHeader);
+    h.entries_off = h.sections_off + (uint64_t)nb->section_count * sizeof(HpbSection);
+    h.tags_off = h.entries_off + (uint64_t)nb->entry_count * sizeof(HpbEntry);
+    h.strings_off = h.tags_off + (uint64_t)nb->tags.count * sizeof(HpbString);
+
+    StrBuf blob = {0};
+    sb_reserve(out, (size_t)h.strings_off);
+    sb_putn(out, (const char*)&h, sizeof(h));
+
+    for (int i = 0; i < nb->section_count; i++) {
+        Section *s = &nb->sections[i];
+        HpbSection r;
+        memset(&r, 0, sizeof(r));
+        r.name_len = (uint32_t)strlen(s->name);
+        r.name_off = hpb_string(&blob, s->name, r.name_len);
+        r.entry_count = (uint32_t)s->entry_count;
+        r.depth = s->depth;
+        r.collapsed = s->collapsed;
+        r.color = s->color;
+        sb_putn(out, (const char*)&r, sizeof(r));
+    }
+
+    /* entries go out in section order, so a section's run is contiguous on disk */
+    for (int si = 0; si < nb->section_count; si++)
+    for (int i = nb->sections[si].first_entry; i >= 0; i = nb->entry_next[i]) {
+        Entry *e = &nb->entries[i];
+        HpbEntry r;
+        memset(&r, 0, sizeof(r));
+        r.created = (int64_t)e->created;
+        r.modified = (int64_t)e->modified;
+        r.text_len = (uint32_t)e->text_len;
+        r.text_off = hpb_string(&blob, e->text, (size_t)e->text_len);
+        memcpy(r.tags, e->tags, sizeof(r.tags));
+        r.tag_count = (uint8_t)e->tag_count;
+        r.depth = nb->cols.depth[i];
+        r.completed = (uint8_t)entry_flag(nb, i, EF_COMPLETED);
+        r.pinned = (uint8_t)entry_flag(nb, i, EF_PINNED);
+        r.collapsed = (uint8_t)entry_flag(nb, i, EF_COLLAPSED);
+        r.priority = nb->cols.priority[i];
+        r.color = nb->cols.color[i];
+        sb_putn(out, (const char*)&r, sizeof(r));
+    }
+
+    for (int i = 0; i < nb->tags.count; i++) {
+        HpbString r;
+        memset(&r, 0, sizeof(r));
+        r.len = (uint32_t)strlen(nb->tags.names[i]);
+        r.off = hpb_string(&blob, nb->tags.names[i], r.len);
+        sb_putn(out, (const char*)&r, sizeof(r));
+    }
+
+    sb_putn(out, blob.data, blob.len);
+    if (blob.oom) out->oom = 1;
+    if (!out->oom) {
+        h.strings_size = blob.len;
+        memcpy(out->data, &h, sizeof(h));
+    }
+    sb_free(&blob);
+}
+
+/* Stamp the serialized snapshot in out with file as saved and write it to
+   file's .hpb. A failure only leaves an older snapshot behind, which no
+   longer matches the markdown and is ignored. */
+static void hpb_write(StrBuf *out, const char *file, unsigned mode) {
+    struct stat md;
+    if (out->oom || out->len < sizeof(HpbHeader) || stat(file, &md) != 0) return;
+
+    HpbHeader h;
+    memcpy(&h, out->data, sizeof(h));
+    h.md_size = (uint64_t)md.st_size;
+    h.md_mtime_sec = (int64_t)md.st_mtim.tv_sec;
+    h.md_mtime_nsec = (int64_t)md.st_mtim.tv_nsec;
+    memcpy(out->data, &h, sizeof(h));
+
+    char path[272];
+    snprintf(path, sizeof(path), "%s.hpb", file);
+    write_file_atomic(path, out->data, out->len, mode);
+}
+
+/* Refresh file's .hpb after file was saved */
+void write_hpb(HackPad *nb, const char *file) {
+    if (!hpb_enabled()) return;
+    StrBuf out = {0};
+    serialize_hpb(nb, &out);
+    hpb_write(&out, file, nb->new_file_mode);
+    sb_free(&out);
+}
+
+/* NUL-terminated [off, off+len] inside the string blob */
+static int hpb_string_ok(const char *blob, uint64_t size, uint64_t off, uint64_t len) {
+    return off < size && len < size - off && blob[off + len] == '\0';
+}
+
+/* Everything load_hpb dereferences is range-checked here first */
+static int hpb_valid(const char *data, size_t size, const struct stat *md) {
+    const HpbHeader *h = (const HpbHeader*)data;
+    if (size < sizeof(HpbHeader)) return 0;
+    if (memcmp(h->magic, HPB_MAGIC, sizeof(h->magic)) != 0) return 0;
+    if (h->version != HPB_VERSION || h->header_size != sizeof(HpbHeader) || h->byte_order != HPB_BYTE_ORDER) return 0;
+    if (h->md_size != (uint64_t)md->st_size ||
+        h->md_mtime_sec != (int64_t)md->st_mtim.tv_sec ||
+        h->md_mtime_nsec != (int64_t)md->st_mtim.tv_nsec) return 0;
+    if (h->section_count > INT32_MAX || h->entry_count > INT32_MAX || h->tag_count > UINT16_MAX) return 0;
+
+    if (h->sections_off != sizeof(HpbHeader) ||
+        h->entries_off != h->sections_off + (uint64_t)h->section_count * sizeof(HpbSection) ||
+        h->tags_off != h->entries_off + (uint64_t)h->entry_count * sizeof(HpbEntry) ||
+        h->strings_off != h->tags_off + (uint64_t)h->tag_count * sizeof(HpbString) ||
+        h->strings_off > size || h->strings_size != size - h->strings_off) return 0;
+
+    const char *blob = data + h->strings_off;
+    const HpbSection *secs = (const HpbSection*)(data + h->sections_off);
+    const HpbEntry *ents = (const HpbEntry*)(data + h->entries_off);
+    const HpbString *tags = (const HpbString*)(data + h->tags_off);
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < h->section_count; i++) {
+        const HpbSection *s = &secs[i];
+        if (s->name_len >= MAX_NAME || !hpb_string_ok(blob, h->strings_size, s->name_off, s->name_len)) return 0;
+        if (s->depth < 0 || s->depth > 30 || s->color < HP_COLOR_NONE || s->color > HP_COLOR_WHITE) return 0;
+        total += s->entry_count;
+    }
+    if (total != h->entry_count) return 0;
+
+    for (uint32_t i = 0; i < h->entry_count; i++) {
+        const HpbEntry *e = &ents[i];
+        if (!hpb_string_ok(blob, h->strings_size, e->text_off, e->text_len) || e->text_len > INT32_MAX) return 0;
+        if (e->depth < 0 || e->depth > MAX_DEPTH || e->tag_count > MAX_TAGS) return 0;
+        if (e->priority > PRIORITY_CRITICAL || e->color > HP_COLOR_WHITE) return 0;
+        for (int t = 0; t < e->tag_count; t++) if (e->tags[t] >= h->tag_count) return 0;
+    }
+
+    for (uint32_t i = 0; i < h->tag_count; i++) {
+        if (tags[i].len == 0 || !hpb_string_ok(blob, h->strings_size, tags[i].off, tags[i].len)) return 0;
+    }
+    return 1;
+}
+
+/* Load file's .hpb if it was written for exactly this markdown */
+static int load_hpb(HackPad *nb, const char *file, const struct stat *md) {
+    char path[272];
+    snprintf(path, sizeof(path), "%s.hpb", file);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(HpbHeader)) { close(fd); return 0; }
+    size_t size = (size_t)st.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+
+    const HpbHeader *h = (const HpbHeader*)data;
+    if (!hpb_valid(data, size, md) ||
+        !reserve_sections(nb, (int)h->section_count) ||
+        !reserve_entries(nb, (int)h->entry_count)) {
+        munmap((void*)data, size);
+        return 0;
+    }
+
+    const char *blob = data + h->strings_off;
+    const HpbSection *secs = (const HpbSection*)(data + h->sections_off);
+    const HpbEntry *ents = (const HpbEntry*)(data + h->entries_off);
+    const HpbString *tags = (const HpbString*)(data + h->tags_off);
+
+    /* snapshot tag index -> dictionary id */
+    uint16_t *tag_ids = (uint16_t*)malloc((size_t)(h->tag_count + 1) * sizeof(uint16_t));
+    if (!tag_ids) { munmap((void*)data, size); return 0; }
+    for (uint32_t i = 0; i < h->tag_count; i++) {
+        int id = intern_tag(nb, blob + tags[i].off, tags[i].len);
+        if (id < 0) { free(tag_ids); munmap((void*)data, size); return 0; }
+        tag_ids[i] = (uint16_t)id;
+    }
+
+    int section_stack[32];
+    int entry_parent_at_depth[256];
+    for (int d = 0; d < 32; d++) section_stack[d] = -1;
+    uint32_t ei = 0;
+    for (uint32_t i = 0; i < h->section_count; i++) {
+        const HpbSection *r = &secs[i];
+        Section *s = append_section(nb);
+        s->id = nb->next_section_id++;
+        s->depth = r->depth;
+        s->collapsed = r->collapsed;
+        s->color = (UiColor)r->color;
+        memcpy(s->name, blob + r->name_off, r->name_len + 1);
+        s->parent_id = (s->depth == 0) ? -1 : section_stack[s->depth - 1];
+        section_stack[s->depth] = s->id;
+
+        for (int d = 0; d < 256; d++) entry_parent_at_depth[d] = -1;
+        for (uint32_t end = ei + r->entry_count; ei < end; ei++) {
+            const HpbEntry *er = &ents[ei];
+            EntryHot hot = { er->depth, er->collapsed, er->completed, er->pinned,
+                             (Priority)er->priority, (UiColor)er->color };
+            Entry *e = append_entry(nb, s, &hot);
+            e->id = nb->next_entry_id++;
+            e->section_id = s->id;
+            e->parent_id = (hot.depth == 0) ? -1 : entry_parent_at_depth[hot.depth - 1];
+            entry_parent_at_depth[hot.depth] = e->id;
+            e->text = blob + er->text_off;
+            e->text_len = (int)er->text_len;
+            e->tag_count = er->tag_count;
+            for (int t = 0; t < er->tag_count; t++) e->tags[t] = tag_ids[er->tags[t]];
+            e->created = (time_t)er->created;
+            e->modified = (time_t)er->modified;
+        }
+    }
+    free(tag_ids);
+
+    nb->created_time = (time_t)h->created_time;
+    nb->journal_seq = h->journal_seq;
+    nb->journal_header = 1;
+    nb->hpb_map = data;
+    nb->hpb_len = size;
+
+    reindex_sections(nb, 0);
+    reindex_entries(nb, 0);
+    invalidate_views(nb);
+    return 1;
+}
+
+static void journal_reset(HackPad *nb, const char *file);
+
+/* 0666 less the umask, for the files a save creates. Reading the umask
+   means setting it for the whole process, so only the owning thread does
+   it, once, while no background save is running (open, autosave_start,
+   save_hackpad after autosave_wait); the worker gets the value with its
+   snapshot. */
+static unsigned new_file_mode(HackPad *nb) {
+    if (!nb->new_file_mode) {
+        mode_t um = umask(0);
+        umask(um);
+        nb->new_file_mode = 0666 & ~(unsigned)um;
+    }
+    return nb->new_file_mode;
+}
+
+int save_hackpad(HackPad *nb, const char *file) {
+    /* never let an older background snapshot land after this write */
+    autosave_wait(nb);
+
+    StrBuf out = {0};
+    serialize_hackpad(nb, &out);
+    if (out.oom) {
+        sb_free(&out);
+        return hp_fail(nb, HP_ERR_NOMEM, "Out of memory while saving");
+    }
+
+    int err = write_file_atomic(file, out.data, out.len, new_file_mode(nb)) != 0 ? errno : 0;
+    sb_free(&out);
+
+    if (err) return hp_fail(nb, HP_ERR_IO, "Could not save file: %s", strerror(err));
+    nb->saved_gen = nb->data_gen;
+    journal_reset(nb, file);
+    write_hpb(nb, file);
+    return HP_OK;
+}
+
+/* ---------------- Autosave ---------------- */
+
+/* Background writer. The owning thread hands over a snapshot that shares
+   nb's section/entry/tag-name arrays (texts too: the arena is append-only),
+   so queuing a save costs nothing. The arrays are copied on write: the
+   first change the owning thread makes while the save still reads them
+   (see autosave_detach) moves nb to private copies and leaves the originals
+   to the save, freed once it is done. A save nobody edits through copies
+   nothing. */
+typedef struct Autosave {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int running;
+    int stop;
+    int interval;           /* seconds between saves, 0 = disabled */
+    time_t last_start;
+
+    int queued;             /* snap/file/job_gen hold a job for the worker */
+    int busy;               /* a job is queued or being written */
+    int reading;            /* the job may still read the snapshot's arrays */
+    HackPad snap;
+    char file[256];
+    unsigned long job_gen;
+    unsigned long job_seq;  /* journal records covered by the snapshot */
+
+    int done;               /* result waiting for the owning thread */
+    int result_errno;
+    unsigned long done_gen;
+    unsigned long done_seq;
+    char done_file[256];
+
+    /* owning thread only */
+    int shared;             /* the last snapshot uses nb's own arrays */
+    HackPad orphan;         /* arrays nb let go of while shared; freed when the save is done */
+} Autosave;
+
+/* dst reads src's arrays; only the fields the serializers use are set */
+static void snapshot_share(HackPad *src, HackPad *dst) {
+    memset(dst, 0, sizeof(*dst));
+    dst->created_time = src->created_time;
+    dst->journal_seq = src->journal_seq;
+    dst->new_file_mode = src->new_file_mode;
+    dst->sections = src->sections;
+    dst->section_count = src->section_count;
+    dst->entries = src->entries;
+    dst->entry_next = src->entry_next;
+    dst->cols = src->cols;
+    dst->entry_slots = src->entry_slots;
+    dst->entry_count = src->entry_count;
+    dst->tags.names = src->tags.names;
+    dst->tags.count = src->tags.count;
+}
+
+static void free_snapshot(HackPad *snap) {
+    free(snap->sections);
+    free(snap->entries);
+    free(snap->entry_next);
+    cols_free(&snap->cols);
+    free((void*)snap->tags.names);
+    memset(snap, 0, sizeof(*snap));
+}
+
+/* Private copies of the arrays snapshot_share hands out, at nb's capacities */
+static int snapshot_copy(HackPad *nb, HackPad *dst) {
+    memset(dst, 0, sizeof(*dst));
+    size_t cap = (size_t)nb->entry_cap + 1;
+    dst->sections = (Section*)malloc((size_t)(nb->section_cap + 1) * sizeof(Section));
+    dst->entries = (Entry*)malloc(cap * sizeof(Entry));
+    dst->entry_next = (int*)malloc(cap * sizeof(int));
+    dst->cols.depth = (uint8_t*)malloc(cap);
+    dst->cols.flags = (uint8_t*)malloc(cap);
+    dst->cols.priority = (uint8_t*)malloc(cap);
+    dst->cols.color = (uint8_t*)malloc(cap);
+    dst->tags.names = (const char**)malloc((size_t)(nb->tags.cap + 1) * sizeof(char*));
+    if (!dst->sections || !dst->entries || !dst->entry_next || !dst->cols.depth || !dst->cols.flags ||
+        !dst->cols.priority || !dst->cols.color || !dst->tags.names) {
+        free_snapshot(dst);
+        return 0;
+    }
+
+    size_t slots = (size_t)nb->entry_slots;
+    memcpy(dst->sections, nb->sections, (size_t)nb->section_count * sizeof(Section));
+    memcpy(dst->entries, nb->entries, slots * sizeof(Entry));
+    memcpy(dst->entry_next, nb->entry_next, slots * sizeof(int));
+    memcpy(dst->cols.depth, nb->cols.depth, slots);
+    memcpy(dst->cols.flags, nb->cols.flags, slots);
+    memcpy(dst->cols.priority, nb->cols.priority, slots);
+    memcpy(dst->cols.color, nb->cols.color, slots);
+    memcpy((void*)dst->tags.names, nb->tags.names, (size_t)nb->tags.count * sizeof(char*));
+    return 1;
+}
+
+static void *autosave_main(void *arg) {
+    Autosave *as = (Autosave*)arg;
+
+    pthread_mutex_lock(&as->lock);
+    for (;;) {
+        while (!as->stop && !as->queued) pthread_cond_wait(&as->cond, &as->lock);
+        if (!as->queued) break;
+
+        HackPad snap = as->snap;
+        char file[256];
+        memcpy(file, as->file, sizeof(file));
+        unsigned long gen = as->job_gen;
+        unsigned long seq = as->job_seq;
+        memset(&as->snap, 0, sizeof(as->snap));
+        as->queued = 0;
+        pthread_mutex_unlock(&as->lock);
+
+        /* render both files first: only this part reads the snapshot */
+        StrBuf out = {0}, hpb = {0};
+        serialize_hackpad(&snap, &out);
+        if (hpb_enabled()) serialize_hpb(&snap, &hpb);
+        pthread_mutex_lock(&as->lock);
+        as->reading = 0;
+        pthread_mutex_unlock(&as->lock);
+
+        int err = out.oom ? ENOMEM : 0;
+        if (!err && write_file_atomic(file, out.data, out.len, snap.new_file_mode) != 0) err = errno;
+        if (!err && hpb.len) hpb_write(&hpb, file, snap.new_file_mode);
+        sb_free(&out);
+        sb_free(&hpb);
+
+        pthread_mutex_lock(&as->lock);
+        as->result_errno = err;
+        as->done_gen = gen;
+        as->done_seq = seq;
+        memcpy(as->done_file, file, sizeof(file));
+        as->done = 1;
+        as->busy = 0;
+        pthread_cond_broadcast(&as->cond);
+    }
+    pthread_mutex_unlock(&as->lock);
+    return NULL;
+}
+
+/* Start the background writer unless HACKPAD_AUTOSAVE is 0; nb->autosave
+   stays NULL when it is off or could not be started */
+void autosave_start(HackPad *nb) {
+    const char *env = getenv("HACKPAD_AUTOSAVE");
+    int interval = env ? atoi(env) : 30;
+    if (interval <= 0) return;
+    new_file_mode(nb);
+
+    Autosave *as = (Autosave*)calloc(1, sizeof(Autosave));
+    if (!as) return;
+    as->interval = interval;
+    pthread_mutex_init(&as->lock, NULL);
+    pthread_cond_init(&as->cond, NULL);
+    as->last_start = time(NULL);
+    if (pthread_create(&as->thread, NULL, autosave_main, as) != 0) {
+        pthread_mutex_destroy(&as->lock);
+        pthread_cond_destroy(&as->cond);
+        free(as);
+        return;
+    }
+    as->running = 1;
+    nb->autosave = as;
+}
+
+/* Collect a finished background save, if any (owning thread only) */
+static void autosave_collect(HackPad *nb, Autosave *as) {
+    if (!as->done) return;
+    as->done = 0;
+    as->shared = 0;
+    free_snapshot(&as->orphan);
+    if (as->result_errno) {
+        hp_fail(nb, HP_ERR_IO, "Autosave failed: %s", strerror(as->result_errno));
+    } else {
+        if (as->done_gen > nb->saved_gen) nb->saved_gen = as->done_gen;
+        /* the journal can go only if nothing was appended after the snapshot */
+        if (as->done_seq == nb->journal_seq) journal_reset(nb, as->done_file);
+    }
+}
+
+/* Block until no background write is in flight */
+void autosave_wait(HackPad *nb) {
+    Autosave *as = nb->autosave;
+    if (!as || !as->running) return;
+    pthread_mutex_lock(&as->lock);
+    while (as->busy) pthread_cond_wait(&as->cond, &as->lock);
+    autosave_collect(nb, as);
+    pthread_mutex_unlock(&as->lock);
+}
+
+/* Called from the input loop; queues a snapshot once the interval has passed */
+void autosave_tick(HackPad *nb) {
+    Autosave *as = nb->autosave;
+    if (!as || !as->running) return;
+
+    pthread_mutex_lock(&as->lock);
+    autosave_collect(nb, as);
+    int busy = as->busy;
+    pthread_mutex_unlock(&as->lock);
+
+    if (busy || nb->data_gen == nb->saved_gen) return;
+    if (time(NULL) - as->last_start < as->interval) return;
+
+    HackPad snap;
+    snapshot_share(nb, &snap);
+    as->shared = 1;
+
+    pthread_mutex_lock(&as->lock);
+    as->snap = snap;
+    strncpy(as->file, nb->filename, sizeof(as->file) - 1);
+    as->file[sizeof(as->file) - 1] = '\0';
+    as->job_gen = nb->data_gen;
+    as->job_seq = nb->journal_seq;
+    as->queued = 1;
+    as->busy = 1;
+    as->reading = 1;
+    as->last_start = time(NULL);
+    pthread_cond_broadcast(&as->cond);
+    pthread_mutex_unlock(&as->lock);
+}
+
+/* Called before the owning thread changes sections, entries, links, hot
+   columns or tag names. While a save is still rendering from them, nb moves
+   to private copies (once per save) and the save keeps the originals; if
+   they cannot be copied, the change waits for the save instead. */
+static void autosave_detach(HackPad *nb) {
+    Autosave *as = nb->autosave;
+    if (!as || !as->shared) return;
+    pthread_mutex_lock(&as->lock);
+    int reading = as->reading;
+    pthread_mutex_unlock(&as->lock);
+    as->shared = 0;
+    if (!reading) return;
+
+    HackPad copy;
+    if (!snapshot_copy(nb, &copy)) {
+        autosave_wait(nb);
+        return;
+    }
+    snapshot_share(nb, &as->orphan);
+    nb->sections = copy.sections;
+    nb->entries = copy.entries;
+    nb->entry_next = copy.entry_next;
+    nb->cols = copy.cols;
+    nb->tags.names = copy.tags.names;
+}
+
+void autosave_stop(HackPad *nb) {
+    Autosave *as = nb->autosave;
+    if (!as || !as->running) return;
+    autosave_wait(nb);
+    pthread_mutex_lock(&as->lock);
+    as->stop = 1;
+    pthread_cond_broadcast(&as->cond);
+    pthread_mutex_unlock(&as->lock);
+    pthread_join(as->thread, NULL);
+    pthread_mutex_destroy(&as->lock);
+    pthread_cond_destroy(&as->cond);
+    free(as);
+    nb->autosave = NULL;
+}
+
+/* ---------------- Load: single-pass tokenizer ---------------- */
+
+/* Trailing " [..]" badges written by save_hackpad */
+typedef enum { BADGE_COLLAPSED, BADGE_PIN, BADGE_PRIORITY, BADGE_COLOR } BadgeKind;
+
+typedef struct {
+    BadgeKind kind;
+    int value;
+} Badge;
+
+static int match_badge(const char *s, size_t len, Badge *b) {
+    if (len == 2 && s[0] == 'P' && s[1] >= '0' && s[1] <= '3') {
+        b->kind = BADGE_PRIORITY;
+        b->value = PRIORITY_CRITICAL - (s[1] - '0');
+        return 1;
+    }
+    if (len == 3 && memcmp(s, "PIN", 3) == 0) { b->kind = BADGE_PIN; return 1; }
+    if (len == 9 && memcmp(s, "COLLAPSED", 9) == 0) { b->kind = BADGE_COLLAPSED; return 1; }
+    for (int c = HP_COLOR_RED; c <= HP_COLOR_WHITE; c++) {
+        const char *n = color_str((UiColor)c);
+        if (strlen(n) == len && memcmp(s, n, len) == 0) {
+            b->kind = BADGE_COLOR;
+            b->value = c;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Strip one known " [BADGE]" from the end of [s, *endp). Unknown brackets stay text. */
+static int peel_badge(const char *s, const char **endp, Badge *b) {
+    const char *end = rtrim_span(s, *endp);
+    if (end - s < 3 || end[-1] != ']') return 0;
+
+    const char *open = end - 2;
+    while (open > s && *open != '[' && end - open <= 12) open--;
+    if (*open != '[') return 0;
+    if (!match_badge(open + 1, (size_t)(end - 1 - (open + 1)), b)) return 0;
+
+    *endp = open;
+    return 1;
+}
+
+static int parse_long_span(const char **pp, const char *end, long *out) {
+    const char *p = *pp;
+    int neg = 0;
+    if (p < end && *p == '-') { neg = 1; p++; }
+    if (p >= end || !isdigit((unsigned char)*p)) return 0;
+    long v = 0;
+    while (p < end && isdigit((unsigned char)*p)) v = v * 10 + (*p++ - '0');
+    *out = neg ? -v : v;
+    *pp = p;
+    return 1;
+}
+
+/* "{created:N,modified:M}" at the end of [s, *endp) */
+static int peel_timestamps(const char *s, const char **endp, long *created, long *modified) {
+    const char *end = rtrim_span(s, *endp);
+    if (end - s < 2 || end[-1] != '}') return 0;
+
+    const char *open = end - 2;
+    while (open > s && *open != '{' && end - open <= 64) open--;
+    if (*open != '{') return 0;
+
+    const char *p = open + 1;
+    if (!span_starts(p, end, "created:")) return 0;
+    p += 8;
+    if (!parse_long_span(&p, end, created)) return 0;
+    if (!span_starts(p, end, ",modified:")) return 0;
+    p += 10;
+    if (!parse_long_span(&p, end, modified)) return 0;
+    if (p != end - 1) return 0;
+
+    *endp = open;
+    return 1;
+}
+
+static void load_created_header(HackPad *nb, const char *t, const char *end) {
+    char buf[64];
+    size_t n = (size_t)(end - t) < sizeof(buf) - 1 ? (size_t)(end - t) : sizeof(buf) - 1;
+    memcpy(buf, t, n);
+    buf[n] = '\0';
+
+    struct tm tm = {0};
+    char wk[4] = {0}, mon[4] = {0};
+    int mday=0, hh=0, mm=0, ss=0, year=0;
+    if (sscanf(buf, "%3s %3s %d %d:%d:%d %d", wk, mon, &mday, &hh, &mm, &ss, &year) == 7) {
+        const char *months[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+        int mon_idx = 0;
+        for (int i = 0; i < 12; i++) if (strcmp(mon, months[i]) == 0) { mon_idx = i; break; }
+        tm.tm_mday = mday; tm.tm_hour = hh; tm.tm_min = mm; tm.tm_sec = ss;
+        tm.tm_year = year - 1900; tm.tm_mon = mon_idx;
+        nb->created_time = mktime(&tm);
+    }
+}
+
+typedef struct {
+    int section_stack[32];
+    int current_section_id;
+    int entry_parent_at_depth[256];
+} LoadState;
+
+/* "### Name [COLLAPSED] [RED]" -> depth, name, collapsed, color */
+static void parse_section_heading(const char *line, const char *end, Section *s) {
+    const char *name = skip_char(line, end, '#');
+    int level = (int)(name - line);
+    int depth = level - 2;
+    if (depth < 0) depth = 0;
+    if (depth > 30) depth = 30;
+
+    name = skip_char(name, end, ' ');
+    const char *name_end = end;
+
+    int collapsed = 0;
+    UiColor sc = HP_COLOR_NONE;
+    Badge b;
+    while (peel_badge(name, &name_end, &b)) {
+        if (b.kind == BADGE_COLLAPSED) collapsed = 1;
+        else if (b.kind == BADGE_COLOR) sc = (UiColor)b.value;
+    }
+    name_end = rtrim_span(name, name_end);
+
+    s->depth = depth;
+    s->collapsed = collapsed;
+    s->color = sc;
+    size_t nlen = (size_t)(name_end - name);
+    if (nlen > MAX_NAME - 1) nlen = MAX_NAME - 1;
+    memcpy(s->name, name, nlen);
+    s->name[nlen] = '\0';
+}
+
+static void load_section_line(HackPad *nb, LoadState *ls, const char *line, const char *end) {
+    Section *s = append_section(nb);
+    if (!s) return;
+    s->id = nb->next_section_id++;
+    parse_section_heading(line, end, s);
+
+    int depth = s->depth;
+    s->parent_id = (depth == 0) ? -1 : ls->section_stack[depth - 1];
+    ls->section_stack[depth] = s->id;
+
+    ls->current_section_id = s->id;
+    for (int i = 0; i < 256; i++) ls->entry_parent_at_depth[i] = -1;
+}
+
+/* "  - [x] text #tag #tag {created:N,modified:M} [P1] [RED] [PIN] [COLLAPSED]"
+   Parsed right to left in one pass; only the final text is copied (into the arena).
+   p points at "- ", lead is the indent before it. Fills all but the ids.
+   HP_OK, or HP_ERR_NOMEM/HP_ERR_LIMIT with nb->error set: a tag that cannot
+   be kept fails the line rather than vanish from the next save. */
+static int parse_entry_line(HackPad *nb, int lead, const char *p, const char *end, Entry *e, EntryHot *h) {
+    int depth = lead / 2;
+    if (depth > MAX_DEPTH) depth = MAX_DEPTH;
+
+    memset(e, 0, sizeof(*e));
+    memset(h, 0, sizeof(*h));
+    h->depth = depth;
+    h->color = HP_COLOR_NONE;
+    h->priority = PRIORITY_NONE;
+
+    const char *txt = p + 2;
+    if (span_starts(txt, end, "[x] ")) { h->completed = 1; txt += 4; }
+    else if (span_starts(txt, end, "[ ] ")) { txt += 4; }
+
+    const char *te = end;
+    Badge b;
+    while (peel_badge(txt, &te, &b)) {
+        switch (b.kind) {
+            case BADGE_PIN:       h->pinned = 1; break;
+            case BADGE_COLLAPSED: h->collapsed = 1; break;
+            case BADGE_PRIORITY:  if (b.value > (int)h->priority) h->priority = (Priority)b.value; break;
+            case BADGE_COLOR:     h->color = (UiColor)b.value; break;
+        }
+    }
+
+    long c = 0, m = 0;
+    if (peel_timestamps(txt, &te, &c, &m)) {
+        e->created = (time_t)c;
+        e->modified = (time_t)m;
+    } else {
+        e->created = e->modified = time(NULL);
+    }
+    te = rtrim_span(txt, te);
+
+    /* trailing " #tag" tokens form the tag list */
+    const char *tags_end = te;
+    for (;;) {
+        const char *sp = te;
+        while (sp > txt && sp[-1] != ' ') sp--;
+        if (sp == txt || te - sp < 2 || *sp != '#') break;
+        te = rtrim_span(txt, sp);
+    }
+    for (const char *t = te; t < tags_end && e->tag_count < MAX_TAGS; ) {
+        t = skip_char(t, tags_end, ' ');
+        t = skip_char(t, tags_end, '#');
+        const char *tend = t;
+        while (tend < tags_end && *tend != ' ') tend++;
+        if (tend > t) {
+            int id = intern_tag(nb, t, (size_t)(tend - t));
+            if (id < 0) return id;
+            e->tags[e->tag_count++] = (uint16_t)id;
+        }
+        t = tend;
+    }
+
+    const char *text = arena_strndup(&nb->strings, txt, (size_t)(te - txt));
+    if (!text) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    e->text = text;
+    e->text_len = (int)(te - txt);
+    return HP_OK;
+}
+
+static int load_entry_line(HackPad *nb, LoadState *ls, int lead, const char *p, const char *end) {
+    Entry e;
+    EntryHot h;
+    int rc = parse_entry_line(nb, lead, p, end, &e, &h);
+    if (rc != HP_OK) return rc;
+    e.section_id = ls->current_section_id;
+    e.parent_id = (h.depth == 0) ? -1 : ls->entry_parent_at_depth[h.depth - 1];
+
+    Entry *slot = append_entry(nb, &nb->sections[nb->section_count - 1], &h);
+    if (!slot) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    e.id = nb->next_entry_id++;
+    *slot = e;
+
+    ls->entry_parent_at_depth[h.depth] = e.id;
+    return HP_OK;
+}
+
+/* Read file into nb, from its .hpb snapshot when that is current. HP_OK for
+   an empty file too; HP_ERR_NOTFOUND when there is no file. A file that
+   cannot be held whole (too many tags, OOM) leaves nb empty. */
+int load_hackpad(HackPad *nb, const char *file) {
+    autosave_detach(nb);
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        int err = errno;
+        return hp_fail(nb, err == ENOENT ? HP_ERR_NOTFOUND : HP_ERR_IO, "Could not open %s: %s", file, strerror(err));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return hp_fail(nb, HP_ERR_IO, "Could not read %s: %s", file, strerror(err));
+    }
+    if (st.st_size <= 0 || load_hpb(nb, file, &st)) { close(fd); return HP_OK; }
+    size_t size = (size_t)st.st_size;
+
+    /* map the whole file; fall back to one read() if mmap is unavailable */
+    char *owned = NULL;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        data = NULL;
+        owned = (char*)malloc(size);
+        if (owned) {
+            size_t got = 0;
+            while (got < size) {
+                ssize_t r = read(fd, owned + got, size - got);
+                if (r <= 0) break;
+                got += (size_t)r;
+            }
+            size = got;
+            data = owned;
+        }
+    } else {
+        posix_madvise((void*)data, size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+    if (!data) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory reading %s", file);
+
+    LoadState ls;
+    ls.current_section_id = -1;
+    for (int i = 0; i < 256; i++) ls.entry_parent_at_depth[i] = -1;
+
+    const char *p = data;
+    const char *eof = data + size;
+    int rc = HP_OK;
+    while (p < eof && rc == HP_OK) {
+        const char *nl = memchr(p, '\n', (size_t)(eof - p));
+        const char *line = p;
+        const char *end = nl ? nl : eof;
+        p = nl ? nl + 1 : eof;
+        if (end > line && end[-1] == '\r') end--;
+
+        if (span_starts(line, end, "Created: ")) {
+            load_created_header(nb, line + 9, end);
+            continue;
+        }
+
+        if (ls.current_section_id == -1 && span_starts(line, end, "Journal: ")) {
+            const char *q = line + 9;
+            long seq = 0;
+            if (parse_long_span(&q, end, &seq) && seq >= 0) {
+                nb->journal_seq = (unsigned long)seq;
+                nb->journal_header = 1;
+            }
+            continue;
+        }
+
+        if (span_starts(line, end, "##")) {
+            load_section_line(nb, &ls, line, end);
+            continue;
+        }
+
+        const char *q = skip_char(line, end, ' ');
+        if (span_starts(q, end, "- ") && ls.current_section_id != -1) {
+            rc = load_entry_line(nb, &ls, (int)(q - line), q, end);
+            continue;
+        }
+    }
+
+    if (owned) free(owned);
+    else munmap((void*)data, (size_t)st.st_size);
+    if (rc != HP_OK) {
+        free_hackpad(nb);
+        nb->journal_seq = 0;
+        nb->journal_header = 0;
+        return rc;
+    }
+
+    reindex_sections(nb, 0);
+    reindex_entries(nb, 0);
+    invalidate_views(nb);
+    return HP_OK;
+}
+
+/* ---------------- Insertion / removal ---------------- */
+
+static int insert_section_at(HackPad *nb, int insert_pos, Section *s) {
+    if (!reserve_sections(nb, nb->section_count + 1)) return 0;
+    if (insert_pos < 0) insert_pos = 0;
+    if (insert_pos > nb->section_count) insert_pos = nb->section_count;
+
+    s->first_entry = s->last_entry = -1;
+    s->entry_count = 0;
+
+    memmove(&nb->sections[insert_pos + 1], &nb->sections[insert_pos],
+            (size_t)(nb->section_count - insert_pos) * sizeof(Section));
+    nb->sections[insert_pos] = *s;
+    nb->section_count++;
+    reindex_sections(nb, insert_pos);
+    invalidate_views(nb);
+    mark_modified(nb);
+    return 1;
+}
+
+/* Link e into its section right after slot 'after' (-1: at the front).
+   Nothing else moves: the new row takes a free slot. */
+int insert_entry_at(HackPad *nb, int after, Entry *e, const EntryHot *h) {
+    int si = find_section_index_by_id(nb, e->section_id);
+    if (si < 0) return 0;
+    if (!reserve_id_map(&nb->entry_index_by_id, &nb->entry_index_cap, e->id + 1)) return 0;
+    int slot = alloc_entry_slot(nb, h);
+    if (slot < 0) return 0;
+
+    nb->entries[slot] = *e;
+    link_entry(nb, &nb->sections[si], slot, after);
+    nb->entry_index_by_id[e->id] = slot;
+    search_update(nb, &nb->entries[slot]);
+    invalidate_views(nb);
+    mark_modified(nb);
+    return 1;
+}
+
+/* Drop the run of count entries starting at slot first; they must already be unlinked */
+static void free_entry_run(HackPad *nb, int first, int count) {
+    for (int i = first, n = 0; n < count; n++) {
+        int next = nb->entry_next[i];
+        search_forget(nb, nb->entries[i].id);
+        unindex_entry(nb, nb->entries[i].id);
+        free_entry_slot(nb, i);
+        i = next;
+    }
+}
+
+/* Repack the slot pool once free slots outnumber live ones: every section's
+   entries end up consecutive, in list order. One O(n) pass; ids stay, slot
+   numbers change. On OOM the sparse pool is simply kept. */
+static void compact_entries(HackPad *nb) {
+    int n = nb->entry_count;
+    if (nb->entry_slots < 64 || nb->entry_slots - n <= n) return;
+
+    size_t cap = (size_t)(n > 0 ? n : 1);
+    Entry *entries = (Entry*)malloc(cap * sizeof(Entry));
+    EntryCols cols;
+    cols.depth = (uint8_t*)malloc(cap);
+    cols.flags = (uint8_t*)malloc(cap);
+    cols.priority = (uint8_t*)malloc(cap);
+    cols.color = (uint8_t*)malloc(cap);
+    int *next = (int*)malloc(cap * sizeof(int));
+    int *prev = (int*)malloc(cap * sizeof(int));
+    if (!entries || !cols.depth || !cols.flags || !cols.priority || !cols.color || !next || !prev) {
+        free(entries); cols_free(&cols); free(next); free(prev);
+        return;
+    }
+
+    int k = 0;
+    for (int si = 0; si < nb->section_count; si++) {
+        Section *s = &nb->sections[si];
+        int first = k, hint = s->pos_slot - 1;
+        for (int i = s->first_entry; i >= 0; i = nb->entry_next[i], k++) {
+            if (i == hint) s->pos_slot = k + 1;
+            entries[k] = nb->entries[i];
+            cols.depth[k] = nb->cols.depth[i];
+            cols.flags[k] = nb->cols.flags[i];
+            cols.priority[k] = nb->cols.priority[i];
+            cols.color[k] = nb->cols.color[i];
+            prev[k] = k > first ? k - 1 : -1;
+            next[k] = k + 1;
+        }
+        if (k > first) {
+            next[k - 1] = -1;
+            s->first_entry = first;
+            s->last_entry = k - 1;
+        }
+    }
+
+    free(nb->entries);
+    cols_free(&nb->cols);
+    free(nb->entry_next);
+    free(nb->entry_prev);
+    nb->entries = entries;
+    nb->cols = cols;
+    nb->entry_next = next;
+    nb->entry_prev = prev;
+    nb->entry_slots = k;
+    nb->entry_free = 0;
+    nb->entry_cap = (int)cap;
+    reindex_entries(nb, 0);
+    invalidate_views(nb);
+}
+
+/* Remove section si with its sub-sections and all their entries */
+void remove_section_subtree(HackPad *nb, int si) {
+    /* delete section subtree in one shot (since order is depth-first) */
+    int end = section_subtree_end_index(nb, si);
+
+    for (int i = si; i <= end; i++) {
+        Section *s = &nb->sections[i];
+        if (s->first_entry >= 0) free_entry_run(nb, s->first_entry, s->entry_count);
+    }
+
+    /* remove the section subtree */
+    int remove_count = end - si + 1;
+    for (int i = si; i <= end; i++) unindex_section(nb, nb->sections[i].id);
+    memmove(&nb->sections[si], &nb->sections[end + 1],
+            (size_t)(nb->section_count - end - 1) * sizeof(Section));
+    nb->section_count -= remove_count;
+    reindex_sections(nb, si);
+    compact_entries(nb);
+    invalidate_views(nb);
+    mark_modified(nb);
+}
+
+/* Remove count consecutive entries of section si, starting at slot start */
+static void remove_entries(HackPad *nb, int si, int start, int count) {
+    int last = start;
+    for (int n = 1; n < count; n++) last = nb->entry_next[last];
+    unlink_entries(nb, &nb->sections[si], start, last, count);
+    free_entry_run(nb, start, count);
+    compact_entries(nb);
+    invalidate_views(nb);
+    mark_modified(nb);
+}
+
+/* ---------------- Journal ---------------- */
+
+/* Every mutation is appended to "<file>.journal" as one line and synced before
+   the next key is read, so a crash costs at most the change in flight. Saves
+   (manual and autosave) fold the journal into the markdown and truncate it.
+
+     <seq> S+ <si> <heading>        insert section at index si
+     <seq> S= <si> <heading>        replace a section's name/fold/color
+     <seq> S- <si>                  delete section si and its sub-sections
+     <seq> E+ <si> <n> <entry>      insert the n-th entry of section si
+     <seq> E= <si> <n> <entry>      replace the n-th entry of section si
+     <seq> E- <si> <n> <count>      delete count entries from the n-th on
+
+   <heading> and <entry> are the markdown lines save writes. Records address
+   positions, not ids, since ids are handed out afresh on every load. */
+
+static void journal_path(char *out, size_t cap, const char *file) {
+    snprintf(out, cap, "%s.journal", file);
+}
+
+static void journal_close(HackPad *nb) {
+    if (nb->journal_fd >= 0) close(nb->journal_fd);
+    nb->journal_fd = -1;
+}
+
+/* Journal changes to file from now on, keeping the first keep bytes already there */
+static void journal_attach(HackPad *nb, const char *file, long keep) {
+    journal_close(nb);
+    nb->journal_failed = 0;
+    nb->journal_keep = keep;
+    strncpy(nb->journal_md, file, sizeof(nb->journal_md) - 1);
+    nb->journal_md[sizeof(nb->journal_md) - 1] = '\0';
+}
+
+int journal_active(HackPad *nb) {
+    return nb->journal_md[0] && !nb->journal_failed;
+}
+
+/* Stop journaling until the next save, for tools that make all their changes
+   and then save once (see hackpad_batch.c). The journal already on disk is
+   left alone until that save folds it in. */
+void journal_suspend(HackPad *nb) {
+    journal_close(nb);
+    nb->journal_failed = 1;
+}
+
+static void journal_fail(HackPad *nb, int err) {
+    hp_fail(nb, HP_ERR_IO, "Journal disabled: %s", strerror(err));
+    journal_close(nb);
+    nb->journal_failed = 1;
+}
+
+/* Everything up to now is in file: drop the journal (and re-arm it after a failure) */
+static void journal_reset(HackPad *nb, const char *file) {
+    if (!nb->journal_md[0] || strcmp(file, nb->journal_md) != 0) return;
+
+    journal_close(nb);
+    char path[272];
+    journal_path(path, sizeof(path), nb->journal_md);
+    unlink(path);
+    nb->journal_keep = 0;
+    nb->journal_failed = 0;
+}
+
+/* rec holds 'records' complete records; they are written and synced together */
+static void journal_write(HackPad *nb, StrBuf *rec, int records) {
+    if (rec->oom) { journal_fail(nb, ENOMEM); return; }
+
+    if (nb->journal_fd < 0) {
+        char path[272];
+        journal_path(path, sizeof(path), nb->journal_md);
+        int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+        if (fd < 0) { journal_fail(nb, errno); return; }
+        /* cut off whatever replay could not use */
+        if (ftruncate(fd, (off_t)nb->journal_keep) != 0) {
+            int err = errno;
+            close(fd);
+            journal_fail(nb, err);
+            return;
+        }
+        nb->journal_fd = fd;
+    }
+
+    if (write_all(nb->journal_fd, rec->data, rec->len) != 0 || fdatasync(nb->journal_fd) != 0) {
+        journal_fail(nb, errno);
+        return;
+    }
+    nb->journal_seq += (unsigned long)records;
+}
+
+/* Start a record: "<kind><op> <si>". The journal puts "<seq> " in front. */
+static void record_begin(StrBuf *rec, char kind, char op, int si) {
+    char code[4] = {kind, op, ' ', '\0'};
+    sb_puts(rec, code);
+    sb_long(rec, si);
+}
+
+/* Queue record p[0..len) (no newline) as the nth of a batch for journal_write; 1 if queued */
+static int journal_add(HackPad *nb, StrBuf *batch, int nth, const char *p, size_t len) {
+    if (!journal_active(nb)) return 0;
+    sb_long(batch, (long)(nb->journal_seq + (unsigned long)nth));
+    sb_puts(batch, " ");
+    sb_putn(batch, p, len);
+    sb_puts(batch, "\n");
+    return 1;
+}
+
+static int undo_recording(HackPad *nb);
+static void undo_did(HackPad *nb, const StrBuf *rec);
+static void undo_note_added(HackPad *nb, char kind, int si, int pos);
+static void undo_note_removed_entries(HackPad *nb, int si, int pos, int first, int count);
+static void undo_note_removed_sections(HackPad *nb, int si);
+
+/* A change that was just made: to the journal and to the undo history */
+static void journal_record(HackPad *nb, const StrBuf *rec) {
+    StrBuf batch = {0};
+    if (journal_add(nb, &batch, 0, rec->data, rec->len)) journal_write(nb, &batch, 1);
+    sb_free(&batch);
+    undo_did(nb, rec);
+}
+
+/* op is '+', '=' or '-'; log '-' before removing, the others after the change */
+void journal_section(HackPad *nb, char op, int si) {
+    if (si < 0 || (!journal_active(nb) && !undo_recording(nb))) return;
+    if (op == '-') undo_note_removed_sections(nb, si);
+
+    StrBuf rec = {0};
+    record_begin(&rec, 'S', op, si);
+    if (op != '-') {
+        sb_puts(&rec, " ");
+        serialize_section_heading(&rec, &nb->sections[si]);
+    }
+    journal_record(nb, &rec);
+    sb_free(&rec);
+    if (op == '+') undo_note_added(nb, 'S', si, 0);
+}
+
+static void journal_entry(HackPad *nb, char op, int ei, int count) {
+    if (ei < 0 || (!journal_active(nb) && !undo_recording(nb))) return;
+    Entry *e = &nb->entries[ei];
+    int si = find_section_index_by_id(nb, e->section_id);
+    if (si < 0) return;
+    int pos = entry_position(nb, &nb->sections[si], ei);
+    if (op == '-') undo_note_removed_entries(nb, si, pos, ei, count);
+
+    StrBuf rec = {0};
+    record_begin(&rec, 'E', op, si);
+    sb_puts(&rec, " ");
+    sb_long(&rec, pos);
+    sb_puts(&rec, " ");
+    if (op == '-') sb_long(&rec, count);
+    else serialize_entry(nb, &rec, ei);
+    journal_record(nb, &rec);
+    sb_free(&rec);
+    if (op == '+') undo_note_added(nb, 'E', si, pos);
+}
+
+/* Nearest earlier section/entry one level up, as the loader would pick it */
+static int section_parent_before(HackPad *nb, int pos, int depth) {
+    for (int i = pos - 1; i >= 0 && depth > 0; i--) {
+        if (nb->sections[i].depth == depth - 1) return nb->sections[i].id;
+    }
+    return -1;
+}
+
+/* 'after' is the slot the new entry will follow (-1: front of its section) */
+static int entry_parent_before(HackPad *nb, int after, int depth) {
+    for (int i = after; i >= 0 && depth > 0; i = nb->entry_prev[i]) {
+        if (nb->cols.depth[i] == depth - 1) return nb->entries[i].id;
+    }
+    return -1;
+}
+
+/* Apply one record (text after "<seq> "); 0 if it does not fit the
+   notebook, a negative HP_ERR_* code if it fits but cannot be held */
+static int journal_apply(HackPad *nb, const char *p, const char *end) {
+    if (end - p < 4 || (p[0] != 'S' && p[0] != 'E') || p[2] != ' ') return 0;
+    char kind = p[0], op = p[1];
+    if (op != '+' && op != '=' && op != '-') return 0;
+    p += 3;
+
+    long si = 0;
+    if (!parse_long_span(&p, end, &si)) return 0;
+
+    if (kind == 'S') {
+        long limit = op == '+' ? nb->section_count : nb->section_count - 1;
+        if (si < 0 || si > limit) return 0;
+        if (op == '-') {
+            if (p != end) return 0;
+            remove_section_subtree(nb, (int)si);
+            return 1;
+        }
+        if (p >= end || *p++ != ' ') return 0;
+
+        Section s;
+        memset(&s, 0, sizeof(s));
+        parse_section_heading(p, end, &s);
+        if (op == '=') {
+            Section *cur = &nb->sections[si];
+            memcpy(cur->name, s.name, sizeof(cur->name));
+            cur->collapsed = s.collapsed;
+            cur->color = s.color;
+            invalidate_views(nb);
+            mark_modified(nb);
+            return 1;
+        }
+        s.id = nb->next_section_id++;
+        s.parent_id = section_parent_before(nb, (int)si, s.depth);
+        return insert_section_at(nb, (int)si, &s);
+    }
+
+    if (si < 0 || si >= nb->section_count) return 0;
+    Section *sec = &nb->sections[si];
+
+    long n = 0;
+    if (p >= end || *p++ != ' ' || !parse_long_span(&p, end, &n)) return 0;
+    long limit = op == '+' ? sec->entry_count : sec->entry_count - 1;
+    if (n < 0 || n > limit) return 0;
+    if (p >= end || *p++ != ' ') return 0;
+    /* E+ inserts in front of entry n, i.e. right after entry n-1 */
+    int ei = entry_at(nb, sec, op == '+' ? (int)n - 1 : (int)n);
+
+    if (op == '-') {
+        long count = 0;
+        if (!parse_long_span(&p, end, &count) || p != end) return 0;
+        if (count <= 0 || n + count > sec->entry_count) return 0;
+        remove_entries(nb, (int)si, ei, (int)count);
+        return 1;
+    }
+
+    const char *q = skip_char(p, end, ' ');
+    if (!span_starts(q, end, "- ")) return 0;
+    Entry e;
+    EntryHot h;
+    int rc = parse_entry_line(nb, (int)(q - p), q, end, &e, &h);
+    if (rc != HP_OK) return rc;
+
+    if (op == '=') {
+        Entry *cur = &nb->entries[ei];
+        e.id = cur->id;
+        e.section_id = cur->section_id;
+        e.parent_id = cur->parent_id;
+        h.depth = nb->cols.depth[ei];
+        *cur = e;
+        entry_set_hot(nb, ei, &h);
+        search_update(nb, cur);
+        invalidate_views(nb);
+        mark_modified(nb);
+        return 1;
+    }
+    e.id = nb->next_entry_id++;
+    e.section_id = sec->id;
+    e.parent_id = entry_parent_before(nb, ei, h.depth);
+    return insert_entry_at(nb, ei, &e, &h);
+}
+
+/* Replay the records file's markdown does not include yet (seq >= journal_seq).
+   Returns how many leading bytes of the journal are sound; a torn last write
+   or a record that does not follow on is cut off when the journal is reopened.
+   A sound record nb cannot hold stops the replay with its HP_ERR_* code
+   instead, so the journal is not cut. */
+static long journal_replay(HackPad *nb, const char *file) {
+    char path[272];
+    journal_path(path, sizeof(path), file);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    char *data = NULL;
+    size_t got = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (data = (char*)malloc((size_t)st.st_size))) {
+        while (got < (size_t)st.st_size) {
+            ssize_t r = read(fd, data + got, (size_t)st.st_size - got);
+            if (r <= 0) break;
+            got += (size_t)r;
+        }
+    }
+    close(fd);
+    if (!data) return 0;
+
+    const char *p = data;
+    const char *eof = data + got;
+    long keep = 0;
+    while (p < eof) {
+        const char *nl = memchr(p, '\n', (size_t)(eof - p));
+        if (!nl) break;
+
+        const char *q = p;
+        long seq = 0;
+        if (!parse_long_span(&q, nl, &seq) || seq < 0 || q >= nl || *q != ' ') break;
+        if ((unsigned long)seq >= nb->journal_seq) {
+            if ((unsigned long)seq != nb->journal_seq) break;
+            int rc = journal_apply(nb, q + 1, nl);
+            if (rc < 0) {
+                free(data);
+                return rc;
+            }
+            if (!rc) break;
+            nb->journal_seq++;
+        }
+        p = nl + 1;
+        keep = (long)(p - data);
+    }
+
+    free(data);
+    return keep;
+}
+
+/* ---------------- Undo ---------------- */
+
+/* Undo history in the journal's record language, minus the seq numbers. A
+   step is everything changed between two undo_commit calls (one key in the
+   UI): the records it wrote (redo) and their inverses (undo), built before
+   anything is lost, so a deleted subtree comes back as its own markdown
+   lines at its old position. Undo and redo replay
+   them through journal_apply and journal them like any other change. Once
+   the steps hold more than the budget (HACKPAD_UNDO_KB, default 4096; 0
+   turns undo off) the oldest are dropped. */
+
+typedef struct {
+    StrBuf undo;        /* inverse records, applied last line first */
+    StrBuf redo;        /* the step's records, applied first line first */
+} UndoStep;
+
+typedef struct Undo {
+    UndoStep *steps;
+    int count;
+    int cap;
+    int pos;            /* steps[0..pos) can be undone, steps[pos..count) redone */
+    UndoStep open;      /* what the current step has changed so far */
+    size_t bytes;       /* held by steps[] */
+    size_t budget;
+} Undo;
+
+/* Keep an undo history unless HACKPAD_UNDO_KB is 0 (nb->undo stays NULL then) */
+void undo_start(HackPad *nb) {
+    const char *env = getenv("HACKPAD_UNDO_KB");
+    long kb = env ? atol(env) : 4096;
+    if (kb <= 0) return;
+    Undo *u = (Undo*)calloc(1, sizeof(Undo));
+    if (!u) return;
+    u->budget = (size_t)kb * 1024;
+    nb->undo = u;
+}
+
+static int undo_recording(HackPad *nb) { return nb->undo != NULL; }
+
+static size_t undo_step_size(const UndoStep *st) { return st->undo.cap + st->redo.cap; }
+
+static void undo_step_free(UndoStep *st) {
+    sb_free(&st->undo);
+    sb_free(&st->redo);
+}
+
+/* Drop every step, e.g. once the history no longer matches the notebook */
+static void undo_clear(Undo *u) {
+    for (int i = 0; i < u->count; i++) undo_step_free(&u->steps[i]);
+    undo_step_free(&u->open);
+    u->count = u->pos = 0;
+    u->bytes = 0;
+}
+
+void undo_free(HackPad *nb) {
+    Undo *u = nb->undo;
+    if (!u) return;
+    undo_clear(u);
+    free(u->steps);
+    free(u);
+    nb->undo = NULL;
+}
+
+/* rec (one record, no newline) has just been applied */
+static void undo_did(HackPad *nb, const StrBuf *rec) {
+    if (!undo_recording(nb)) return;
+    sb_putn(&nb->undo->open.redo, rec->data, rec->len);
+    sb_puts(&nb->undo->open.redo, "\n");
+}
+
+/* lines (records, in the order that reverts the latest change) undo it. They
+   are stored reversed since the whole step is read back last line first. */
+static void undo_inverse(HackPad *nb, const StrBuf *lines) {
+    StrBuf *out = &nb->undo->open.undo;
+    if (lines->oom) { out->oom = 1; return; }
+    if (!sb_reserve(out, lines->len)) return;
+    const char *end = lines->data + lines->len;
+    while (end > lines->data) {
+        const char *p = end - 1;
+        while (p > lines->data && p[-1] != '\n') p--;
+        sb_putn(out, p, (size_t)(end - p));
+        end = p;
+    }
+}
+
+/* Section si / the pos-th entry of section si was just added */
+static void undo_note_added(HackPad *nb, char kind, int si, int pos) {
+    if (!undo_recording(nb)) return;
+    StrBuf lines = {0};
+    record_begin(&lines, kind, '-', si);
+    if (kind == 'E') {
+        sb_puts(&lines, " ");
+        sb_long(&lines, pos);
+        sb_puts(&lines, " 1");
+    }
+    sb_puts(&lines, "\n");
+    undo_inverse(nb, &lines);
+    sb_free(&lines);
+}
+
+static void undo_put_entry(HackPad *nb, StrBuf *lines, char op, int si, int pos, int ei) {
+    record_begin(lines, 'E', op, si);
+    sb_puts(lines, " ");
+    sb_long(lines, pos);
+    sb_puts(lines, " ");
+    serialize_entry(nb, lines, ei);
+    sb_puts(lines, "\n");
+}
+
+/* count entries from slot first (the pos-th of section si) are about to go */
+static void undo_note_removed_entries(HackPad *nb, int si, int pos, int first, int count) {
+    if (!undo_recording(nb)) return;
+    StrBuf lines = {0};
+    for (int i = first, n = 0; n < count; n++, i = nb->entry_next[i])
+        undo_put_entry(nb, &lines, '+', si, pos + n, i);
+    undo_inverse(nb, &lines);
+    sb_free(&lines);
+}
+
+/* Section si and its sub-sections are about to go, entries and all */
+static void undo_note_removed_sections(HackPad *nb, int si) {
+    if (!undo_recording(nb)) return;
+    StrBuf lines = {0};
+    int end = section_subtree_end_index(nb, si);
+    for (int k = si; k <= end; k++) {
+        record_begin(&lines, 'S', '+', k);
+        sb_puts(&lines, " ");
+        serialize_section_heading(&lines, &nb->sections[k]);
+        sb_puts(&lines, "\n");
+        int pos = 0;
+        for (int i = nb->sections[k].first_entry; i >= 0; i = nb->entry_next[i])
+            undo_put_entry(nb, &lines, '+', k, pos++, i);
+    }
+    undo_inverse(nb, &lines);
+    sb_free(&lines);
+}
+
+/* Call right before changing entry ei / section si in place; the E=/S= record
+   logged after the change is undone by the line kept here */
+static void undo_note_entry(HackPad *nb, int ei) {
+    if (!undo_recording(nb)) return;
+    int si = find_section_index_by_id(nb, nb->entries[ei].section_id);
+    if (si < 0) return;
+    StrBuf lines = {0};
+    undo_put_entry(nb, &lines, '=', si, entry_position(nb, &nb->sections[si], ei), ei);
+    undo_inverse(nb, &lines);
+    sb_free(&lines);
+}
+
+static void undo_note_section(HackPad *nb, int si) {
+    if (!undo_recording(nb)) return;
+    StrBuf lines = {0};
+    record_begin(&lines, 'S', '=', si);
+    sb_puts(&lines, " ");
+    serialize_section_heading(&lines, &nb->sections[si]);
+    sb_puts(&lines, "\n");
+    undo_inverse(nb, &lines);
+    sb_free(&lines);
+}
+
+/* Trim a finished buffer to its contents: the budget counts what is held */
+static void undo_pack(StrBuf *b) {
+    if (b->cap == b->len) return;
+    char *p = b->len ? (char*)realloc(b->data, b->len) : NULL;
+    if (b->len && !p) return;
+    if (!b->len) free(b->data);
+    b->data = p;
+    b->cap = b->len;
+}
+
+/* Close the current step (the UI calls this after every key, tools after each batch) */
+void undo_commit(HackPad *nb) {
+    Undo *u = nb->undo;
+    if (!u) return;
+    UndoStep st = u->open;
+    memset(&u->open, 0, sizeof(u->open));
+    if (!st.redo.len) { undo_step_free(&st); return; }
+    if (st.undo.oom || st.redo.oom) {
+        undo_step_free(&st);
+        undo_clear(u);
+        hp_fail(nb, HP_ERR_NOMEM, "Out of memory; undo history cleared");
+        return;
+    }
+    undo_pack(&st.undo);
+    undo_pack(&st.redo);
+
+    /* a new change forgets whatever could have been redone */
+    for (int i = u->pos; i < u->count; i++) {
+        u->bytes -= undo_step_size(&u->steps[i]);
+        undo_step_free(&u->steps[i]);
+    }
+    u->count = u->pos;
+
+    if (u->count == u->cap) {
+        int cap = grow_capacity(u->cap, u->count + 1);
+        UndoStep *p = (UndoStep*)realloc(u->steps, (size_t)cap * sizeof(UndoStep));
+        if (!p) { undo_step_free(&st); undo_clear(u); return; }
+        u->steps = p;
+        u->cap = cap;
+    }
+    u->steps[u->count++] = st;
+    u->pos = u->count;
+    u->bytes += undo_step_size(&st);
+
+    int drop = 0;
+    while (drop < u->count && u->bytes > u->budget) {
+        u->bytes -= undo_step_size(&u->steps[drop]);
+        undo_step_free(&u->steps[drop++]);
+    }
+    if (drop) {
+        memmove(u->steps, u->steps + drop, (size_t)(u->count - drop) * sizeof(UndoStep));
+        u->count -= drop;
+        u->pos = u->count;
+    }
+}
+
+/* Select what record p..end (no seq) touched */
+static void undo_select(HackPad *nb, const char *p, const char *end) {
+    char kind = p[0], op = p[1];
+    p += 3;
+    long si = 0, n = 0;
+    if (!parse_long_span(&p, end, &si) || nb->section_count == 0) return;
+    if (si >= nb->section_count) si = nb->section_count - 1;
+    Section *s = &nb->sections[si];
+    nb->current_section_id = s->id;
+    nb->selected_entry_id = -1;
+    nb->focus = FOCUS_SECTIONS;
+    if (kind != 'E' || op == '-' || p >= end || *p++ != ' ' || !parse_long_span(&p, end, &n)) return;
+    int ei = entry_at(nb, s, (int)n);
+    if (ei >= 0) {
+        nb->selected_entry_id = nb->entries[ei].id;
+        nb->focus = FOCUS_ENTRIES;
+    }
+}
+
+/* Apply the records in lines (last line first when backwards) and journal
+   them as one batch; the first one applied picks the selection. 1, 0 if a
+   record no longer fits, or journal_apply's error code. */
+static int undo_apply(HackPad *nb, const StrBuf *lines, int backwards) {
+    StrBuf batch = {0};
+    int records = 0, applied = 0, ok = 1;
+    const char *lo = lines->data, *hi = lines->data + lines->len;
+    while (lo < hi) {
+        const char *p, *end;
+        if (backwards) {
+            end = hi - 1;
+            for (p = end; p > lo && p[-1] != '\n'; p--) {}
+            hi = p;
+        } else {
+            p = lo;
+            end = (const char*)memchr(p, '\n', (size_t)(hi - p));
+            if (!end) end = hi;
+            lo = end + 1;
+        }
+        int rc = journal_apply(nb, p, end);
+        if (rc <= 0) { ok = rc; break; }
+        if (!applied++) undo_select(nb, p, end);
+        records += journal_add(nb, &batch, records, p, (size_t)(end - p));
+    }
+    if (records) journal_write(nb, &batch, records);
+    sb_free(&batch);
+    return ok;
+}
+
+/* Undo the last step, or redo the last undone one. HP_ERR_NOOP when undo is
+   off or there is nothing to undo/redo; HP_ERR_STATE if the step no longer
+   applies (the history is cleared then). */
+int undo_step(HackPad *nb, int redo) {
+    autosave_detach(nb);
+    Undo *u = nb->undo;
+    if (!u) return hp_fail(nb, HP_ERR_NOOP, "Undo is off (HACKPAD_UNDO_KB=0)");
+    if (redo ? u->pos == u->count : u->pos == 0)
+        return hp_fail(nb, HP_ERR_NOOP, redo ? "Nothing to redo" : "Nothing to undo");
+
+    UndoStep *st = &u->steps[redo ? u->pos : u->pos - 1];
+    int rc = undo_apply(nb, redo ? &st->redo : &st->undo, !redo);
+    if (rc <= 0) {
+        undo_clear(u);
+        return rc < 0 ? rc : hp_fail(nb, HP_ERR_STATE, "Undo history no longer fits the notebook; cleared");
+    }
+    u->pos += redo ? 1 : -1;
+    return HP_OK;
+}
+
+/* ---------------- Bulk removal ---------------- */
+
+/* Remove every entry of sections si..last_si that q matches, sub-entries
+   included, in one pass over each section's list: O(entries scanned) however
+   many go. Each run of neighbouring removals is one E- record; the records
+   are synced together. Returns how many entries were removed. */
+int remove_entries_where(HackPad *nb, int si, int last_si, ViewQuery *q) {
+    autosave_detach(nb);
+    const uint8_t *depth = nb->cols.depth;
+    StrBuf rec = {0}, r = {0};
+    int records = 0, removed = 0;
+
+    for (int k = si; k <= last_si; k++) {
+        Section *s = &nb->sections[k];
+        int pos = 0;    /* entries kept so far: where a run sits once earlier runs are gone */
+        for (int i = s->first_entry; i >= 0; ) {
+            if (!viewq_match(nb, q, i)) { pos++; i = nb->entry_next[i]; continue; }
+
+            int first = i, last = i, n = 0;
+            while (i >= 0 && viewq_match(nb, q, i)) {
+                int d = depth[i];
+                do { last = i; n++; i = nb->entry_next[i]; } while (i >= 0 && depth[i] > d);
+            }
+            undo_note_removed_entries(nb, k, pos, first, n);
+            r.len = 0;
+            record_begin(&r, 'E', '-', k);
+            sb_puts(&r, " ");
+            sb_long(&r, pos);
+            sb_puts(&r, " ");
+            sb_long(&r, n);
+            records += journal_add(nb, &rec, records, r.data, r.len);
+            undo_did(nb, &r);
+
+            unlink_entries(nb, s, first, last, n);
+            free_entry_run(nb, first, n);
+            removed += n;
+        }
+    }
+    if (records) journal_write(nb, &rec, records);
+    sb_free(&rec);
+    sb_free(&r);
+
+    if (removed) {
+        compact_entries(nb);
+        invalidate_views(nb);
+        mark_modified(nb);
+    }
+    return removed;
+}
+
+/* ---------------- Edits ---------------- */
+
+/* Complete changes: checked, journaled and recorded for undo. Frontends and
+   tools make every change through these (or remove_entries_where). They
+   return an id, a count or HP_OK, or an HP_ERR_* code with nb->error set. */
+
+static int entry_ok(HackPad *nb, int ei) {
+    return ei >= 0 && ei < nb->entry_slots && entry_live(nb, ei);
+}
+
+/* A new section at index pos (clamped to the list); returns its id */
+int create_section(HackPad *nb, int pos, int parent_id, int depth, const char *name) {
+    autosave_detach(nb);
+    Section s;
+    memset(&s, 0, sizeof(s));
+    s.id = nb->next_section_id++;
+    s.parent_id = parent_id;
+    s.depth = depth;
+    s.collapsed = 0;
+    s.color = HP_COLOR_NONE;
+    strncpy(s.name, name, MAX_NAME - 1);
+
+    if (!insert_section_at(nb, pos, &s)) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    journal_section(nb, '+', find_section_index_by_id(nb, s.id));
+    return s.id;
+}
+
+/* A new entry in section section_id right after slot 'after' (-1: at the
+   front); returns its id */
+int create_entry(HackPad *nb, int section_id, int after, int parent_id, int depth, const char *text) {
+    autosave_detach(nb);
+    if (find_section_index_by_id(nb, section_id) < 0) return hp_fail(nb, HP_ERR_NOTFOUND, "No such section");
+    if (after >= 0 && (!entry_ok(nb, after) || nb->entries[after].section_id != section_id))
+        return hp_fail(nb, HP_ERR_NOTFOUND, "No such entry in the section");
+    if (depth < 0 || depth > MAX_DEPTH) return hp_fail(nb, HP_ERR_LIMIT, "Entries nest at most %d levels deep", MAX_DEPTH);
+
+    Entry e;
+    memset(&e, 0, sizeof(e));
+    e.id = nb->next_entry_id++;
+    e.section_id = section_id;
+    e.parent_id = parent_id;
+    if (!entry_set_text(nb, &e, text)) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    e.created = e.modified = time(NULL);
+
+    EntryHot h = { depth, 0, 0, 0, PRIORITY_NONE, HP_COLOR_NONE };
+    if (!insert_entry_at(nb, after, &e, &h)) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    journal_entry(nb, '+', find_entry_index_by_id(nb, e.id), 0);
+    return e.id;
+}
+
+int update_entry_text(HackPad *nb, int ei, const char *text) {
+    autosave_detach(nb);
+    if (!entry_ok(nb, ei)) return hp_fail(nb, HP_ERR_NOTFOUND, "No such entry");
+    Entry *e = &nb->entries[ei];
+    undo_note_entry(nb, ei);
+    if (!entry_set_text(nb, e, text)) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    e->modified = time(NULL);
+    search_update(nb, e);
+    invalidate_views(nb);
+    mark_modified(nb);
+    journal_entry(nb, '=', ei, 0);
+    return HP_OK;
+}
+
+/* Replace entry ei's tags with the words of tags (space or comma separated) */
+int update_entry_tags(HackPad *nb, int ei, const char *tags) {
+    autosave_detach(nb);
+    if (!entry_ok(nb, ei)) return hp_fail(nb, HP_ERR_NOTFOUND, "No such entry");
+    char *buf = strdup(tags);
+    if (!buf) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    Entry *e = &nb->entries[ei], tagged = *e;
+    int rc = entry_set_tags(nb, &tagged, buf, " ,");
+    free(buf);
+    if (rc != HP_OK) return rc;
+    undo_note_entry(nb, ei);
+    memcpy(e->tags, tagged.tags, sizeof(e->tags));
+    e->tag_count = tagged.tag_count;
+    e->modified = time(NULL);
+    search_update(nb, e);
+    invalidate_views(nb);
+    mark_modified(nb);
+    journal_entry(nb, '=', ei, 0);
+    return HP_OK;
+}
+
+/* Priority, color and the done/pin/fold flags of entry ei from h; the depth
+   stays. Folding alone does not count as modifying the entry. */
+int update_entry_attrs(HackPad *nb, int ei, const EntryHot *h) {
+    autosave_detach(nb);
+    if (!entry_ok(nb, ei)) return hp_fail(nb, HP_ERR_NOTFOUND, "No such entry");
+    EntryHot cur = entry_hot(nb, ei), next = *h;
+    next.depth = cur.depth;
+    undo_note_entry(nb, ei);
+    entry_set_hot(nb, ei, &next);
+    if (next.priority != cur.priority || next.color != cur.color ||
+        !next.completed != !cur.completed || !next.pinned != !cur.pinned)
+        nb->entries[ei].modified = time(NULL);
+    invalidate_views(nb);
+    mark_modified(nb);
+    journal_entry(nb, '=', ei, 0);
+    return HP_OK;
+}
+
+int update_section_attrs(HackPad *nb, int si, int collapsed, UiColor color) {
+    autosave_detach(nb);
+    if (si < 0 || si >= nb->section_count) return hp_fail(nb, HP_ERR_NOTFOUND, "No such section");
+    undo_note_section(nb, si);
+    nb->sections[si].collapsed = collapsed;
+    nb->sections[si].color = color;
+    invalidate_views(nb);
+    mark_modified(nb);
+    journal_section(nb, '=', si);
+    return HP_OK;
+}
+
+/* Delete section si with its sub-sections and all their entries */
+int delete_section_subtree(HackPad *nb, int si) {
+    autosave_detach(nb);
+    if (si < 0 || si >= nb->section_count) return hp_fail(nb, HP_ERR_NOTFOUND, "No such section");
+    journal_section(nb, '-', si);
+    remove_section_subtree(nb, si);
+    return HP_OK;
+}
+
+/* Delete entry ei and its sub-entries; returns how many went */
+int delete_entry_subtree(HackPad *nb, int ei) {
+    autosave_detach(nb);
+    if (!entry_ok(nb, ei)) return hp_fail(nb, HP_ERR_NOTFOUND, "No such entry");
+    int si = find_section_index_by_id(nb, nb->entries[ei].section_id);
+    if (si < 0) return hp_fail(nb, HP_ERR_NOTFOUND, "No such section");
+
+    /* the subtree is a consecutive run of the section's list */
+    int end = entry_subtree_end_index_in_section(nb, ei);
+    int count = 1;
+    for (int i = ei; i != end; i = nb->entry_next[i]) count++;
+
+    journal_entry(nb, '-', ei, count);
+    remove_entries(nb, si, ei, count);
+    return count;
+}
+
+/* Append section si and its sub-sections, as save writes them, to path (a
+   markdown file, "# HackPad Archive" heading when new), then delete them */
+int archive_section(HackPad *nb, int si, const char *path) {
+    autosave_detach(nb);
+    if (si < 0 || si >= nb->section_count) return hp_fail(nb, HP_ERR_NOTFOUND, "No such section");
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd < 0) return hp_fail(nb, HP_ERR_IO, "Could not open archive file: %s", strerror(errno));
+    struct stat st;
+    StrBuf out = {0};
+    if (fstat(fd, &st) == 0 && st.st_size == 0) sb_puts(&out, "# HackPad Archive\n\n");
+    int end = section_subtree_end_index(nb, si);
+    for (int i = si; i <= end; i++) serialize_section(nb, &out, i);
+
+    /* only drop the sections once their copy is safely on disk */
+    int ok = !out.oom && write_all(fd, out.data, out.len) == 0 && fsync(fd) == 0;
+    close(fd);
+    sb_free(&out);
+    if (!ok) return hp_fail(nb, HP_ERR_IO, "Could not write archive file");
+
+    return delete_section_subtree(nb, si);
+}
+
+/* Write the entries of section si that the view shows (filter and folds
+   applied) to path as a markdown list */
+int export_section(HackPad *nb, int si, const char *path) {
+    if (si < 0 || si >= nb->section_count) return hp_fail(nb, HP_ERR_NOTFOUND, "No such section");
+    VisCache *vc = visible_entries(nb, nb->sections[si].id);
+    if (!vc) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+
+    FILE *f = fopen(path, "w");
+    if (!f) return hp_fail(nb, HP_ERR_IO, "Could not create export file: %s", strerror(errno));
+
+    fprintf(f, "# %s\n\n", nb->sections[si].name);
+
+    int *vis = vc->idx;
+    int vis_count = vc->count;
+
+    for (int i = 0; i < vis_count; i++) {
+        Entry *e = &nb->entries[vis[i]];
+        EntryHot h = entry_hot(nb, vis[i]);
+        int indent = h.depth * 2;
+        for (int sp = 0; sp < indent; sp++) fputc(' ', f);
+        fprintf(f, "- %s %s", h.completed ? "[x]" : "[ ]", e->text);
+
+        if (e->tag_count > 0) {
+            fprintf(f, " (");
+            for (int t = 0; t < e->tag_count; t++) {
+                fprintf(f, "#%s", tag_name(nb, e->tags[t]));
+                if (t < e->tag_count - 1) fprintf(f, " ");
+            }
+            fprintf(f, ")");
+        }
+        if (h.priority != PRIORITY_NONE) fprintf(f, " [%s]", priority_str(h.priority));
+        if (h.color != HP_COLOR_NONE) fprintf(f, " [%s]", color_str(h.color));
+        if (h.pinned) fprintf(f, " [PIN]");
+        fprintf(f, "\n");
+    }
+
+    if (fclose(f) != 0) return hp_fail(nb, HP_ERR_IO, "Could not write export file: %s", strerror(errno));
+    return HP_OK;
+}
+
+/* Select entry ei, unfolding whatever hides it and dropping a filter that excludes it */
+void jump_to_entry(HackPad *nb, int ei) {
+    autosave_detach(nb);
+    Entry *e = &nb->entries[ei];
+    int si = find_section_index_by_id(nb, e->section_id);
+    if (si < 0) return;
+
+    /* the section itself and its ancestors */
+    for (int i = si, depth = nb->sections[si].depth + 1; i >= 0 && depth > 0; i--) {
+        if (nb->sections[i].depth >= depth) continue;
+        depth = nb->sections[i].depth;
+        if (nb->sections[i].collapsed) {
+            undo_note_section(nb, i);
+            nb->sections[i].collapsed = 0;
+            mark_modified(nb);
+            journal_section(nb, '=', i);
+        }
+    }
+
+    /* parent entries */
+    Section *s = &nb->sections[si];
+    for (int i = nb->entry_prev[ei], depth = nb->cols.depth[ei]; i >= 0 && depth > 0; i = nb->entry_prev[i]) {
+        if (nb->cols.depth[i] >= depth) continue;
+        depth = nb->cols.depth[i];
+        if (entry_flag(nb, i, EF_COLLAPSED)) {
+            undo_note_entry(nb, i);
+            entry_set_flag(nb, i, EF_COLLAPSED, 0);
+            mark_modified(nb);
+            journal_entry(nb, '=', i, 0);
+        }
+    }
+
+    if (!entry_matches_filter(nb, ei)) set_filter(nb, "");
+    invalidate_views(nb);
+
+    nb->current_section_id = s->id;
+    nb->selected_entry_id = e->id;
+    nb->focus = FOCUS_ENTRIES;
+}
+
+/* ---------------- Merge ---------------- */
+
+/* Fold another notebook into this one by content. Sections match by their
+   name path. Entries match by a hash of their normalized text (blank runs
+   collapsed, ASCII case folded) chained through their parent entries and
+   section path, so "80/tcp" under one host never matches the same line
+   under another. Equal keys match as a multiset: the k-th copy of a line
+   takes the k-th. A matched entry takes the other side's text, tags and
+   attributes when those were modified later; an unmatched one is inserted
+   under its matched parent with its own timestamps. One pass over each
+   notebook plus a hash lookup per entry. */
+
+#define MERGE_BASIS 14695981039346656037ull
+#define MERGE_PRIME 1099511628211ull
+
+typedef struct {
+    uint64_t key;
+    int val;                /* -1: empty */
+} MergeSlot;
+
+typedef struct {
+    MergeSlot *slots;
+    int mask;
+} MergeMap;
+
+static int merge_map_init(MergeMap *m, int n) {
+    int cap = 16;
+    while (cap < n * 2) cap *= 2;
+    m->slots = (MergeSlot*)malloc((size_t)cap * sizeof(MergeSlot));
+    if (!m->slots) return 0;
+    for (int i = 0; i < cap; i++) m->slots[i].val = -1;
+    m->mask = cap - 1;
+    return 1;
+}
+
+/* Duplicate keys are kept; lookups walk the probe run from merge_map_first */
+static void merge_map_put(MergeMap *m, uint64_t key, int val) {
+    int k = (int)(key & (uint64_t)m->mask);
+    while (m->slots[k].val >= 0) k = (k + 1) & m->mask;
+    m->slots[k].key = key;
+    m->slots[k].val = val;
+}
+
+static int merge_map_first(const MergeMap *m, uint64_t key) { return (int)(key & (uint64_t)m->mask); }
+
+/* FNV-1a over s as norm_equal sees it, continuing from the parent's key */
+static uint64_t merge_key(uint64_t parent, const char *s) {
+    uint64_t h = (parent ^ 0x1f) * MERGE_PRIME;   /* level separator */
+    int gap = 0;
+    while (isspace((unsigned char)*s)) s++;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (isspace(c)) { gap = 1; continue; }
+        if (gap) { h = (h ^ ' ') * MERGE_PRIME; gap = 0; }
+        h = (h ^ (unsigned char)tolower(c)) * MERGE_PRIME;
+    }
+    return h;
+}
+
+static int norm_equal(const char *a, const char *b) {
+    while (isspace((unsigned char)*a)) a++;
+    while (isspace((unsigned char)*b)) b++;
+    for (;;) {
+        int ga = 0, gb = 0;
+        while (isspace((unsigned char)*a)) { a++; ga = 1; }
+        while (isspace((unsigned char)*b)) { b++; gb = 1; }
+        if (!*a || !*b) return !*a && !*b;
+        if (ga != gb || tolower((unsigned char)*a) != tolower((unsigned char)*b)) return 0;
+        a++;
+        b++;
+    }
+}
+
+/* keys[si]: the name path of every section; parents come first */
+static void merge_section_keys(HackPad *nb, uint64_t *keys) {
+    for (int si = 0; si < nb->section_count; si++) {
+        int pi = find_section_index_by_id(nb, nb->sections[si].parent_id);
+        keys[si] = merge_key(pi >= 0 && pi < si ? keys[pi] : MERGE_BASIS, nb->sections[si].name);
+    }
+}
+
+/* An entry's level in the key chain: a jump deeper than one level counts
+   as one, so the chain never reads a level it has not set */
+static int merge_depth(int depth, int *top) {
+    if (depth > *top + 1) depth = *top + 1;
+    return *top = depth;
+}
+
+static int same_entry_content(HackPad *nb, int ei, HackPad *o, int oi) {
+    const Entry *e = &nb->entries[ei], *oe = &o->entries[oi];
+    if (strcmp(e->text, oe->text) != 0 || e->tag_count != oe->tag_count) return 0;
+    for (int t = 0; t < e->tag_count; t++)
+        if (strcmp(tag_name(nb, e->tags[t]), tag_name(o, oe->tags[t])) != 0) return 0;
+    EntryHot a = entry_hot(nb, ei), b = entry_hot(o, oi);
+    return a.completed == b.completed && a.pinned == b.pinned &&
+           a.priority == b.priority && a.color == b.color;
+}
+
+static int merge_copy_tags(HackPad *nb, Entry *e, HackPad *o, const Entry *oe) {
+    e->tag_count = 0;
+    for (int t = 0; t < oe->tag_count; t++) {
+        const char *name = tag_name(o, oe->tags[t]);
+        int id = intern_tag(nb, name, strlen(name));
+        if (id < 0) return id;
+        e->tags[e->tag_count++] = (uint16_t)id;
+    }
+    return HP_OK;
+}
+
+/* Entry ei takes o's entry oi, keeping its own depth and fold */
+static int merge_update(HackPad *nb, int ei, HackPad *o, int oi) {
+    const Entry *oe = &o->entries[oi];
+    Entry merged = nb->entries[ei];
+    int rc = merge_copy_tags(nb, &merged, o, oe);
+    if (rc != HP_OK) return rc;
+    if (strcmp(merged.text, oe->text) != 0 && !entry_set_text(nb, &merged, oe->text))
+        return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    merged.modified = oe->modified;
+
+    undo_note_entry(nb, ei);
+    Entry *e = &nb->entries[ei];
+    *e = merged;
+
+    EntryHot h = entry_hot(o, oi);
+    h.depth = nb->cols.depth[ei];
+    h.collapsed = entry_flag(nb, ei, EF_COLLAPSED);
+    entry_set_hot(nb, ei, &h);
+    search_update(nb, e);
+    invalidate_views(nb);
+    mark_modified(nb);
+    journal_entry(nb, '=', ei, 0);
+    return HP_OK;
+}
+
+/* A copy of o's entry oi after slot 'after' of section_id; returns its slot */
+static int merge_insert(HackPad *nb, int section_id, int after, int parent_id, int depth, HackPad *o, int oi) {
+    const Entry *oe = &o->entries[oi];
+    if (depth > MAX_DEPTH) return hp_fail(nb, HP_ERR_LIMIT, "Entries nest at most %d levels deep", MAX_DEPTH);
+
+    Entry e;
+    memset(&e, 0, sizeof(e));
+    e.id = nb->next_entry_id++;
+    e.section_id = section_id;
+    e.parent_id = parent_id;
+    if (!entry_set_text(nb, &e, oe->text)) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    int rc = merge_copy_tags(nb, &e, o, oe);
+    if (rc != HP_OK) return rc;
+    e.created = oe->created;
+    e.modified = oe->modified;
+
+    EntryHot h = entry_hot(o, oi);
+    h.depth = depth;
+    if (!insert_entry_at(nb, after, &e, &h)) return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    int slot = find_entry_index_by_id(nb, e.id);
+    journal_entry(nb, '+', slot, 0);
+    return slot;
+}
+
+/* section id in nb for each of o's sections, creating the missing ones */
+static int merge_sections(HackPad *nb, HackPad *o, const uint64_t *okeys, int *sid, MergeStats *st) {
+    uint64_t *keys = (uint64_t*)malloc((size_t)(nb->section_count + 1) * sizeof(uint64_t));
+    MergeMap map = {0};
+    if (!keys || !merge_map_init(&map, nb->section_count)) {
+        free(keys);
+        return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    }
+    merge_section_keys(nb, keys);
+    for (int si = 0; si < nb->section_count; si++) merge_map_put(&map, keys[si], nb->sections[si].id);
+
+    int rc = HP_OK;
+    for (int oi = 0; oi < o->section_count && rc == HP_OK; oi++) {
+        const Section *os = &o->sections[oi];
+        int pi = find_section_index_by_id(o, os->parent_id);
+        int parent = pi >= 0 && pi < oi ? sid[pi] : -1;
+
+        sid[oi] = -1;
+        for (int k = merge_map_first(&map, okeys[oi]); map.slots[k].val >= 0; k = (k + 1) & map.mask) {
+            if (map.slots[k].key != okeys[oi]) continue;
+            const Section *s = &nb->sections[find_section_index_by_id(nb, map.slots[k].val)];
+            if (s->parent_id == parent && norm_equal(s->name, os->name)) {
+                sid[oi] = s->id;
+                break;
+            }
+        }
+        if (sid[oi] >= 0) continue;
+
+        /* new: last child of its parent, or last at the top */
+        Section s;
+        memset(&s, 0, sizeof(s));
+        s.id = nb->next_section_id++;
+        s.parent_id = parent;
+        s.collapsed = os->collapsed;
+        s.color = os->color;
+        memcpy(s.name, os->name, sizeof(s.name));
+        int pos = nb->section_count;
+        int psi = find_section_index_by_id(nb, parent);
+        if (psi >= 0) {
+            s.depth = nb->sections[psi].depth + 1;
+            pos = section_subtree_end_index(nb, psi) + 1;
+        } else {
+            s.parent_id = -1;
+        }
+        if (!insert_section_at(nb, pos, &s)) {
+            rc = hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+            break;
+        }
+        journal_section(nb, '+', find_section_index_by_id(nb, s.id));
+        sid[oi] = s.id;
+        st->sections_added++;
+    }
+    free(map.slots);
+    free(keys);
+    return rc;
+}
+
+static int merge_entries(HackPad *nb, HackPad *o, const uint64_t *okeys, const int *sid, MergeStats *st) {
+    uint64_t *skeys = (uint64_t*)malloc((size_t)(nb->section_count + 1) * sizeof(uint64_t));
+    uint8_t *used = (uint8_t*)calloc((size_t)nb->entry_slots + 1, 1);
+    MergeMap map = {0};
+    if (!skeys || !used || !merge_map_init(&map, nb->entry_count)) {
+        free(skeys);
+        free(used);
+        return hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    }
+
+    /* this notebook's entries as they were before the merge */
+    uint64_t key[MAX_DEPTH + 1];
+    merge_section_keys(nb, skeys);
+    for (int si = 0; si < nb->section_count; si++) {
+        int top = -1;
+        for (int ei = nb->sections[si].first_entry; ei >= 0; ei = nb->entry_next[ei]) {
+            int d = merge_depth(nb->cols.depth[ei], &top);
+            key[d] = merge_key(d > 0 ? key[d - 1] : skeys[si], nb->entries[ei].text);
+            merge_map_put(&map, key[d], ei);
+        }
+    }
+
+    /* slot[d]: where o's current depth-d ancestor landed; end[d]: last slot
+       of its subtree in nb, -1 until needed */
+    int slot[MAX_DEPTH + 1], end[MAX_DEPTH + 1];
+    int rc = HP_OK;
+    for (int osi = 0; osi < o->section_count && rc == HP_OK; osi++) {
+        int si = find_section_index_by_id(nb, sid[osi]), top = -1;
+        for (int oi = o->sections[osi].first_entry; oi >= 0 && rc == HP_OK; oi = o->entry_next[oi]) {
+            const Entry *oe = &o->entries[oi];
+            int d = merge_depth(o->cols.depth[oi], &top);
+            int parent = d > 0 ? slot[d - 1] : -1;
+            int parent_id = parent >= 0 ? nb->entries[parent].id : -1;
+            key[d] = merge_key(d > 0 ? key[d - 1] : okeys[osi], oe->text);
+
+            int ei = -1;
+            for (int k = merge_map_first(&map, key[d]); map.slots[k].val >= 0; k = (k + 1) & map.mask) {
+                int c = map.slots[k].val;
+                if (map.slots[k].key == key[d] && !used[c] && nb->entries[c].section_id == sid[osi] &&
+                    nb->entries[c].parent_id == parent_id && norm_equal(nb->entries[c].text, oe->text)) {
+                    ei = c;
+                    break;
+                }
+            }
+
+            if (ei >= 0) {
+                used[ei] = 1;
+                if (oe->modified > nb->entries[ei].modified && !same_entry_content(nb, ei, o, oi)) {
+                    rc = merge_update(nb, ei, o, oi);
+                    st->entries_updated++;
+                } else {
+                    st->entries_kept++;
+                }
+                slot[d] = ei;
+                end[d] = -1;
+                continue;
+            }
+
+            int after;
+            if (parent >= 0) {
+                if (end[d - 1] < 0) end[d - 1] = entry_subtree_end_index_in_section(nb, parent);
+                after = end[d - 1];
+            } else {
+                after = nb->sections[si].last_entry;
+            }
+            ei = merge_insert(nb, sid[osi], after, parent_id,
+                              parent >= 0 ? nb->cols.depth[parent] + 1 : 0, o, oi);
+            if (ei < 0) {
+                rc = ei;
+                break;
+            }
+            for (int a = 0; a < d; a++)
+                if (end[a] == after) end[a] = ei;
+            slot[d] = ei;
+            end[d] = ei;
+            st->entries_added++;
+        }
+    }
+    free(map.slots);
+    free(used);
+    free(skeys);
+    return rc;
+}
+
+/* Merge the notebook in file (and its journal) into nb. Changes go through
+   the journal and the undo record like any edit. stats may be NULL. */
+int merge_hackpad(HackPad *nb, const char *file, MergeStats *stats) {
+    autosave_detach(nb);
+    MergeStats st = {0};
+    HackPad o;
+    memset(&o, 0, sizeof(o));
+    o.next_section_id = 1;
+    o.next_entry_id = 1;
+    o.journal_fd = -1;
+
+    int rc = load_hackpad(&o, file);
+    if (rc != HP_OK) {
+        rc = hp_fail(nb, rc, "%s", o.error);
+        free_hackpad(&o);
+        return rc;
+    }
+    long replayed = journal_replay(&o, file);
+    if (replayed < 0) {
+        rc = hp_fail(nb, (int)replayed, "%s", o.error);
+        free_hackpad(&o);
+        return rc;
+    }
+
+    uint64_t *okeys = (uint64_t*)malloc((size_t)(o.section_count + 1) * sizeof(uint64_t));
+    int *sid = (int*)malloc((size_t)(o.section_count + 1) * sizeof(int));
+    if (!okeys || !sid) {
+        rc = hp_fail(nb, HP_ERR_NOMEM, "Out of memory");
+    } else {
+        merge_section_keys(&o, okeys);
+        rc = merge_sections(nb, &o, okeys, sid, &st);
+        if (rc == HP_OK) rc = merge_entries(nb, &o, okeys, sid, &st);
+    }
+    free(okeys);
+    free(sid);
+    free_hackpad(&o);
+    if (stats) *stats = st;
+    return rc;
+}
+
+/* ---------------- Open / close ---------------- */
+
+/* Set nb up on file: load it, replay its journal and attach a new one. A
+   notebook that was never written gets the default sections. A missing file
+   is not an error. If the file or its journal cannot be read or held whole
+   the code says why, no journal is attached and nb must not be saved over
+   the file. */
+int open_hackpad(HackPad *nb, const char *file) {
+    memset(nb, 0, sizeof(*nb));
+    nb->focus = FOCUS_SECTIONS;
+    nb->created_time = time(NULL);
+    nb->next_section_id = 1;
+    nb->next_entry_id = 1;
+    nb->journal_fd = -1;
+    strncpy(nb->filename, file, sizeof(nb->filename) - 1);
+    new_file_mode(nb);
+
+    int rc = load_hackpad(nb, file);
+    if (rc == HP_ERR_NOTFOUND) {
+        rc = HP_OK;
+        nb->error[0] = '\0';
+    }
+
+    /* a file written with a Journal: line may have been emptied on purpose */
+    if (nb->section_count == 0 && !nb->journal_header) {
+        const char *defaults[] = {"Hosts", "IPs", "Credentials", "Exploits", "Vulnerabilities", "Notes"};
+        for (int i = 0; i < 5; i++) {
+            Section *s = append_section(nb);
+            if (!s) break;
+            s->id = nb->next_section_id++;
+            s->parent_id = -1;
+            s->depth = 0;
+            s->collapsed = 0;
+            s->color = HP_COLOR_NONE;
+            strncpy(s->name, defaults[i], MAX_NAME - 1);
+        }
+        reindex_sections(nb, 0);
+    }
+
+    /* the journal only makes sense on top of the whole file; on an error
+       both are left as they are for the caller to refuse the notebook */
+    if (rc == HP_OK) {
+        long keep = journal_replay(nb, file);
+        if (keep < 0) rc = (int)keep;
+        else journal_attach(nb, file, keep);
+    }
+
+    nb->current_section_id = nb->section_count > 0 ? nb->sections[0].id : -1;
+    nb->selected_entry_id = -1;
+    return rc;
+}
+
+/* Save under a new name, which becomes the notebook's file. The old file
+   keeps its own journal; a clean one starts here. */
+int save_hackpad_as(HackPad *nb, const char *file) {
+    int rc = save_hackpad(nb, file);
+    if (rc != HP_OK) return rc;
+    strncpy(nb->filename, file, sizeof(nb->filename) - 1);
+    nb->filename[sizeof(nb->filename) - 1] = '\0';
+    journal_attach(nb, nb->filename, 0);
+    journal_reset(nb, nb->filename);
+    return HP_OK;
+}
+
+/* Stop the background writer, close the journal and free everything.
+   Unsaved changes are not written; see save_hackpad. */
+void close_hackpad(HackPad *nb) {
+    autosave_stop(nb);
+    journal_close(nb);
+    undo_free(nb);
+    free_hackpad(nb);
+}
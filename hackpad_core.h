@@ -0,0 +1,435 @@
+/*  HackPad core API - the notebook without the terminal
+    Copyright (C) 2025  <Kasem Shibli> <kasem545@proton.me>
+
+    The ncurses frontend (hackpad.c), the benchmarks and batch tools all
+    drive the notebook through these calls; see hackpad_core.c.
+
+      gcc hackpad.c hackpad_batch.c hackpad_scan.c hackpad_core.c -lncurses -lpthread -o HackPad
+      gcc tool.c hackpad_core.c -lpthread
+
+    A HackPad is single-threaded: only autosave's own worker runs next to
+    the caller, on a private snapshot.
+*/
+
+#ifndef HACKPAD_CORE_H
+#define HACKPAD_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* ---------------- Limits ---------------- */
+
+#define MAX_TEXT      1024      /* line editor buffer, not a storage limit */
+#define MAX_NAME      128
+#define MAX_TAGS      8
+#define MAX_TAG_LEN   128       /* tag expression of a filter */
+#define MAX_FILTER_LEN 256      /* filter line input only */
+#define MAX_DEPTH     200       /* entry nesting */
+
+/* ---------------- Status codes ---------------- */
+
+/* Calls that can fail return HP_OK or one of these. They are negative, so
+   calls that hand back an id or a count use the same return value; the
+   details are in HackPad.error (see hp_strerror for the bare code). */
+enum {
+    HP_OK           =  0,
+    HP_ERR_NOMEM    = -1,
+    HP_ERR_IO       = -2,       /* file or journal; the message names the cause */
+    HP_ERR_SYNTAX   = -3,       /* filter or tag expression */
+    HP_ERR_NOTFOUND = -4,       /* no such file, section or entry */
+    HP_ERR_LIMIT    = -5,       /* nesting too deep */
+    HP_ERR_NOOP     = -6,       /* nothing to do: no undo history, nothing to redo */
+    HP_ERR_STATE    = -7        /* undo history no longer matches the notebook */
+};
+
+/* ---------------- Types ---------------- */
+
+typedef enum {
+    PRIORITY_NONE,
+    PRIORITY_LOW,
+    PRIORITY_MEDIUM,
+    PRIORITY_HIGH,
+    PRIORITY_CRITICAL
+} Priority;
+
+/* IMPORTANT: Do NOT name these COLOR_* (ncurses macros will explode your build). */
+typedef enum {
+    HP_COLOR_NONE = 0,
+    HP_COLOR_RED,
+    HP_COLOR_GREEN,
+    HP_COLOR_YELLOW,
+    HP_COLOR_ORANGE,   /* simulated via YELLOW+BOLD */
+    HP_COLOR_MAGENTA,
+    HP_COLOR_CYAN,
+    HP_COLOR_WHITE
+} UiColor;
+
+typedef enum {
+    FOCUS_SECTIONS,
+    FOCUS_ENTRIES
+} Focus;
+
+typedef struct {
+    int id;
+    int parent_id;
+    int depth;
+    int collapsed;
+    UiColor color;
+    char name[MAX_NAME];
+
+    /* this section's entry slots in depth-first order, linked through
+       HackPad.entry_next/entry_prev; -1 when empty */
+    int first_entry;
+    int last_entry;
+    int entry_count;
+    int pos_slot;               /* a slot whose list position is known + 1, 0 if none */
+    int pos;                    /* that position (see entry_at/entry_position) */
+} Section;
+
+/* The cold part of an entry. Depth, fold, done, pin, priority and color are
+   kept apart in HackPad.cols (see EntryCols). */
+typedef struct {
+    int id;
+    int section_id;
+    int parent_id;
+
+    const char *text;           /* NUL-terminated, owned by HackPad.strings */
+    int text_len;
+    uint16_t tags[MAX_TAGS];    /* ids into HackPad.tags */
+    int tag_count;
+    time_t created;
+    time_t modified;
+} Entry;
+
+/* An entry's hot attributes as one value, for building, drawing and saving
+   entries (see entry_hot/entry_set_hot) */
+typedef struct {
+    int depth;
+    int collapsed;
+    int completed;
+    int pinned;
+    Priority priority;
+    UiColor color;
+} EntryHot;
+
+enum { EF_COLLAPSED = 1 << 0, EF_COMPLETED = 1 << 1, EF_PINNED = 1 << 2 };
+
+/* Hot attributes stored column-wise, one byte per entry slot, at the same index
+   as HackPad.entries. Filter and fold scans read only these. */
+typedef struct {
+    uint8_t *depth;
+    uint8_t *flags;             /* EF_* */
+    uint8_t *priority;          /* Priority */
+    uint8_t *color;             /* UiColor */
+} EntryCols;
+
+/* Append-only string storage. Chunks never move, so interned pointers stay
+   valid until the arena is freed; replaced texts are simply left behind. */
+typedef struct {
+    char *base;
+    size_t used;
+    size_t cap;
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk *chunks;
+    int count;
+    int cap;
+} StrArena;
+
+/* Deduplicated tag strings: names[id], open-addressed hash of ids in slots.
+   fold[id] is the first id spelled the same up to ASCII case; filters and the
+   tag browser work on those classes, display and save keep each spelling. */
+typedef struct {
+    const char **names;
+    uint16_t *fold;
+    int count;
+    int cap;
+    int *slots;
+    int *fold_slots;        /* hash of the ids with fold[id] == id, by folded name */
+    int slot_cap;
+} TagDict;
+
+/* Compiled tag filter (see tagq_compile): postfix code over up to
+   TAGQ_MAX_TERMS terms, each term one case-folded tag class */
+#define TAGQ_MAX_TERMS  16
+#define TAGQ_MAX_CODE   64
+
+enum { TAGQ_AND = 0xfd, TAGQ_OR = 0xfe, TAGQ_NOT = 0xff };  /* below: term number */
+
+typedef struct {
+    uint8_t code[TAGQ_MAX_CODE];
+    int len;                        /* 0: match any tagged entry */
+    int nterms;
+    int term_class[TAGQ_MAX_TERMS]; /* fold class, -1 while no such tag exists */
+    int term_off[TAGQ_MAX_TERMS];   /* term text, in text[] */
+    int term_len[TAGQ_MAX_TERMS];
+    int tags_seen;                  /* tags.count when the classes were resolved */
+    char text[MAX_TAG_LEN];
+} TagQuery;
+
+/* Compiled view filter (see viewq_compile): every predicate in 'preds' must hold */
+enum {
+    VQ_TAGS     = 1 << 0,
+    VQ_PRIORITY = 1 << 1,
+    VQ_DONE     = 1 << 2,
+    VQ_OPEN     = 1 << 3,
+    VQ_PINNED   = 1 << 4,
+    VQ_UNPINNED = 1 << 5,
+    VQ_TAGGED   = 1 << 6,
+    VQ_UNTAGGED = 1 << 7,
+    VQ_COLOR    = 1 << 8,
+    VQ_MODIFIED = 1 << 9,
+    VQ_TEXT     = 1 << 10,
+
+    /* need the Entry row; the rest are answered from the columns */
+    VQ_ROW      = VQ_TAGS | VQ_TAGGED | VQ_UNTAGGED | VQ_MODIFIED | VQ_TEXT
+};
+
+typedef struct {
+    unsigned preds;
+    TagQuery tags;
+    unsigned prio_mask;         /* bit per Priority value allowed */
+    unsigned color_mask;        /* bit per UiColor value allowed */
+    time_t mod_from, mod_to;    /* modified in [from, to) */
+    char mod_spec[32];          /* as written, relative windows are re-anchored on compile */
+    char text[MAX_NAME];        /* substring, ignoring ASCII case */
+    int text_len;
+
+    /* allow-masks for the column test, by value (see viewq_masks) */
+    unsigned prio_ok;
+    unsigned color_ok;
+    unsigned flags_ok;          /* by EF_* combination */
+} ViewQuery;
+
+/* Full-text search: lowercased token -> postings of the entries holding it */
+typedef struct {
+    int32_t id;             /* entry id */
+    uint16_t ver;           /* SearchDoc.ver when indexed; older ones are stale */
+    uint16_t weight;        /* occurrences, a tag counts double */
+} Posting;
+
+typedef struct {
+    Posting *p;
+    int count;
+    int cap;
+} PostingList;
+
+typedef struct {
+    uint16_t ver;
+    uint16_t nterms;        /* postings the entry's current version owns */
+} SearchDoc;
+
+typedef struct {
+    int built;
+    int oom;
+    const char **terms;     /* term id -> token */
+    PostingList *lists;     /* term id -> postings */
+    int count;
+    int cap;
+    int *slots;             /* open-addressed hash of term ids */
+    int slot_cap;
+    StrArena strings;
+    SearchDoc *docs;        /* by entry id */
+    int doc_cap;
+    long live;
+    long stale;             /* left behind by edits/deletes, skipped by queries */
+} SearchIndex;
+
+typedef struct {
+    int idx;                /* entry index */
+    long score;
+    time_t modified;
+} SearchHit;
+
+/* What import_scan did */
+typedef struct {
+    int hosts_added;
+    int hosts_merged;           /* already in the section, matched by IP */
+    int ports_added;
+    int ports_updated;
+} ScanStats;
+
+/* What merge_hackpad did */
+typedef struct {
+    int sections_added;
+    int entries_added;
+    int entries_updated;        /* the other side was modified later */
+    int entries_kept;
+} MergeStats;
+
+/* Visible (filtered + folded) index list, rebuilt only when stale */
+typedef struct {
+    int *idx;
+    int count;
+    int cap;
+    int built;
+    int key;                /* section id for the entries list */
+    unsigned long gen;      /* HackPad.view_gen at build time */
+    int hint;               /* last looked-up position, tried first */
+} VisCache;
+
+struct Autosave;
+struct Undo;
+struct Frontend;
+
+typedef struct {
+    /* heap-backed, grown on demand (see reserve_sections/reserve_entries) */
+    Section *sections;
+    int section_count;
+    int section_cap;
+
+    /* entries[] and cols are a pool of slots that stay put once handed out
+       (see alloc_entry_slot) until compact_entries repacks a sparse pool.
+       Order lives in the per-section lists; free slots have id -1 and are
+       chained through entry_next. */
+    Entry *entries;
+    EntryCols cols;
+    int *entry_next;
+    int *entry_prev;
+    int entry_slots;        /* slots handed out so far, live or free */
+    int entry_free;         /* first free slot + 1, 0 if none */
+    int entry_count;        /* live entries */
+    int entry_cap;
+
+    StrArena strings;
+    TagDict tags;
+    SearchIndex search;     /* built on the first search */
+
+    /* id -> array index, -1 when the id is gone (see reindex_*) */
+    int *section_index_by_id;
+    int section_index_cap;
+    int *entry_index_by_id;
+    int entry_index_cap;
+
+    /* bumped by invalidate_views() on any change to order, fold or filter */
+    unsigned long view_gen;
+    VisCache vis_sections;
+    VisCache vis_entries;
+
+    /* bumped by mark_modified() on every content change; saved_gen is the
+       data_gen most recently written to disk */
+    unsigned long data_gen;
+    unsigned long saved_gen;
+    struct Autosave *autosave;      /* NULL: no background saves (see autosave_start) */
+    struct Undo *undo;              /* NULL: no undo history (see undo_start) */
+
+    /* write-ahead journal next to the markdown (see journal_*). Records are
+       numbered; the markdown's "Journal:" header says which are already in it. */
+    int journal_fd;                 /* -1 until the first record is written */
+    int journal_failed;             /* stop journaling after a write error or journal_suspend */
+    long journal_keep;              /* bytes of the old journal to keep on first open */
+    unsigned long journal_seq;      /* number of the next record */
+    int journal_header;             /* loaded file carried a "Journal:" line */
+    char journal_md[256];           /* markdown file the journal belongs to */
+
+    /* .hpb snapshot the notebook was loaded from; entry texts may point into it */
+    const char *hpb_map;
+    size_t hpb_len;
+
+    /* selection; undo and jump_to_entry move it too */
+    int current_section_id;
+    int selected_entry_id;
+
+    Focus focus;
+
+    char filename[256];
+    time_t created_time;
+    unsigned new_file_mode;         /* 0666 less the umask for files save creates; 0 until read */
+
+    char filter_text[MAX_FILTER_LEN];  /* as shown/edited; compiled into 'filter' */
+    ViewQuery filter;
+
+    int next_section_id;
+    int next_entry_id;
+
+    /* why the last call failed, or what went wrong in the background
+       (autosave, journal); the frontend shows it and clears it */
+    char error[320];
+
+    struct Frontend *ui;            /* the frontend's own state, opaque here */
+} HackPad;
+
+/* ---------------- API ---------------- */
+
+const char *hp_strerror(int code);
+
+/* Open / save / close. open_hackpad loads file and replays its journal;
+   every change after that is journaled until close_hackpad. */
+int open_hackpad(HackPad *nb, const char *file);
+int load_hackpad(HackPad *nb, const char *file);
+int save_hackpad(HackPad *nb, const char *file);
+int save_hackpad_as(HackPad *nb, const char *file);
+void close_hackpad(HackPad *nb);
+void free_hackpad(HackPad *nb);
+int journal_active(HackPad *nb);
+void journal_suspend(HackPad *nb);
+
+/* Background saving: autosave_tick queues a save once the interval has
+   passed (call it from the input loop); autosave_wait drains it */
+void autosave_start(HackPad *nb);
+void autosave_tick(HackPad *nb);
+void autosave_wait(HackPad *nb);
+void autosave_stop(HackPad *nb);
+
+/* Undo: every change since the last undo_commit forms one step */
+void undo_start(HackPad *nb);
+void undo_commit(HackPad *nb);
+int undo_step(HackPad *nb, int redo);
+void undo_free(HackPad *nb);
+
+/* Lookups. Sections are addressed by array index (si), entries by slot (ei). */
+int find_section_index_by_id(HackPad *nb, int id);
+int find_entry_index_by_id(HackPad *nb, int id);
+int entry_live(const HackPad *nb, int slot);
+int entry_at(const HackPad *nb, Section *s, int n);
+EntryHot entry_hot(const HackPad *nb, int i);
+int entry_flag(const HackPad *nb, int i, int flag);
+const char *tag_name(HackPad *nb, int id);
+const char *priority_str(Priority p);
+const char *color_str(UiColor c);
+int section_subtree_end_index(HackPad *nb, int sec_index);
+int entry_subtree_end_index_in_section(HackPad *nb, int entry_index);
+
+/* Filters and the visible lists they produce */
+int tagq_compile(HackPad *nb, TagQuery *out, const char *expr, const char **err);
+int viewq_compile(HackPad *nb, ViewQuery *out, const char *src, const char **err);
+void viewq_format(const ViewQuery *q, char *buf, size_t size);
+int viewq_match(HackPad *nb, ViewQuery *q, int i);
+int set_filter_text(ViewQuery *q, const char *t, size_t len);
+int set_filter(HackPad *nb, const char *src);
+int entry_matches_filter(HackPad *nb, int i);
+int build_visible_sections(HackPad *nb, int *out_idx, int max_out);
+int build_visible_entries(HackPad *nb, int section_id, int *out_idx, int max_out);
+VisCache *visible_sections(HackPad *nb);
+VisCache *visible_entries(HackPad *nb, int section_id);
+int vis_section_pos(HackPad *nb, VisCache *c, int id);
+int vis_entry_pos(HackPad *nb, VisCache *c, int id);
+
+/* Search: hits in *out (caller frees), count returned, -1 on OOM */
+int search_query(HackPad *nb, const char *query, SearchHit **out);
+int search_scan(HackPad *nb, const char *query, SearchHit **out);
+int cmp_search_hit(const void *a, const void *b);
+
+/* Edits: journaled, undoable, checked (see "Edits" in hackpad_core.c) */
+int create_section(HackPad *nb, int pos, int parent_id, int depth, const char *name);
+int create_entry(HackPad *nb, int section_id, int after, int parent_id, int depth, const char *text);
+int update_entry_text(HackPad *nb, int ei, const char *text);
+int update_entry_tags(HackPad *nb, int ei, const char *tags);
+int update_entry_attrs(HackPad *nb, int ei, const EntryHot *h);
+int update_section_attrs(HackPad *nb, int si, int collapsed, UiColor color);
+int delete_section_subtree(HackPad *nb, int si);
+int delete_entry_subtree(HackPad *nb, int ei);
+int remove_entries_where(HackPad *nb, int si, int last_si, ViewQuery *q);
+int archive_section(HackPad *nb, int si, const char *path);
+int export_section(HackPad *nb, int si, const char *path);
+void jump_to_entry(HackPad *nb, int ei);
+int merge_hackpad(HackPad *nb, const char *file, MergeStats *stats);
+
+/* Scan import (hackpad_scan.c): nmap/masscan XML, masscan JSON or grepable
+   output read from in as a stream; hosts merge by IP into section_id */
+int import_scan(HackPad *nb, int section_id, FILE *in, ScanStats *stats);
+
+#endif /* HACKPAD_CORE_H */
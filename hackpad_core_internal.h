@@ -0,0 +1,56 @@
+/*  HackPad core internals - what bench/ and tests/ reach below the API
+    Copyright (C) 2025  <Kasem Shibli> <kasem545@proton.me>
+
+    Not for frontends: these build and save notebooks without journaling,
+    undo or any of the checks the calls in hackpad_core.h make. They link
+    against hackpad_core.o like everything else (see the Makefile).
+*/
+
+#ifndef HACKPAD_CORE_INTERNAL_H
+#define HACKPAD_CORE_INTERNAL_H
+
+#include "hackpad_core.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+  #define HACKPAD_X86_SIMD 1
+#endif
+
+/* Growable output buffer; oom sticks so callers check once at the end */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int oom;
+} StrBuf;
+
+void sb_free(StrBuf *b);
+
+/* Case-insensitive substring matchers; all take 1 <= nlen <= hlen */
+typedef const char *(*MemcasememFn)(const char *h, size_t hlen, const char *n, size_t nlen);
+
+const char *memcasemem_scalar(const char *h, size_t hlen, const char *n, size_t nlen);
+#ifdef HACKPAD_X86_SIMD
+const char *memcasemem_sse2(const char *h, size_t hlen, const char *n, size_t nlen);
+__attribute__((target("avx2")))
+const char *memcasemem_avx2(const char *h, size_t hlen, const char *n, size_t nlen);
+#endif
+
+/* Building a notebook in place: ids, parents and the id maps are the
+   caller's (reindex_* once done) */
+Section *append_section(HackPad *nb);
+Entry *append_entry(HackPad *nb, Section *s, const EntryHot *h);
+int entry_set_text(HackPad *nb, Entry *e, const char *txt);
+int intern_tag(HackPad *nb, const char *tag, size_t len);
+void reindex_sections(HackPad *nb, int from);
+void reindex_entries(HackPad *nb, int from);
+
+/* The edits' cores, without the checks */
+int insert_entry_at(HackPad *nb, int after, Entry *e, const EntryHot *h);
+void remove_section_subtree(HackPad *nb, int si);
+void journal_section(HackPad *nb, char op, int si);
+
+/* Save: the markdown text, and the .hpb snapshot next to a saved file */
+void serialize_hackpad(HackPad *nb, StrBuf *out);
+void write_hpb(HackPad *nb, const char *file);
+
+#endif /* HACKPAD_CORE_INTERNAL_H */
@@ -0,0 +1,976 @@
+/*  HackPad scan import - nmap and masscan results into a Hosts section
+    Copyright (C) 2025  <Kasem Shibli> <kasem545@proton.me>
+
+    import_scan() reads one scan file front to back and never holds more
+    than the tag or record it is on plus the host being filled in:
+
+      nmap -oX, masscan -oX     XML, read tag by tag
+      masscan -oJ, -oD          a JSON array of records, or one per line
+      nmap -oG, masscan -oG     grepable, read line by line
+
+    The format is told by the first byte. Every host that is up becomes an
+    entry in the host template's shape ("IP: | Hostname: | OS: | Ports: ")
+    with one sub-entry per open port ("445/tcp microsoft-ds Samba 4.6"),
+    tagged with the scanner and well-known services (#smb, #http, #rdp...).
+
+    Hosts merge by IP with the section's existing top-level entries, so
+    re-running a scan, or feeding masscan's one-record-per-port output,
+    fills in one entry per host: new ports are added, an empty Hostname
+    or OS is filled, Ports is recomputed and port lines are only replaced
+    by a longer scan line they start (hand-edited lines are left alone).
+    Entries written some other way keep their text and get ports and tags.
+*/
+
+#define _XOPEN_SOURCE 700
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <strings.h>
+
+#include "hackpad_core.h"
+
+#define SCAN_FIELD      256             /* hostname, OS and a port's detail */
+#define SCAN_MAX_TAG    (1 << 20)       /* longer XML tags (huge script output) are skipped */
+#define SCAN_MAX_ATTRS  32
+
+typedef struct {
+    int port;
+    char proto[8];
+    char service[64];               /* "ssl/http" for a tunnel, like nmap prints it */
+    char detail[SCAN_FIELD];        /* product version extrainfo, or a banner line */
+} ScanPort;
+
+typedef struct {
+    char ip[48];
+    char hostname[SCAN_FIELD];
+    char os[SCAN_FIELD];
+    int down;
+    ScanPort *ports;
+    int nports;
+    int cap;
+} ScanHost;
+
+/* IP -> host entry id, open addressing; id -1 marks an empty slot */
+typedef struct {
+    int id;
+    char ip[48];
+} ScanSlot;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int oom;
+} ScanBuf;
+
+typedef struct {
+    HackPad *nb;
+    int section_id;
+    FILE *in;
+    long line;
+    char source[16];                /* scanner, tagged on every host */
+
+    ScanSlot *slots;
+    int slot_cap;
+    int slot_used;
+
+    ScanHost rec;                   /* what the parser is reading now */
+    ScanHost cur;                   /* records of one IP, merged on the next IP */
+    ScanStats *stats;
+
+    ScanBuf tag;                    /* XML: current tag */
+} ScanImport;
+
+/* The scanner's name as a tag: "Nmap" -> "nmap" */
+static void set_source(ScanImport *im, const char *name) {
+    size_t n = 0;
+    for (; *name && n + 1 < sizeof(im->source); name++)
+        if (isalnum((unsigned char)*name)) im->source[n++] = (char)tolower((unsigned char)*name);
+    if (n) im->source[n] = '\0';
+}
+
+static int scan_fail(ScanImport *im, int code, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(im->nb->error, sizeof(im->nb->error), fmt, ap);
+    va_end(ap);
+    return code;
+}
+
+/* ---------------- Helpers ---------------- */
+
+static void sbuf_putn(ScanBuf *b, const char *s, size_t n) {
+    if (b->oom) return;
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 256;
+        while (cap < b->len + n + 1) cap *= 2;
+        char *p = (char*)realloc(b->data, cap);
+        if (!p) { b->oom = 1; return; }
+        b->data = p;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+}
+
+static void sbuf_puts(ScanBuf *b, const char *s) { sbuf_putn(b, s, strlen(s)); }
+
+static void copy_field(char *dst, size_t cap, const char *src) {
+    size_t n = 0;
+    for (; *src && n + 1 < cap; src++) {
+        unsigned char c = (unsigned char)*src;
+        if (c == '\n' || c == '\r') break;              /* banners: first line only */
+        dst[n++] = c < 0x20 || c == 0x7f ? ' ' : (char)c;
+    }
+    while (n > 0 && dst[n - 1] == ' ') n--;
+    dst[n] = '\0';
+}
+
+static uint32_t ip_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) { h ^= (unsigned char)*s; h *= 16777619u; }
+    return h;
+}
+
+static int looks_like_ip(const char *s, size_t n) {
+    int dots = 0, colons = 0, digits = 0;
+    if (n < 2 || n >= sizeof(((ScanSlot*)0)->ip)) return 0;
+    for (size_t i = 0; i < n; i++) {
+        char c = s[i];
+        if (c == '.') dots++;
+        else if (c == ':') colons++;
+        else if (isdigit((unsigned char)c)) digits++;
+        else if (!isxdigit((unsigned char)c)) return 0;
+    }
+    return digits > 0 && (dots == 3 || colons >= 2);
+}
+
+/* The IP an entry is about: "IP: x | ..." as the host template writes it, or
+   a leading address ("10.0.0.5 DC01"). 0 when there is none. */
+static int ip_of_text(const char *text, char *out, size_t cap) {
+    const char *p = text;
+    if (strncmp(p, "IP:", 3) == 0) p += 3;
+    while (*p == ' ') p++;
+    size_t n = strcspn(p, " |,\t");
+    if (!looks_like_ip(p, n) || n >= cap) return 0;
+    memcpy(out, p, n);
+    out[n] = '\0';
+    return 1;
+}
+
+/* "445/tcp..." -> 445 and "tcp"; returns the length of the prefix, 0 if none */
+static int port_prefix(const char *text, int *port, char *proto, size_t cap) {
+    const char *p = text;
+    int v = 0;
+    if (!isdigit((unsigned char)*p)) return 0;
+    while (isdigit((unsigned char)*p) && v <= 65535) v = v * 10 + (*p++ - '0');
+    if (*p != '/' || v > 65535) return 0;
+    const char *q = ++p;
+    while (isalpha((unsigned char)*p)) p++;
+    if (p == q || (size_t)(p - q) >= cap || (*p && *p != ' ' && *p != ',')) return 0;
+    memcpy(proto, q, (size_t)(p - q));
+    proto[p - q] = '\0';
+    *port = v;
+    return (int)(p - text);
+}
+
+/* Tag for a well-known service, by nmap/masscan service name, else by port */
+static const char *service_tag(const char *service, int port) {
+    static const struct { const char *name; const char *tag; } names[] = {
+        {"microsoft-ds", "smb"}, {"netbios-ssn", "smb"}, {"smb", "smb"},
+        {"ms-wbt-server", "rdp"}, {"rdp", "rdp"}, {"ssh", "ssh"}, {"ftp", "ftp"},
+        {"telnet", "telnet"}, {"smtp", "smtp"}, {"submission", "smtp"}, {"smtps", "smtp"},
+        {"domain", "dns"}, {"dns", "dns"}, {"ldap", "ldap"}, {"ldaps", "ldap"},
+        {"kerberos-sec", "kerberos"}, {"kerberos", "kerberos"}, {"ms-sql-s", "mssql"},
+        {"mysql", "mysql"}, {"postgresql", "postgres"}, {"snmp", "snmp"}, {"vnc", "vnc"},
+        {"wsman", "winrm"}, {"wsmans", "winrm"}, {"msrpc", "rpc"}, {"nfs", "nfs"},
+        {"redis", "redis"}, {"mongodb", "mongodb"}, {"imap", "mail"}, {"pop3", "mail"}
+    };
+    static const struct { int port; const char *tag; } ports[] = {
+        {21, "ftp"}, {22, "ssh"}, {23, "telnet"}, {25, "smtp"}, {53, "dns"}, {80, "http"},
+        {88, "kerberos"}, {135, "rpc"}, {139, "smb"}, {389, "ldap"}, {443, "http"},
+        {445, "smb"}, {636, "ldap"}, {1433, "mssql"}, {2049, "nfs"}, {3306, "mysql"},
+        {3389, "rdp"}, {5432, "postgres"}, {5900, "vnc"}, {5985, "winrm"}, {5986, "winrm"},
+        {6379, "redis"}, {8080, "http"}, {8443, "http"}, {27017, "mongodb"}
+    };
+
+    if (*service) {
+        const char *s = strrchr(service, '/');      /* "ssl/http" */
+        s = s ? s + 1 : service;
+        if (strstr(s, "http")) return "http";
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+            if (strcmp(s, names[i].name) == 0) return names[i].tag;
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(ports) / sizeof(ports[0]); i++)
+        if (ports[i].port == port) return ports[i].tag;
+    return NULL;
+}
+
+static void port_line(const ScanPort *p, char *out, size_t cap) {
+    int n = snprintf(out, cap, "%d/%s", p->port, p->proto);
+    if (*p->service && n >= 0 && (size_t)n < cap) n += snprintf(out + n, cap - (size_t)n, " %s", p->service);
+    if (*p->detail && n >= 0 && (size_t)n < cap) snprintf(out + n, cap - (size_t)n, " %s", p->detail);
+}
+
+/* ---------------- Host index ---------------- */
+
+static int map_put(ScanImport *im, const char *ip, int id);
+
+static int map_slot(const ScanImport *im, const char *ip) {
+    int k = (int)(ip_hash(ip) & (uint32_t)(im->slot_cap - 1));
+    while (im->slots[k].id >= 0 && strcmp(im->slots[k].ip, ip) != 0) k = (k + 1) & (im->slot_cap - 1);
+    return k;
+}
+
+static int map_grow(ScanImport *im) {
+    ScanSlot *old = im->slots;
+    int old_cap = im->slot_cap;
+    int cap = old_cap ? old_cap * 2 : 1024;
+    ScanSlot *slots = (ScanSlot*)malloc((size_t)cap * sizeof(ScanSlot));
+    if (!slots) return 0;
+    for (int i = 0; i < cap; i++) slots[i].id = -1;
+    im->slots = slots;
+    im->slot_cap = cap;
+    im->slot_used = 0;
+    for (int i = 0; i < old_cap; i++)
+        if (old[i].id >= 0) map_put(im, old[i].ip, old[i].id);
+    free(old);
+    return 1;
+}
+
+static int map_get(const ScanImport *im, const char *ip) {
+    if (!im->slot_cap) return -1;
+    return im->slots[map_slot(im, ip)].id;
+}
+
+static int map_put(ScanImport *im, const char *ip, int id) {
+    if ((im->slot_used + 1) * 2 > im->slot_cap && !map_grow(im)) return 0;
+    int k = map_slot(im, ip);
+    if (im->slots[k].id < 0) im->slot_used++;
+    im->slots[k].id = id;
+    strcpy(im->slots[k].ip, ip);
+    return 1;
+}
+
+/* Index the section's top-level entries by the IP they are about; the first
+   entry with an IP gets the merges */
+static int map_build(ScanImport *im) {
+    HackPad *nb = im->nb;
+    const Section *s = &nb->sections[find_section_index_by_id(nb, im->section_id)];
+    char ip[48];
+    for (int i = s->first_entry; i >= 0; i = nb->entry_next[i]) {
+        if (entry_hot(nb, i).depth != 0 || !ip_of_text(nb->entries[i].text, ip, sizeof(ip))) continue;
+        if (map_get(im, ip) < 0 && !map_put(im, ip, nb->entries[i].id)) return 0;
+    }
+    return 1;
+}
+
+/* ---------------- Merging ---------------- */
+
+static int host_add_port(ScanHost *h, const ScanPort *p) {
+    if (h->nports == h->cap) {
+        int cap = h->cap ? h->cap * 2 : 16;
+        ScanPort *np = (ScanPort*)realloc(h->ports, (size_t)cap * sizeof(ScanPort));
+        if (!np) return 0;
+        h->ports = np;
+        h->cap = cap;
+    }
+    h->ports[h->nports++] = *p;
+    return 1;
+}
+
+static void host_reset(ScanHost *h) {
+    h->ip[0] = h->hostname[0] = h->os[0] = '\0';
+    h->down = 0;
+    h->nports = 0;
+}
+
+/* Does the space separated list hold word w[0..len), ignoring ASCII case? */
+static int list_has(const char *list, const char *w, size_t len) {
+    for (const char *p = list; *p; ) {
+        size_t n = strcspn(p, " ");
+        if (n == len && strncasecmp(p, w, len) == 0) return 1;
+        p += n;
+        while (*p == ' ') p++;
+    }
+    return 0;
+}
+
+/* Give entry ei the tags of add (space separated) it lacks, after its own */
+static int entry_add_tags(HackPad *nb, int ei, const char *add) {
+    const Entry *e = &nb->entries[ei];
+    char list[MAX_TEXT] = "";
+    size_t n = 0;
+    for (int t = 0; t < e->tag_count; t++)
+        n += (size_t)snprintf(list + n, sizeof(list) - n, "%s%s", n ? " " : "", tag_name(nb, e->tags[t]));
+
+    int count = e->tag_count, changed = 0;
+    for (const char *p = add; *p && count < MAX_TAGS && n < sizeof(list) - 1; ) {
+        size_t len = strcspn(p, " ");
+        if (len && !list_has(list, p, len)) {
+            n += (size_t)snprintf(list + n, sizeof(list) - n, "%s%.*s", n ? " " : "", (int)len, p);
+            count++;
+            changed = 1;
+        }
+        p += len;
+        while (*p == ' ') p++;
+    }
+    return changed ? update_entry_tags(nb, ei, list) : HP_OK;
+}
+
+/* Append token to a ports list unless it is there already */
+static void ports_add(char (*list)[16], int *n, int max, const char *token) {
+    for (int i = 0; i < *n; i++)
+        if (strcmp(list[i], token) == 0) return;
+    if (*n < max) snprintf(list[(*n)++], 16, "%s", token);
+}
+
+static int cmp_port_token(const void *a, const void *b) {
+    int pa = atoi((const char*)a), pb = atoi((const char*)b);
+    if (pa != pb) return pa < pb ? -1 : 1;
+    return strcmp((const char*)a, (const char*)b);
+}
+
+/* Rewrite host line ei from h and the port sub-entries now under it. Only
+   lines in the template's shape are touched; other fields ride along. */
+static int host_update_text(ScanImport *im, int ei, const ScanHost *h) {
+    HackPad *nb = im->nb;
+    const char *text = nb->entries[ei].text;
+    if (strncmp(text, "IP:", 3) != 0) return HP_OK;
+
+    char hostname[SCAN_FIELD] = "", os[SCAN_FIELD] = "";
+    ScanBuf extra = {0};
+    int nports = 0, max = 1024;
+    char (*ports)[16] = (char(*)[16])malloc((size_t)max * 16);
+    if (!ports) return scan_fail(im, HP_ERR_NOMEM, "Out of memory");
+
+    /* fields of the current line */
+    for (const char *p = text; *p; ) {
+        size_t len = strcspn(p, "|");
+        const char *seg = p, *end = p + len;
+        while (seg < end && *seg == ' ') seg++;
+        while (end > seg && end[-1] == ' ') end--;
+        const char *colon = memchr(seg, ':', (size_t)(end - seg));
+        const char *v = colon ? colon + 1 : end;
+        while (v < end && *v == ' ') v++;
+        size_t klen = colon ? (size_t)(colon - seg) : 0, vlen = (size_t)(end - v);
+
+        if (klen == 8 && strncmp(seg, "Hostname", 8) == 0) {
+            snprintf(hostname, sizeof(hostname), "%.*s", (int)vlen, v);
+        } else if (klen == 2 && strncmp(seg, "OS", 2) == 0) {
+            snprintf(os, sizeof(os), "%.*s", (int)vlen, v);
+        } else if (klen == 5 && strncmp(seg, "Ports", 5) == 0) {
+            for (const char *q = v; q < end; ) {
+                size_t tl = strcspn(q, ", ");
+                if (tl > (size_t)(end - q)) tl = (size_t)(end - q);
+                if (tl > 0 && tl < 16) {
+                    char tok[16];
+                    memcpy(tok, q, tl);
+                    tok[tl] = '\0';
+                    ports_add(ports, &nports, max, tok);
+                }
+                q += tl;
+                while (q < end && (*q == ',' || *q == ' ')) q++;
+            }
+        } else if (!(klen == 2 && strncmp(seg, "IP", 2) == 0) && end > seg) {
+            sbuf_puts(&extra, " | ");
+            sbuf_putn(&extra, seg, (size_t)(end - seg));
+        }
+        p += len + (p[len] == '|');
+    }
+    if (!*hostname) copy_field(hostname, sizeof(hostname), h->hostname);
+    if (!*os) copy_field(os, sizeof(os), h->os);
+
+    /* ports from the sub-entries, tcp ones by number alone */
+    const uint8_t *depth = nb->cols.depth;
+    for (int i = nb->entry_next[ei]; i >= 0 && depth[i] > depth[ei]; i = nb->entry_next[i]) {
+        int port;
+        char proto[8], tok[16];
+        if (depth[i] != depth[ei] + 1 || !port_prefix(nb->entries[i].text, &port, proto, sizeof(proto))) continue;
+        if (strcmp(proto, "tcp") == 0) snprintf(tok, sizeof(tok), "%d", port);
+        else snprintf(tok, sizeof(tok), "%d/%s", port, proto);
+        ports_add(ports, &nports, max, tok);
+    }
+    qsort(ports, (size_t)nports, 16, cmp_port_token);
+
+    ScanBuf out = {0};
+    char ip[48] = "";
+    ip_of_text(text, ip, sizeof(ip));
+    sbuf_puts(&out, "IP: ");
+    sbuf_puts(&out, ip);
+    sbuf_puts(&out, *hostname ? " | Hostname: " : " | Hostname:");
+    sbuf_puts(&out, hostname);
+    sbuf_puts(&out, *os ? " | OS: " : " | OS:");
+    sbuf_puts(&out, os);
+    sbuf_puts(&out, nports ? " | Ports: " : " | Ports:");
+    for (int i = 0; i < nports; i++) {
+        if (i) sbuf_puts(&out, ",");
+        sbuf_puts(&out, ports[i]);
+    }
+    if (extra.len) sbuf_putn(&out, extra.data, extra.len);
+    free(ports);
+    free(extra.data);
+
+    int rc = HP_OK;
+    if (out.oom || extra.oom) rc = scan_fail(im, HP_ERR_NOMEM, "Out of memory");
+    else if (strcmp(out.data, text) != 0) rc = update_entry_text(nb, ei, out.data);
+    free(out.data);
+    return rc;
+}
+
+/* Merge the records gathered in cur into the notebook */
+static int scan_flush(ScanImport *im) {
+    HackPad *nb = im->nb;
+    ScanHost *h = &im->cur;
+    int rc = HP_OK;
+    if (!h->ip[0] || (h->down && h->nports == 0)) goto done;
+
+    int sid = im->section_id;
+    int hid = map_get(im, h->ip);
+    int hi = hid >= 0 ? find_entry_index_by_id(nb, hid) : -1;
+    if (hi < 0 || nb->entries[hi].section_id != sid) {
+        char text[sizeof(h->ip) + 48];
+        snprintf(text, sizeof(text), "IP: %s | Hostname: | OS: | Ports:", h->ip);
+        int si = find_section_index_by_id(nb, sid);
+        hid = create_entry(nb, sid, nb->sections[si].last_entry, -1, 0, text);
+        if (hid < 0) { rc = hid; goto done; }
+        if (!map_put(im, h->ip, hid)) { rc = scan_fail(im, HP_ERR_NOMEM, "Out of memory"); goto done; }
+        hi = find_entry_index_by_id(nb, hid);
+        im->stats->hosts_added++;
+    } else {
+        im->stats->hosts_merged++;
+    }
+
+    char tags[MAX_TEXT];
+    size_t tn = (size_t)snprintf(tags, sizeof(tags), "%s", im->source);
+
+    /* creating entries may move the columns: no cached pointers below */
+    int hdepth = nb->cols.depth[hi];
+    int last = entry_subtree_end_index_in_section(nb, hi);
+    for (int k = 0; k < h->nports && rc == HP_OK; k++) {
+        const ScanPort *p = &h->ports[k];
+        char line[SCAN_FIELD + 96];
+        port_line(p, line, sizeof(line));
+        const char *tag = service_tag(p->service, p->port);
+        if (tag && !list_has(tags, tag, strlen(tag)) && tn < sizeof(tags) - 1)
+            tn += (size_t)snprintf(tags + tn, sizeof(tags) - tn, " %s", tag);
+
+        /* the port's line under this host, if there is one */
+        int pi = -1;
+        for (int i = nb->entry_next[hi]; i >= 0 && nb->cols.depth[i] > hdepth && pi < 0; i = nb->entry_next[i]) {
+            int port;
+            char proto[8];
+            if (nb->cols.depth[i] == hdepth + 1 && port_prefix(nb->entries[i].text, &port, proto, sizeof(proto)) &&
+                port == p->port && strcmp(proto, p->proto) == 0)
+                pi = i;
+        }
+
+        if (pi < 0) {
+            int id = create_entry(nb, sid, last, hid, hdepth + 1, line);
+            if (id < 0) { rc = id; break; }
+            pi = last = find_entry_index_by_id(nb, id);
+            im->stats->ports_added++;
+        } else {
+            const char *old = nb->entries[pi].text;
+            size_t ol = strlen(old);
+            if (strlen(line) > ol && strncmp(line, old, ol) == 0) {
+                rc = update_entry_text(nb, pi, line);
+                im->stats->ports_updated++;
+            }
+        }
+        if (rc == HP_OK && tag) rc = entry_add_tags(nb, pi, tag);
+    }
+
+    if (rc == HP_OK) rc = host_update_text(im, hi, h);
+    if (rc == HP_OK) rc = entry_add_tags(nb, hi, tags);
+
+done:
+    host_reset(h);
+    return rc;
+}
+
+/* A parsed record: gathered with the others for the same IP, which masscan
+   reports one port at a time */
+static int scan_emit(ScanImport *im) {
+    ScanHost *r = &im->rec, *c = &im->cur;
+    int rc = HP_OK;
+    if (r->ip[0] && strcmp(r->ip, c->ip) != 0) {
+        rc = scan_flush(im);
+        strcpy(c->ip, r->ip);
+    }
+    if (rc == HP_OK && r->ip[0]) {
+        if (!*c->hostname) strcpy(c->hostname, r->hostname);
+        if (!*c->os) strcpy(c->os, r->os);
+        if (r->down) c->down = 1;
+        for (int i = 0; i < r->nports && rc == HP_OK; i++)
+            if (!host_add_port(c, &r->ports[i])) rc = scan_fail(im, HP_ERR_NOMEM, "Out of memory");
+    }
+    host_reset(r);
+    return rc;
+}
+
+/* ---------------- XML (nmap -oX, masscan -oX) ---------------- */
+
+typedef struct {
+    const char *name;
+    int closing;
+    int nattrs;
+    const char *key[SCAN_MAX_ATTRS];
+    const char *val[SCAN_MAX_ATTRS];
+} XmlTag;
+
+static const char *xml_attr(const XmlTag *t, const char *key) {
+    for (int i = 0; i < t->nattrs; i++)
+        if (strcmp(t->key[i], key) == 0) return t->val[i];
+    return "";
+}
+
+/* Decode entities of s in place */
+static void xml_unescape(char *s) {
+    static const struct { const char *ent; char c; } ents[] = {
+        {"&lt;", '<'}, {"&gt;", '>'}, {"&amp;", '&'}, {"&quot;", '"'}, {"&apos;", '\''}
+    };
+    char *out = s;
+    while (*s) {
+        if (*s == '&') {
+            int done = 0;
+            for (size_t i = 0; i < sizeof(ents) / sizeof(ents[0]) && !done; i++) {
+                size_t n = strlen(ents[i].ent);
+                if (strncmp(s, ents[i].ent, n) == 0) { *out++ = ents[i].c; s += n; done = 1; }
+            }
+            if (!done && s[1] == '#') {
+                char *end;
+                long v = s[2] == 'x' ? strtol(s + 3, &end, 16) : strtol(s + 2, &end, 10);
+                if (*end == ';') { *out++ = v > 0 && v < 0x80 ? (char)v : '?'; s = end + 1; done = 1; }
+            }
+            if (done) continue;
+        }
+        *out++ = *s++;
+    }
+    *out = '\0';
+}
+
+/* Split the tag text in im->tag into name and attributes, in place */
+static void xml_split(char *s, XmlTag *t) {
+    memset(t, 0, sizeof(*t));
+    if (*s == '/') { t->closing = 1; s++; }
+    t->name = s;
+    while (*s && !isspace((unsigned char)*s) && *s != '/') s++;
+    if (*s) *s++ = '\0';
+
+    for (;;) {
+        while (isspace((unsigned char)*s) || *s == '/') s++;
+        if (!*s) break;
+        char *key = s;
+        while (*s && *s != '=' && !isspace((unsigned char)*s)) s++;
+        if (*s != '=' || (s[1] != '"' && s[1] != '\'')) {
+            if (*s) s++;
+            continue;
+        }
+        *s = '\0';
+        char *val = s + 2;
+        char *end = strchr(val, s[1]);
+        if (!end) break;
+        *end = '\0';
+        xml_unescape(val);
+        if (t->nattrs < SCAN_MAX_ATTRS) {
+            t->key[t->nattrs] = key;
+            t->val[t->nattrs++] = val;
+        }
+        s = end + 1;
+    }
+}
+
+/* Next element tag into *t; 0 at EOF. Text, comments, <?...?> and <!...>
+   are skipped; a tag over SCAN_MAX_TAG bytes comes back nameless. */
+static int xml_next(ScanImport *im, XmlTag *t) {
+    int c;
+    for (;;) {
+        while ((c = getc(im->in)) != EOF && c != '<') if (c == '\n') im->line++;
+        if (c == EOF) return 0;
+
+        ScanBuf *b = &im->tag;
+        b->len = 0;
+        int quote = 0, over = 0;
+        while ((c = getc(im->in)) != EOF) {
+            if (c == '\n') im->line++;
+            if (!quote && c == '>') {
+                /* a comment ends at "-->" only */
+                if (b->len >= 3 && strncmp(b->data, "!--", 3) == 0 &&
+                    (b->len < 5 || strncmp(b->data + b->len - 2, "--", 2) != 0)) {
+                    if (!over) sbuf_putn(b, ">", 1);
+                    continue;
+                }
+                break;
+            }
+            if (quote ? c == quote : (c == '"' || c == '\'')) quote = quote ? 0 : c;
+            char ch = (char)c;
+            if (b->len + 1 >= SCAN_MAX_TAG) over = 1;
+            else sbuf_putn(b, &ch, 1);
+        }
+        if (b->oom) return scan_fail(im, HP_ERR_NOMEM, "Out of memory");
+        if (c == EOF) return 0;
+        if (!b->len || b->data[0] == '!' || b->data[0] == '?') continue;
+
+        if (over) {
+            memset(t, 0, sizeof(*t));
+            t->name = "";
+            return 1;
+        }
+        xml_split(b->data, t);
+        return 1;
+    }
+}
+
+static int import_xml(ScanImport *im) {
+    ScanHost *r = &im->rec;
+    ScanPort port;
+    int in_host = 0, in_port = 0, port_open = 0;
+    XmlTag t;
+    int rc;
+
+    while ((rc = xml_next(im, &t)) > 0) {
+        const char *n = t.name;
+        if (strcmp(n, "nmaprun") == 0 && !t.closing) {
+            set_source(im, xml_attr(&t, "scanner"));
+        } else if (strcmp(n, "host") == 0) {
+            if (!t.closing) { host_reset(r); in_host = 1; continue; }
+            in_host = 0;
+            if ((rc = scan_emit(im)) != HP_OK) return rc;
+        } else if (!in_host) {
+            continue;
+        } else if (strcmp(n, "status") == 0) {
+            r->down = strcmp(xml_attr(&t, "state"), "up") != 0;
+        } else if (strcmp(n, "address") == 0) {
+            const char *type = xml_attr(&t, "addrtype");
+            const char *a = xml_attr(&t, "addr");
+            if ((strcmp(type, "ipv4") == 0 || strcmp(type, "ipv6") == 0) && looks_like_ip(a, strlen(a)))
+                strcpy(r->ip, a);
+        } else if (strcmp(n, "hostname") == 0) {
+            if (!*r->hostname) copy_field(r->hostname, sizeof(r->hostname), xml_attr(&t, "name"));
+        } else if (strcmp(n, "osmatch") == 0) {
+            if (!*r->os && !t.closing) copy_field(r->os, sizeof(r->os), xml_attr(&t, "name"));
+        } else if (strcmp(n, "port") == 0) {
+            if (!t.closing) {
+                memset(&port, 0, sizeof(port));
+                port.port = atoi(xml_attr(&t, "portid"));
+                copy_field(port.proto, sizeof(port.proto), xml_attr(&t, "protocol"));
+                in_port = 1;
+                port_open = 0;
+                continue;
+            }
+            if (in_port && port_open && port.port > 0 && !host_add_port(r, &port))
+                return scan_fail(im, HP_ERR_NOMEM, "Out of memory");
+            in_port = 0;
+        } else if (!in_port || t.closing) {
+            continue;
+        } else if (strcmp(n, "state") == 0) {
+            port_open = strcmp(xml_attr(&t, "state"), "open") == 0;
+        } else if (strcmp(n, "service") == 0) {
+            const char *tunnel = xml_attr(&t, "tunnel");
+            snprintf(port.service, sizeof(port.service), "%s%s%s", tunnel, *tunnel ? "/" : "", xml_attr(&t, "name"));
+            char detail[3 * SCAN_FIELD];
+            const char *parts[] = { xml_attr(&t, "product"), xml_attr(&t, "version"), xml_attr(&t, "extrainfo") };
+            size_t dn = 0;
+            detail[0] = '\0';
+            for (int i = 0; i < 3; i++)
+                if (*parts[i] && dn < sizeof(detail) - 1)
+                    dn += (size_t)snprintf(detail + dn, sizeof(detail) - dn, "%s%s", dn ? " " : "", parts[i]);
+            /* masscan puts a banner here instead */
+            if (!dn) copy_field(detail, sizeof(detail), xml_attr(&t, "banner"));
+            copy_field(port.detail, sizeof(port.detail), detail);
+        }
+    }
+    return rc;
+}
+
+/* ---------------- JSON (masscan -oJ, -oD) ---------------- */
+
+static int js_getc(ScanImport *im) {
+    int c = getc(im->in);
+    if (c == '\n') im->line++;
+    return c;
+}
+
+static int js_peek(ScanImport *im) {
+    int c;
+    while ((c = js_getc(im)) != EOF && isspace(c)) {}
+    if (c != EOF) ungetc(c, im->in);
+    return c;
+}
+
+static int js_expect(ScanImport *im, int want) {
+    int c = js_peek(im);
+    if (c != want) return scan_fail(im, HP_ERR_SYNTAX, "JSON: expected '%c' on line %ld", want, im->line + 1);
+    js_getc(im);
+    return HP_OK;
+}
+
+/* A string (opening quote next) into out, cut to cap; \u escapes past ASCII become '?' */
+static int js_string(ScanImport *im, char *out, size_t cap) {
+    if (js_expect(im, '"') != HP_OK) return HP_ERR_SYNTAX;
+    size_t n = 0;
+    int c;
+    while ((c = js_getc(im)) != EOF && c != '"') {
+        if (c == '\\') {
+            c = js_getc(im);
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': case 'f': c = ' '; break;
+                case 'u': {
+                    char hex[5] = {0};
+                    for (int i = 0; i < 4; i++) hex[i] = (char)js_getc(im);
+                    long v = strtol(hex, NULL, 16);
+                    c = v > 0 && v < 0x80 ? (int)v : '?';
+                    break;
+                }
+                case EOF: return scan_fail(im, HP_ERR_SYNTAX, "JSON: unterminated string on line %ld", im->line + 1);
+                default: break;
+            }
+        }
+        if (n + 1 < cap) out[n++] = (char)c;
+    }
+    if (c == EOF) return scan_fail(im, HP_ERR_SYNTAX, "JSON: unterminated string on line %ld", im->line + 1);
+    out[n] = '\0';
+    return HP_OK;
+}
+
+/* Any value; strings and scalars end up in out (when out is not NULL) */
+static int js_value(ScanImport *im, char *out, size_t cap, int depth) {
+    char scratch[8];
+    if (!out) { out = scratch; cap = sizeof(scratch); }
+    out[0] = '\0';
+    int c = js_peek(im);
+    if (depth > 64) return scan_fail(im, HP_ERR_SYNTAX, "JSON: nested too deep on line %ld", im->line + 1);
+
+    if (c == '"') return js_string(im, out, cap);
+    if (c == '{' || c == '[') {
+        int close = c == '{' ? '}' : ']';
+        js_getc(im);
+        if (js_peek(im) == close) { js_getc(im); return HP_OK; }
+        for (;;) {
+            if (c == '{') {
+                char key[8];
+                if (js_string(im, key, sizeof(key)) != HP_OK || js_expect(im, ':') != HP_OK) return HP_ERR_SYNTAX;
+            }
+            if (js_value(im, NULL, 0, depth + 1) != HP_OK) return HP_ERR_SYNTAX;
+            int d = js_peek(im);
+            js_getc(im);
+            if (d == close) return HP_OK;
+            if (d != ',') return scan_fail(im, HP_ERR_SYNTAX, "JSON: expected ',' or '%c' on line %ld", close, im->line + 1);
+        }
+    }
+
+    size_t n = 0;
+    while ((c = js_peek(im)) != EOF && (isalnum(c) || c == '-' || c == '+' || c == '.')) {
+        js_getc(im);
+        if (n + 1 < cap) out[n++] = (char)c;
+    }
+    out[n] = '\0';
+    if (!n && c == EOF) return scan_fail(im, HP_ERR_SYNTAX, "JSON: unexpected end of file");
+    if (!n) return scan_fail(im, HP_ERR_SYNTAX, "JSON: unexpected '%c' on line %ld", c, im->line + 1);
+    return HP_OK;
+}
+
+/* Fields of one object, handed to fn one key at a time (value next) */
+static int js_object(ScanImport *im, int (*fn)(ScanImport *, const char *, void *), void *arg) {
+    if (js_expect(im, '{') != HP_OK) return HP_ERR_SYNTAX;
+    if (js_peek(im) == '}') { js_getc(im); return HP_OK; }
+    for (;;) {
+        char key[32];
+        if (js_string(im, key, sizeof(key)) != HP_OK || js_expect(im, ':') != HP_OK) return HP_ERR_SYNTAX;
+        int rc = fn(im, key, arg);
+        if (rc != HP_OK) return rc;
+        int c = js_peek(im);
+        js_getc(im);
+        if (c == '}') return HP_OK;
+        if (c != ',') return scan_fail(im, HP_ERR_SYNTAX, "JSON: expected ',' or '}' on line %ld", im->line + 1);
+    }
+}
+
+/* A port record: {"port":80,"proto":"tcp","status":"open","service":{...}} or
+   -oD's flat form with "data":{"status":...} / {"service_name":..,"banner":..} */
+typedef struct {
+    ScanPort p;
+    char status[16];
+} JsPort;
+
+static int js_port_key(ScanImport *im, const char *key, void *arg) {
+    JsPort *jp = (JsPort*)arg;
+    char v[SCAN_FIELD];
+    if (strcmp(key, "service") == 0 || strcmp(key, "data") == 0) {
+        if (js_peek(im) == '{') return js_object(im, js_port_key, jp);
+        return js_value(im, NULL, 0, 0);
+    }
+    int rc = js_value(im, v, sizeof(v), 0);
+    if (rc != HP_OK) return rc;
+    if (strcmp(key, "port") == 0) jp->p.port = atoi(v);
+    else if (strcmp(key, "proto") == 0) copy_field(jp->p.proto, sizeof(jp->p.proto), v);
+    else if (strcmp(key, "status") == 0) copy_field(jp->status, sizeof(jp->status), v);
+    else if (strcmp(key, "name") == 0 || strcmp(key, "service_name") == 0) copy_field(jp->p.service, sizeof(jp->p.service), v);
+    else if (strcmp(key, "banner") == 0) copy_field(jp->p.detail, sizeof(jp->p.detail), v);
+    return HP_OK;
+}
+
+static int js_add_port(ScanImport *im, JsPort *jp) {
+    if (jp->p.port <= 0 || (*jp->status && strcmp(jp->status, "open") != 0)) return HP_OK;
+    if (!*jp->p.proto) strcpy(jp->p.proto, "tcp");
+    return host_add_port(&im->rec, &jp->p) ? HP_OK : scan_fail(im, HP_ERR_NOMEM, "Out of memory");
+}
+
+static int js_host_key(ScanImport *im, const char *key, void *arg) {
+    JsPort *flat = (JsPort*)arg;
+    if (strcmp(key, "ip") == 0) {
+        char v[64];
+        int rc = js_value(im, v, sizeof(v), 0);
+        if (rc == HP_OK && looks_like_ip(v, strlen(v))) strcpy(im->rec.ip, v);
+        return rc;
+    }
+    if (strcmp(key, "ports") == 0 && js_peek(im) == '[') {
+        js_getc(im);
+        if (js_peek(im) == ']') { js_getc(im); return HP_OK; }
+        for (;;) {
+            JsPort jp;
+            memset(&jp, 0, sizeof(jp));
+            int rc = js_object(im, js_port_key, &jp);
+            if (rc == HP_OK) rc = js_add_port(im, &jp);
+            if (rc != HP_OK) return rc;
+            int c = js_peek(im);
+            js_getc(im);
+            if (c == ']') return HP_OK;
+            if (c != ',') return scan_fail(im, HP_ERR_SYNTAX, "JSON: expected ',' or ']' on line %ld", im->line + 1);
+        }
+    }
+    return js_port_key(im, key, flat);
+}
+
+static int import_json(ScanImport *im) {
+    set_source(im, "masscan");
+    int array = js_peek(im) == '[';
+    if (array) js_getc(im);
+
+    for (;;) {
+        int c = js_peek(im);
+        if (c == EOF) return HP_OK;                     /* masscan closes the array only when done */
+        if (array && c == ']') return HP_OK;
+        if (c == ',') { js_getc(im); continue; }       /* masscan's leading/trailing commas */
+
+        JsPort flat;
+        memset(&flat, 0, sizeof(flat));
+        host_reset(&im->rec);
+        int rc = js_object(im, js_host_key, &flat);
+        if (rc == HP_OK) rc = js_add_port(im, &flat);
+        if (rc == HP_OK) rc = scan_emit(im);
+        if (rc != HP_OK) return rc;
+    }
+}
+
+/* ---------------- Grepable (-oG) ---------------- */
+
+/* "Host: 10.0.0.5 (dc01.corp)\tStatus: Up" / "...\tPorts: 22/open/tcp//ssh//OpenSSH 8.2p1/, ..." */
+static int import_grepable(ScanImport *im) {
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int rc = HP_OK;
+    ScanHost *r = &im->rec;
+
+    while (rc == HP_OK && (len = getline(&line, &cap, im->in)) >= 0) {
+        im->line++;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (line[0] == '#') {
+            if (strncmp(line, "# Masscan", 9) == 0) set_source(im, "masscan");
+            continue;
+        }
+
+        host_reset(r);
+        for (char *f = line, *next; f; f = next) {
+            if ((next = strchr(f, '\t'))) *next++ = '\0';
+            while (*f == ' ') f++;
+
+            if (strncmp(f, "Host: ", 6) == 0) {
+                char *ip = f + 6, *sp = strchr(ip, ' ');
+                if (sp) *sp = '\0';
+                if (looks_like_ip(ip, strlen(ip))) strcpy(r->ip, ip);
+                if (sp && sp[1] == '(') {
+                    char *close = strchr(sp + 2, ')');
+                    if (close) *close = '\0';
+                    copy_field(r->hostname, sizeof(r->hostname), sp + 2);
+                }
+            } else if (strncmp(f, "Status: ", 8) == 0) {
+                r->down = strncmp(f + 8, "Up", 2) != 0;
+            } else if (strncmp(f, "OS: ", 4) == 0) {
+                copy_field(r->os, sizeof(r->os), f + 4);
+            } else if (strncmp(f, "Ports: ", 7) == 0) {
+                /* port/state/proto/owner/service/rpc/version/, nmap writes '/' in values as '|' */
+                for (char *p = f + 7, *pn; p && *p; p = pn) {
+                    if ((pn = strstr(p, ", "))) { *pn = '\0'; pn += 2; }
+                    char *fld[8] = {0};
+                    int nf = 0;
+                    for (char *q = p; q && nf < 8; ) {
+                        fld[nf++] = q;
+                        if ((q = strchr(q, '/'))) *q++ = '\0';
+                    }
+                    if (nf < 5 || strcmp(fld[1], "open") != 0) continue;
+                    ScanPort port;
+                    memset(&port, 0, sizeof(port));
+                    port.port = atoi(fld[0]);
+                    copy_field(port.proto, sizeof(port.proto), fld[2]);
+                    copy_field(port.service, sizeof(port.service), fld[4]);
+                    if (nf > 6) copy_field(port.detail, sizeof(port.detail), fld[6]);
+                    for (char *q = port.service; *q; q++) if (*q == '|') *q = '/';
+                    for (char *q = port.detail; *q; q++) if (*q == '|') *q = '/';
+                    if (port.port > 0 && !host_add_port(r, &port)) rc = scan_fail(im, HP_ERR_NOMEM, "Out of memory");
+                }
+            }
+        }
+        if (rc == HP_OK) rc = scan_emit(im);
+    }
+    free(line);
+    return rc;
+}
+
+/* ---------------- Entry point ---------------- */
+
+int import_scan(HackPad *nb, int section_id, FILE *in, ScanStats *stats) {
+    ScanStats dummy;
+    memset(stats ? stats : &dummy, 0, sizeof(ScanStats));
+    if (find_section_index_by_id(nb, section_id) < 0) {
+        snprintf(nb->error, sizeof(nb->error), "No such section");
+        return HP_ERR_NOTFOUND;
+    }
+
+    ScanImport im;
+    memset(&im, 0, sizeof(im));
+    im.nb = nb;
+    im.section_id = section_id;
+    im.in = in;
+    im.stats = stats ? stats : &dummy;
+    set_source(&im, "nmap");
+
+    int rc = map_build(&im) ? HP_OK : scan_fail(&im, HP_ERR_NOMEM, "Out of memory");
+    if (rc == HP_OK) {
+        int c;
+        while ((c = getc(in)) != EOF && isspace(c)) if (c == '\n') im.line++;
+        if (c != EOF) ungetc(c, in);
+
+        if (c == '<') rc = import_xml(&im);
+        else if (c == '[' || c == '{') rc = import_json(&im);
+        else if (c != EOF) rc = import_grepable(&im);
+        if (rc == HP_OK) rc = scan_flush(&im);
+        if (rc == HP_OK && ferror(in)) rc = scan_fail(&im, HP_ERR_IO, "Could not read the scan file");
+    }
+
+    free(im.slots);
+    free(im.rec.ports);
+    free(im.cur.ports);
+    free(im.tag.data);
+    return rc;
+}
@@ -0,0 +1,395 @@
+/*  hackpad_test - headless checks of undo, the journal, the .hpb snapshot and merge
+
+    Compile and run (from the repository root):
+      make test
+
+    Usage:
+      ./hackpad_test [--seeds N] [--seed N] [--steps N] [--keep]
+
+    For each seed it opens a fresh notebook in a temporary directory
+    ($TMPDIR or /tmp) and makes --steps undo steps of one to three random
+    edits each: sections and entries added, retexted, retagged, marked,
+    folded and deleted, and done entries bulk-removed. The markdown after
+    every step is kept, then it checks:
+
+      undo       undoing step by step retraces those states back to the start
+      redo       redoing step by step walks them forward to the end
+      journal    reopening the file replays the journal into the same notebook
+      hpb        a save reopened through <file>.hpb reads the same as the markdown
+      merge      merging a notebook into itself changes nothing; merging an
+                 edited copy keeps every entry and a second merge changes nothing
+
+    Once per run it also checks that a text edit takes an entry out of the
+    cached visible list under a text: filter (view).
+
+    Notebooks are compared by their saved markdown, header lines left out.
+    Failures go to stderr, one line each with the seed to rerun; the exit
+    status is 1 if any check failed. The directory is removed unless --keep
+    or something failed.
+*/
+
+#define _XOPEN_SOURCE 700
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../hackpad_core_internal.h"
+
+typedef struct {
+    int seeds;
+    unsigned long seed;
+    int steps;
+    int keep;
+} TestParams;
+
+static unsigned long rng_state;
+
+static unsigned rnd(unsigned n) {
+    rng_state = rng_state * 6364136223846793005UL + 1442695040888963407UL;
+    return n ? (unsigned)((rng_state >> 33) % n) : 0;
+}
+
+static int failures;
+static unsigned long cur_seed;
+
+static void fail(const char *check, const char *what) {
+    fprintf(stderr, "FAIL %-8s seed %lu: %s\n", check, cur_seed, what);
+    failures++;
+}
+
+/* The notebook as save writes it, from the first section on (the header
+   carries the save time and the journal position) */
+static char *notebook_text(HackPad *nb) {
+    StrBuf out = {0};
+    serialize_hackpad(nb, &out);
+    char *text = NULL;
+    if (!out.oom) {
+        size_t skip = 0;
+        while (skip + 1 < out.len && !(out.data[skip] == '\n' && out.data[skip + 1] == '\n')) skip++;
+        text = (char*)malloc(out.len - skip + 1);
+        if (text) {
+            memcpy(text, out.data + skip, out.len - skip);
+            text[out.len - skip] = '\0';
+        }
+    }
+    sb_free(&out);
+    if (!text) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    return text;
+}
+
+static int open_file(HackPad *nb, const char *file) {
+    if (open_hackpad(nb, file) == HP_OK) return 1;
+    fail("open", nb->error);
+    close_hackpad(nb);
+    return 0;
+}
+
+static void remove_notebook(const char *file) {
+    char path[512];
+    unlink(file);
+    snprintf(path, sizeof(path), "%s.journal", file);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s.hpb", file);
+    unlink(path);
+}
+
+/* ---------------- Random edits ---------------- */
+
+/* Any entry slot of section si, -1 if it has none */
+static int random_entry(HackPad *nb, int si) {
+    Section *s = &nb->sections[si];
+    return s->entry_count ? entry_at(nb, s, (int)rnd((unsigned)s->entry_count)) : -1;
+}
+
+/* A depth that keeps the outline valid for an entry linked after 'after' */
+static int random_depth(HackPad *nb, int si, int after) {
+    int next = after >= 0 ? nb->entry_next[after] : nb->sections[si].first_entry;
+    int lo = next >= 0 && nb->cols.depth[next] > 0 ? nb->cols.depth[next] - 1 : 0;
+    int hi = after >= 0 ? nb->cols.depth[after] + 1 : 0;
+    if (hi > MAX_DEPTH) hi = MAX_DEPTH;
+    return lo + (int)rnd((unsigned)(hi - lo + 1));
+}
+
+static void random_edit(HackPad *nb) {
+    char text[64];
+    snprintf(text, sizeof(text), "note %u #t%u", rnd(1000), rnd(6));
+    unsigned k = rnd(100);
+
+    /* sections go where the frontends put them: after a section's subtree,
+       as its sibling or as its last child */
+    if (nb->section_count == 0 || k < 5) {
+        if (nb->section_count == 0) {
+            create_section(nb, 0, -1, 0, text);
+            return;
+        }
+        int si = (int)rnd((unsigned)nb->section_count), pos = section_subtree_end_index(nb, si) + 1;
+        Section *s = &nb->sections[si];
+        if (s->depth < 2 && rnd(3) == 0) create_section(nb, pos, s->id, s->depth + 1, text);
+        else create_section(nb, pos, s->parent_id, s->depth, text);
+        return;
+    }
+
+    int si = (int)rnd((unsigned)nb->section_count), ei = random_entry(nb, si);
+    if (k < 45) {
+        int after = ei >= 0 && rnd(8) ? ei : -1;
+        create_entry(nb, nb->sections[si].id, after, -1, random_depth(nb, si, after), text);
+        return;
+    }
+    if (k >= 92) {
+        if (k < 95) update_section_attrs(nb, si, (int)rnd(2), (UiColor)rnd(3));
+        else if (k < 97) delete_section_subtree(nb, si);
+        else {
+            ViewQuery q;
+            const char *err;
+            if (viewq_compile(nb, &q, "is:done", &err) == HP_OK)
+                remove_entries_where(nb, 0, nb->section_count - 1, &q);
+        }
+        return;
+    }
+    if (ei < 0) return;
+
+    EntryHot h = entry_hot(nb, ei);
+    if (k < 65) update_entry_text(nb, ei, text);
+    else if (k < 72) update_entry_tags(nb, ei, rnd(2) ? "web smb" : "");
+    else if (k < 80) {
+        h.completed = !h.completed;
+        h.priority = (Priority)rnd(5);
+        h.pinned = rnd(4) == 0;
+        update_entry_attrs(nb, ei, &h);
+    } else if (k < 84) {
+        h.collapsed = !h.collapsed;
+        update_entry_attrs(nb, ei, &h);
+    } else {
+        delete_entry_subtree(nb, ei);
+    }
+}
+
+/* ---------------- Checks ---------------- */
+
+/* Undo until there is nothing left, then redo until there is nothing left;
+   state[0..count) are the distinct states the steps went through */
+static void check_undo_redo(HackPad *nb, char **state, int count) {
+    char msg[400];
+    for (int redo = 0; redo <= 1; redo++) {
+        const char *check = redo ? "redo" : "undo";
+        int at = redo ? 0 : count - 1, rc;
+        while ((rc = undo_step(nb, redo)) == HP_OK) {
+            char *text = notebook_text(nb);
+            int next = redo ? at + 1 : at - 1;
+            if (strcmp(text, state[at]) != 0) {
+                if (next < 0 || next >= count || strcmp(text, state[next]) != 0) {
+                    snprintf(msg, sizeof(msg), "step away from state %d matches no recorded state", at);
+                    fail(check, msg);
+                    free(text);
+                    return;
+                }
+                at = next;
+            }
+            free(text);
+        }
+        if (rc != HP_ERR_NOOP || at != (redo ? count - 1 : 0)) {
+            snprintf(msg, sizeof(msg), "stopped at state %d of %d: %s", at, count, nb->error);
+            fail(check, msg);
+            return;
+        }
+    }
+}
+
+/* Reopening replays the journal, and equals what was live */
+static void check_journal(HackPad *nb, const char *file) {
+    char *live = notebook_text(nb);
+    close_hackpad(nb);
+    HackPad re;
+    if (open_file(&re, file)) {
+        char *text = notebook_text(&re);
+        if (strcmp(text, live) != 0) fail("journal", "the replayed notebook differs");
+        free(text);
+        close_hackpad(&re);
+    }
+    free(live);
+}
+
+/* Save, reopen through the snapshot, then again from the markdown alone */
+static void check_hpb(const char *file) {
+    HackPad nb, snap, md;
+    if (!open_file(&nb, file)) return;
+    char *live = notebook_text(&nb);
+    if (save_hackpad(&nb, file) != HP_OK) fail("hpb", nb.error);
+    close_hackpad(&nb);
+
+    if (open_file(&snap, file)) {
+        char *text = notebook_text(&snap);
+        if (!snap.hpb_map) fail("hpb", "the snapshot was not used");
+        else if (strcmp(text, live) != 0) fail("hpb", "the snapshot reads differently from the save");
+        free(text);
+        close_hackpad(&snap);
+    }
+
+    char hpb[512];
+    snprintf(hpb, sizeof(hpb), "%s.hpb", file);
+    unlink(hpb);
+    if (open_file(&md, file)) {
+        char *text = notebook_text(&md);
+        if (md.hpb_map) fail("hpb", "a removed snapshot was used");
+        else if (strcmp(text, live) != 0) fail("hpb", "the markdown reads differently from the save");
+        free(text);
+        close_hackpad(&md);
+    }
+    free(live);
+}
+
+static int merge_file(HackPad *nb, const char *file, MergeStats *st) {
+    if (merge_hackpad(nb, file, st) == HP_OK) return 1;
+    fail("merge", nb->error);
+    return 0;
+}
+
+/* file is saved; other becomes a copy of it with more edits on top */
+static void check_merge(const char *file, const char *other, int steps) {
+    HackPad nb, ot;
+    MergeStats st;
+    if (!open_file(&nb, file)) return;
+    char *before = notebook_text(&nb);
+    int entries = nb.entry_count;
+
+    if (merge_file(&nb, file, &st)) {
+        char *text = notebook_text(&nb);
+        if (st.sections_added || st.entries_added || st.entries_updated || strcmp(text, before) != 0)
+            fail("merge", "merging the notebook into itself changed it");
+        free(text);
+    }
+
+    remove_notebook(other);
+    if (!open_file(&ot, file)) { close_hackpad(&nb); free(before); return; }
+    for (int i = 0; i < steps; i++) random_edit(&ot);
+    if (save_hackpad(&ot, other) != HP_OK) fail("merge", ot.error);
+    close_hackpad(&ot);
+
+    if (merge_file(&nb, other, &st)) {
+        char *once = notebook_text(&nb);
+        if (nb.entry_count < entries) fail("merge", "a merge lost entries");
+        if (merge_file(&nb, other, &st)) {
+            char *twice = notebook_text(&nb);
+            if (st.sections_added || st.entries_added || st.entries_updated || strcmp(twice, once) != 0)
+                fail("merge", "merging the same file twice changed the notebook");
+            free(twice);
+        }
+        free(once);
+    }
+    close_hackpad(&nb);
+    free(before);
+}
+
+/* The cached visible list must drop an entry a text edit takes out of a
+   text: filter */
+static void check_text_edit_view(const char *file) {
+    HackPad nb;
+    remove_notebook(file);
+    if (!open_file(&nb, file)) return;
+    int sid = create_section(&nb, 0, -1, 0, "View");
+    int id = create_entry(&nb, sid, -1, -1, 0, "hackpad_test alpha");
+    create_entry(&nb, sid, find_entry_index_by_id(&nb, id), -1, 0, "hackpad_test beta");
+    int ei = find_entry_index_by_id(&nb, id);
+    if (sid < 0 || ei < 0) {
+        fail("view", nb.error);
+        close_hackpad(&nb);
+        return;
+    }
+    set_filter(&nb, "text:alpha");
+    int before = visible_entries(&nb, sid)->count;
+    update_entry_text(&nb, ei, "hackpad_test gamma");
+    int after = visible_entries(&nb, sid)->count, matches = entry_matches_filter(&nb, ei);
+    if (before != 1 || after != 0 || matches) fail("view", "visible list not rebuilt after a text edit");
+    close_hackpad(&nb);
+}
+
+static void run_seed(const char *dir, int steps) {
+    char file[320], other[320];
+    snprintf(file, sizeof(file), "%s/notes.md", dir);
+    snprintf(other, sizeof(other), "%s/other.md", dir);
+    remove_notebook(file);
+
+    HackPad nb;
+    if (!open_file(&nb, file)) return;
+    undo_start(&nb);
+
+    char **state = (char**)malloc((size_t)(steps + 1) * sizeof(char*));
+    if (!state) { fprintf(stderr, "out of memory\n"); exit(2); }
+    int count = 0;
+    state[count++] = notebook_text(&nb);
+    for (int i = 0; i < steps; i++) {
+        for (int n = 1 + (int)rnd(3); n > 0; n--) random_edit(&nb);
+        undo_commit(&nb);
+        char *text = notebook_text(&nb);
+        if (strcmp(text, state[count - 1]) != 0) state[count++] = text;
+        else free(text);
+    }
+
+    check_undo_redo(&nb, state, count);
+    check_journal(&nb, file);
+    check_hpb(file);
+    check_merge(file, other, steps / 10 + 1);
+
+    for (int i = 0; i < count; i++) free(state[i]);
+    free(state);
+}
+
+static const char *arg_value(int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) { fprintf(stderr, "%s needs a value\n", argv[*i]); exit(2); }
+    return argv[++*i];
+}
+
+int main(int argc, char *argv[]) {
+    TestParams tp = { 20, 1, 200, 0 };
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "--seeds")) tp.seeds = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--seed")) { tp.seed = strtoul(arg_value(argc, argv, &i), NULL, 10); tp.seeds = 1; }
+        else if (!strcmp(a, "--steps")) tp.steps = atoi(arg_value(argc, argv, &i));
+        else if (!strcmp(a, "--keep")) tp.keep = 1;
+        else { fprintf(stderr, "unknown option %s (see the comment at the top of tests/hackpad_test.c)\n", a); return 2; }
+    }
+    if (tp.seeds < 1 || tp.steps < 1) {
+        fprintf(stderr, "bad sizes\n");
+        return 2;
+    }
+
+    /* every step must stay undoable, and saves must write the snapshot */
+    setenv("HACKPAD_UNDO_KB", "1048576", 1);
+    unsetenv("HACKPAD_SNAPSHOT");
+
+    const char *tmpdir = getenv("TMPDIR");
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s/hackpad_test_XXXXXX", tmpdir && *tmpdir ? tmpdir : "/tmp");
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 2; }
+
+    char view[320];
+    snprintf(view, sizeof(view), "%s/view.md", dir);
+    cur_seed = tp.seed;
+    check_text_edit_view(view);
+
+    for (int k = 0; k < tp.seeds; k++) {
+        cur_seed = tp.seed + (unsigned long)k;
+        rng_state = cur_seed;
+        run_seed(dir, tp.steps);
+    }
+
+    fprintf(stderr, "%d seeds x %d steps: %s\n", tp.seeds, tp.steps,
+            failures ? "FAILED" : "ok");
+    if (failures || tp.keep) {
+        fprintf(stderr, "files left in %s\n", dir);
+    } else {
+        char path[320];
+        snprintf(path, sizeof(path), "%s/notes.md", dir);
+        remove_notebook(path);
+        snprintf(path, sizeof(path), "%s/other.md", dir);
+        remove_notebook(path);
+        remove_notebook(view);
+        rmdir(dir);
+    }
+    return failures ? 1 : 0;
+}